@@ -0,0 +1,191 @@
+#include "connector.hpp"
+#include <iostream>
+
+namespace impl {
+
+Connector::Ptr Connector::connect(EpollEventLoop& loop, const sockaddr_in& addr, std::chrono::milliseconds timeout,
+                                  ConnectCallback on_connected, FailureCallback on_failed) {
+    auto connector = std::make_shared<Connector>(private_tag{}, loop, addr, timeout,
+                                                 std::move(on_connected), std::move(on_failed));
+    loop.run_in_loop([connector]() {
+        connector->start_in_loop();
+    });
+    return connector;
+}
+
+Connector::Ptr Connector::connect(EpollEventLoop& loop, const std::string& ip, int port,
+                                  std::chrono::milliseconds timeout,
+                                  ConnectCallback on_connected, FailureCallback on_failed) {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+        throw epoll_event_loop_exception("Invalid IP address: " + ip);
+    }
+    return connect(loop, addr, timeout, std::move(on_connected), std::move(on_failed));
+}
+
+Connector::Connector(private_tag, EpollEventLoop& loop, const sockaddr_in& addr, std::chrono::milliseconds timeout,
+                     ConnectCallback on_connected, FailureCallback on_failed)
+    : loop_(loop)
+    , addr_(addr)
+    , timeout_(timeout)
+    , fd_(-1)
+    , registered_(false)
+    , done_(false)
+    , timer_id_(0)
+    , on_connected_(std::move(on_connected))
+    , on_failed_(std::move(on_failed)) {}
+
+Connector::~Connector() {
+    if (fd_ != -1) {
+        close(fd_);
+    }
+}
+
+void Connector::cancel() {
+    // 在循环线程上调用时立即结束连接，但失败回调同样异步执行，调用者不必处理同步回调
+    auto self = shared_from_this();
+    loop_.run_in_loop([self]() {
+        if (!self->done_) {
+            self->close_attempt();
+            self->loop_.queue_in_loop([self]() {
+                if (self->on_failed_) {
+                    self->on_failed_(ECANCELED);
+                }
+            });
+        }
+    });
+}
+
+void Connector::start_in_loop() {
+    if (done_) {
+        return; // 开始之前已被取消
+    }
+
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ == -1) {
+        fail(errno);
+        return;
+    }
+
+    int ret = ::connect(fd_, reinterpret_cast<const sockaddr*>(&addr_), sizeof(addr_));
+    int error = ret == 0 ? 0 : errno;
+
+    if (error != 0 && error != EINPROGRESS) {
+        // 立即失败（如ENETUNREACH）：仍然异步回调，调用者不必处理同步回调
+        auto self = shared_from_this();
+        loop_.queue_in_loop([self, error]() {
+            if (!self->done_) {
+                self->fail(error);
+            }
+        });
+        return;
+    }
+
+    // 立即成功（回环上可能发生）也走EPOLLOUT，结果统一由SO_ERROR判断
+    loop_.add_fd(fd_, EPOLLOUT, shared_from_this());
+    registered_ = true;
+
+    if (timeout_.count() > 0) {
+        std::weak_ptr<Connector> weak = shared_from_this();
+        timer_id_ = loop_.add_timer(std::chrono::duration_cast<std::chrono::microseconds>(timeout_),
+                                    make_simple_timer([weak]() {
+            if (auto self = weak.lock()) {
+                self->timer_id_ = 0;
+                if (!self->done_) {
+                    self->fail(ETIMEDOUT);
+                }
+            }
+        }));
+    }
+}
+
+void Connector::handle_event(int fd, uint32_t events) {
+    (void)fd;
+    (void)events;
+    check_result();
+}
+
+void Connector::handle_error(int fd, const std::string& error) {
+    (void)fd;
+    (void)error;
+    check_result();
+}
+
+void Connector::check_result() {
+    if (done_) {
+        return;
+    }
+
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &len) == -1) {
+        error = errno;
+    }
+    if (error != 0) {
+        fail(error);
+        return;
+    }
+
+    // 自连接：目标端口落在本机临时端口范围内时，内核可能把本地端口分配成目标端口
+    sockaddr_in local;
+    socklen_t local_len = sizeof(local);
+    if (getsockname(fd_, reinterpret_cast<sockaddr*>(&local), &local_len) == 0 &&
+        local.sin_port == addr_.sin_port && local.sin_addr.s_addr == addr_.sin_addr.s_addr) {
+        fail(ECONNREFUSED);
+        return;
+    }
+
+    succeed();
+}
+
+void Connector::succeed() {
+    Ptr guard = shared_from_this();
+    done_ = true;
+    cleanup();
+
+    int fd = fd_;
+    fd_ = -1;
+    if (on_connected_) {
+        on_connected_(fd);
+    } else {
+        close(fd);
+    }
+}
+
+void Connector::fail(int error) {
+    Ptr guard = shared_from_this();
+    close_attempt();
+    if (on_failed_) {
+        on_failed_(error);
+    }
+}
+
+void Connector::close_attempt() {
+    done_ = true;
+    cleanup();
+
+    if (fd_ != -1) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+void Connector::cleanup() {
+    if (registered_) {
+        try {
+            loop_.remove_fd(fd_);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to remove connecting fd " << fd_ << ": " << e.what() << std::endl;
+        }
+        registered_ = false;
+    }
+    if (timer_id_ != 0) {
+        loop_.cancel_timer(timer_id_);
+        timer_id_ = 0;
+    }
+}
+
+} // namespace impl
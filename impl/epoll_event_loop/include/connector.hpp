@@ -0,0 +1,101 @@
+#pragma once
+
+#include "epoll_event_loop.hpp"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace impl {
+
+/**
+ * @brief 基于EpollEventLoop的非阻塞TCP连接器
+ *
+ * 特点：
+ * - 非阻塞connect返回EINPROGRESS后注册EPOLLOUT，可写时用SO_ERROR判断连接结果
+ * - 截止时间由事件循环的定时器保证，超时后注销fd并以ETIMEDOUT回调失败
+ * - 成功、失败、超时、取消四种结果只回调一次，回调总是在循环线程上异步执行
+ * - 检测回环地址上的自连接（本地端口恰好等于目标端口），按ECONNREFUSED处理
+ *
+ * 一个循环线程可以同时发起大量连接，彼此互不阻塞。
+ */
+class Connector : public EventHandler, public std::enable_shared_from_this<Connector> {
+    struct private_tag {};
+
+public:
+    using Ptr = std::shared_ptr<Connector>;
+
+    /**
+     * @brief 连接成功回调，fd的所有权交给回调（已从事件循环中移除，仍为非阻塞）
+     */
+    using ConnectCallback = std::function<void(int fd)>;
+
+    /**
+     * @brief 连接失败回调，参数为errno（超时为ETIMEDOUT，取消为ECANCELED）
+     */
+    using FailureCallback = std::function<void(int error)>;
+
+    /**
+     * @brief 发起异步连接，可以从任意线程调用
+     * @param loop 执行连接的事件循环
+     * @param addr 目标地址
+     * @param timeout 连接超时时间，0表示不限时
+     * @param on_connected 成功回调
+     * @param on_failed 失败回调
+     * @return 连接器，可用于取消
+     */
+    static Ptr connect(EpollEventLoop& loop, const sockaddr_in& addr, std::chrono::milliseconds timeout,
+                       ConnectCallback on_connected, FailureCallback on_failed);
+
+    /**
+     * @brief 发起异步连接（点分十进制IPv4地址）
+     */
+    static Ptr connect(EpollEventLoop& loop, const std::string& ip, int port, std::chrono::milliseconds timeout,
+                       ConnectCallback on_connected, FailureCallback on_failed);
+
+    Connector(private_tag, EpollEventLoop& loop, const sockaddr_in& addr, std::chrono::milliseconds timeout,
+              ConnectCallback on_connected, FailureCallback on_failed);
+    ~Connector() override;
+
+    /**
+     * @brief 取消尚未完成的连接，以ECANCELED回调失败；已完成时不做任何事
+     */
+    void cancel();
+
+    const sockaddr_in& address() const { return addr_; }
+
+    void handle_event(int fd, uint32_t events) override;
+    void handle_error(int fd, const std::string& error) override;
+
+    Connector(const Connector&) = delete;
+    Connector& operator=(const Connector&) = delete;
+
+private:
+    void start_in_loop();
+    void check_result();
+    void succeed();
+    void fail(int error);
+
+    /**
+     * @brief 标记完成、注销fd并关闭socket，不回调结果
+     */
+    void close_attempt();
+
+    /**
+     * @brief 注销fd并取消定时器
+     */
+    void cleanup();
+
+    EpollEventLoop& loop_;
+    sockaddr_in addr_;
+    std::chrono::milliseconds timeout_;
+    int fd_;
+    bool registered_;
+    bool done_;                         // 已经回调过结果
+    uint64_t timer_id_;
+
+    ConnectCallback on_connected_;
+    FailureCallback on_failed_;
+};
+
+} // namespace impl
@@ -1,4 +1,5 @@
 #include "epoll_event_loop.hpp"
+#include <cxxabi.h>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
@@ -10,9 +11,8 @@ EpollEventLoop::EpollEventLoop(int max_events, int timeout)
     , timeout_(timeout)
     , running_(false)
     , stopped_(false)
-    , next_timer_id_(1)
     , total_events_(0)
-    , total_timers_(0) {
+    , iterations_(0) {
     
     // 创建epoll实例
     epoll_fd_ = epoll_create1(0);
@@ -20,21 +20,29 @@ EpollEventLoop::EpollEventLoop(int max_events, int timeout)
         throw epoll_event_loop_exception("Failed to create epoll instance: " + std::string(strerror(errno)));
     }
     
+    // timerfd和eventfd由LoopCore创建：定时器到期与跨线程唤醒作为普通的可读事件在循环线程上处理
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = make_event_data(core_.timer_fd(), 0);
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, core_.timer_fd(), &ev) == -1) {
+        close(epoll_fd_);
+        throw epoll_event_loop_exception("Failed to add timerfd to epoll: " + std::string(strerror(errno)));
+    }
+    
+    ev.events = EPOLLIN;
+    ev.data.u64 = make_event_data(core_.wakeup_fd(), 0);
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, core_.wakeup_fd(), &ev) == -1) {
+        close(epoll_fd_);
+        throw epoll_event_loop_exception("Failed to add eventfd to epoll: " + std::string(strerror(errno)));
+    }
+    
     // 分配事件数组
     events_ = std::make_unique<epoll_event[]>(max_events_);
-    
-    // 启动定时器线程
-    timer_thread_ = std::thread(&EpollEventLoop::handle_timers, this);
 }
 
 EpollEventLoop::~EpollEventLoop() {
     stop();
     
-    // 等待定时器线程结束
-    if (timer_thread_.joinable()) {
-        timer_thread_.join();
-    }
-    
     // 关闭epoll文件描述符
     if (epoll_fd_ != -1) {
         close(epoll_fd_);
@@ -42,43 +50,78 @@ EpollEventLoop::~EpollEventLoop() {
 }
 
 void EpollEventLoop::add_fd(int fd, uint32_t events, std::shared_ptr<EventHandler> handler, bool is_et) {
-    std::lock_guard<std::mutex> lock(fd_mutex_);
+    std::lock_guard<std::mutex> lock(fd_slots_.mutex());
     
     // 设置非阻塞模式
     set_nonblocking(fd);
     
+    FdSlot& slot = fd_slots_.ensure(fd);
+    uint32_t generation = slot.generation.load(std::memory_order_relaxed) + 1;
+    
     // 创建epoll事件
     struct epoll_event ev;
     ev.events = events;
     if (is_et) {
         ev.events |= EPOLLET;
     }
-    ev.data.fd = fd;
+    ev.data.u64 = make_event_data(fd, generation);
+    
+    if (slot.active) {
+        // 槽位仍被占用：要么是重复添加（epoll会拒绝），要么旧fd已被直接关闭后复用。
+        // 先添加到epoll，成功后再替换处理器，最后MOD一次让期间到达的事件重新上报
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            throw epoll_event_loop_exception("Failed to add fd to epoll: " + std::string(strerror(errno)));
+        }
+        // 先清空处理器再发布新代数和新处理器：循环线程看到新代数时只会读到nullptr或新处理器，
+        // 读到新处理器时复查代数必然失败于旧事件（期间到达的新事件由最后的MOD重新上报）
+        fd_slots_.retire(std::move(slot.owner));
+        slot.handler.store(nullptr, std::memory_order_release);
+        slot.generation.store(generation, std::memory_order_release);
+        slot.stats.store(handler ? stats_for(*handler) : nullptr, std::memory_order_relaxed);
+        slot.owner = std::move(handler);
+        slot.handler.store(slot.owner.get(), std::memory_order_release);
+        slot.events = events;
+        slot.is_et = is_et;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+        return;
+    }
+    
+    // 先发布处理器再添加到epoll，保证循环线程收到事件时能看到处理器；
+    // release保证循环线程读到新处理器后复查代数时，至少能看到remove_fd写入的代数
+    slot.stats.store(handler ? stats_for(*handler) : nullptr, std::memory_order_relaxed);
+    slot.owner = std::move(handler);
+    slot.handler.store(slot.owner.get(), std::memory_order_release);
+    slot.generation.store(generation, std::memory_order_release);
     
     // 添加到epoll
     if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
-        throw epoll_event_loop_exception("Failed to add fd to epoll: " + std::string(strerror(errno)));
+        int error = errno;
+        slot.handler.store(nullptr, std::memory_order_relaxed);
+        slot.owner.reset();
+        throw epoll_event_loop_exception("Failed to add fd to epoll: " + std::string(strerror(error)));
     }
     
-    // 保存文件描述符信息
-    fd_map_[fd] = {handler, events, is_et};
+    slot.events = events;
+    slot.is_et = is_et;
+    slot.active = true;
+    fd_slots_.activated();
 }
 
 void EpollEventLoop::modify_fd(int fd, uint32_t events) {
-    std::lock_guard<std::mutex> lock(fd_mutex_);
+    std::lock_guard<std::mutex> lock(fd_slots_.mutex());
     
-    auto it = fd_map_.find(fd);
-    if (it == fd_map_.end()) {
+    FdSlot* slot = fd_slots_.find(fd);
+    if (!slot || !slot->active) {
         throw epoll_event_loop_exception("File descriptor not found in epoll");
     }
     
     // 创建epoll事件
     struct epoll_event ev;
     ev.events = events;
-    if (it->second.is_et) {
+    if (slot->is_et) {
         ev.events |= EPOLLET;
     }
-    ev.data.fd = fd;
+    ev.data.u64 = make_event_data(fd, slot->generation.load(std::memory_order_relaxed));
     
     // 修改epoll事件
     if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == -1) {
@@ -86,49 +129,76 @@ void EpollEventLoop::modify_fd(int fd, uint32_t events) {
     }
     
     // 更新文件描述符信息
-    it->second.events = events;
+    slot->events = events;
 }
 
 void EpollEventLoop::remove_fd(int fd) {
-    std::lock_guard<std::mutex> lock(fd_mutex_);
+    std::lock_guard<std::mutex> lock(fd_slots_.mutex());
     
     // 从epoll中移除
     if (epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) == -1) {
         throw epoll_event_loop_exception("Failed to remove fd from epoll: " + std::string(strerror(errno)));
     }
     
-    // 从映射中移除
-    fd_map_.erase(fd);
+    FdSlot* slot = fd_slots_.find(fd);
+    if (!slot || !slot->active) {
+        return;
+    }
+    
+    // 递增代数使本批中尚未分发的事件失效；处理器可能正被循环线程使用，延迟到本批结束后释放
+    slot->generation.store(slot->generation.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    slot->handler.store(nullptr, std::memory_order_release);
+    fd_slots_.retire(std::move(slot->owner));
+    slot->active = false;
+    fd_slots_.deactivated();
 }
 
-uint64_t EpollEventLoop::add_timer(uint64_t delay, std::shared_ptr<Timer> timer) {
-    std::lock_guard<std::mutex> lock(timer_mutex_);
-    
-    uint64_t timer_id = generate_timer_id();
-    uint64_t expire_time = get_current_time_ms() + delay;
-    
-    // 添加定时器到堆中
-    timers_.push_back({timer_id, expire_time, timer, false});
-    std::push_heap(timers_.begin(), timers_.end());
-    
-    // 通知定时器线程
-    timer_cv_.notify_one();
+EpollEventLoop::HandlerStats* EpollEventLoop::stats_for(const EventHandler& handler) {
+    std::type_index type(typeid(handler));
+    auto it = handler_stats_.find(type);
+    if (it != handler_stats_.end()) {
+        return it->second.get();
+    }
     
-    total_timers_++;
+    // 每种类型只在第一次注册时还原一次类型名
+    auto stats = std::make_unique<HandlerStats>();
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    stats->type = status == 0 && demangled ? demangled : type.name();
+    std::free(demangled);
     
-    return timer_id;
+    HandlerStats* result = stats.get();
+    handler_stats_.emplace(type, std::move(stats));
+    return result;
+}
+
+uint64_t EpollEventLoop::add_timer(uint64_t delay, std::shared_ptr<Timer> timer) {
+    return add_timer(std::chrono::milliseconds(delay), std::move(timer));
+}
+
+uint64_t EpollEventLoop::add_timer(std::chrono::microseconds delay, std::shared_ptr<Timer> timer,
+                                   std::chrono::microseconds interval) {
+    return core_.add_timer(delay, std::move(timer), interval);
 }
 
 void EpollEventLoop::cancel_timer(uint64_t timer_id) {
-    std::lock_guard<std::mutex> lock(timer_mutex_);
-    
-    // 查找并标记定时器为已取消
-    for (auto& timer : timers_) {
-        if (timer.id == timer_id) {
-            timer.canceled = true;
-            break;
-        }
-    }
+    core_.cancel_timer(timer_id);
+}
+
+bool EpollEventLoop::reschedule_timer(uint64_t timer_id, std::chrono::microseconds delay) {
+    return core_.reschedule_timer(timer_id, delay);
+}
+
+void EpollEventLoop::run_in_loop(Functor f) {
+    core_.run_in_loop(std::move(f));
+}
+
+void EpollEventLoop::queue_in_loop(Functor f) {
+    core_.queue_in_loop(std::move(f));
+}
+
+bool EpollEventLoop::is_in_loop_thread() const {
+    return core_.is_in_loop_thread();
 }
 
 void EpollEventLoop::run() {
@@ -136,14 +206,17 @@ void EpollEventLoop::run() {
         return; // 已经在运行
     }
     
-    stopped_ = false;
+    core_.set_loop_thread(std::this_thread::get_id());
     
     std::cout << "Epoll event loop started..." << std::endl;
     
+    // 停止请求在run()退出时才清除：在线程进入run()之前调用的stop()同样生效
     while (!stopped_) {
         handle_events();
     }
     
+    core_.set_loop_thread(std::thread::id());
+    stopped_ = false;
     running_ = false;
     std::cout << "Epoll event loop stopped." << std::endl;
 }
@@ -151,8 +224,10 @@ void EpollEventLoop::run() {
 void EpollEventLoop::stop() {
     stopped_ = true;
     
-    // 通知定时器线程
-    timer_cv_.notify_one();
+    // 从其他线程停止时唤醒epoll_wait，不必等到超时
+    if (!core_.is_in_loop_thread()) {
+        core_.wakeup();
+    }
 }
 
 bool EpollEventLoop::is_running() const {
@@ -160,8 +235,13 @@ bool EpollEventLoop::is_running() const {
 }
 
 std::string EpollEventLoop::get_stats() const {
-    std::lock_guard<std::mutex> fd_lock(const_cast<std::mutex&>(fd_mutex_));
-    std::lock_guard<std::mutex> timer_lock(const_cast<std::mutex&>(timer_mutex_));
+    // 两个锁分别只持有到读出计数为止，格式化在锁外进行
+    size_t active_fds = fd_slots_.active_count();
+    size_t active_timers = core_.timer_count();
+    
+    Log2Histogram::Snapshot batch = events_per_wakeup_.snapshot();
+    Log2Histogram::Snapshot delay = dispatch_delay_.snapshot();
+    Log2Histogram::Snapshot lateness = core_.timer_lateness().snapshot();
     
     std::stringstream ss;
     ss << "EpollEventLoop Stats:\n"
@@ -169,26 +249,90 @@ std::string EpollEventLoop::get_stats() const {
        << "  Epoll FD: " << epoll_fd_ << "\n"
        << "  Max Events: " << max_events_ << "\n"
        << "  Timeout: " << timeout_ << "ms\n"
-       << "  Active FDs: " << fd_map_.size() << "\n"
-       << "  Active Timers: " << timers_.size() << "\n"
+       << "  Active FDs: " << active_fds << "\n"
+       << "  Active Timers: " << active_timers << "\n"
        << "  Total Events: " << total_events_.load() << "\n"
-       << "  Total Timers: " << total_timers_.load();
+       << "  Total Timers: " << core_.total_timers() << "\n"
+       << "  Total Functors: " << core_.total_functors() << "\n"
+       << "  Wakeups: " << core_.total_wakeups() << "\n"
+       << "  Iterations: " << iterations_.load(std::memory_order_relaxed) << "\n"
+       << "  Events/Wakeup (mean/max): " << batch.mean() << "/" << batch.max << "\n"
+       << "  Dispatch Delay p99: " << delay.percentile(99) / 1000 << "us\n"
+       << "  Timer Lateness p99: " << lateness.percentile(99) / 1000 << "us\n"
+       << "  Slow Calls: " << core_.slow_calls();
     
     return ss.str();
 }
 
-int EpollEventLoop::create_tcp_server(int port, std::shared_ptr<EventHandler> accept_handler) {
+LoopMetrics EpollEventLoop::get_metrics() const {
+    LoopMetrics metrics;
+    metrics.iterations = iterations_.load(std::memory_order_relaxed);
+    metrics.events_per_wakeup = events_per_wakeup_.snapshot();
+    metrics.dispatch_delay_ns = dispatch_delay_.snapshot();
+    metrics.timer_lateness_ns = core_.timer_lateness().snapshot();
+    metrics.functor_time_ns = core_.functor_time().snapshot();
+    metrics.slow_calls = core_.slow_calls();
+    
+    // 统计对象创建后地址不变，锁内只收集指针
+    std::vector<const HandlerStats*> handlers;
+    {
+        std::lock_guard<std::mutex> lock(fd_slots_.mutex());
+        handlers.reserve(handler_stats_.size());
+        for (const auto& entry : handler_stats_) {
+            handlers.push_back(entry.second.get());
+        }
+    }
+    for (const HandlerStats* stats : handlers) {
+        metrics.handler_time_ns.push_back({stats->type, stats->time_ns.snapshot()});
+    }
+    return metrics;
+}
+
+void EpollEventLoop::set_slow_handler_callback(std::chrono::microseconds threshold, SlowHandlerCallback callback) {
+    core_.set_slow_handler_callback(threshold, std::move(callback));
+}
+
+int EpollEventLoop::create_tcp_server(int port, std::shared_ptr<EventHandler> accept_handler,
+                                      int backlog, bool reuse_port) {
+    int server_fd = create_listen_socket(port, backlog, reuse_port);
+    
+    // 添加到epoll
+    try {
+        add_fd(server_fd, EPOLLIN, accept_handler);
+    } catch (...) {
+        close(server_fd);
+        throw;
+    }
+    
+    std::cout << "TCP server started on port " << port << std::endl;
+    return server_fd;
+}
+
+int EpollEventLoop::create_listen_socket(int port, int backlog, bool reuse_port) {
     // 创建socket
-    int server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (server_fd == -1) {
         throw epoll_event_loop_exception("Failed to create server socket: " + std::string(strerror(errno)));
     }
     
-    // 设置重用地址
-    set_reuseaddr(server_fd);
+    try {
+        // 设置重用地址
+        set_reuseaddr(server_fd);
+        
+        if (reuse_port) {
+            int opt = 1;
+            if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
+                throw epoll_event_loop_exception("Failed to set SO_REUSEPORT: " + std::string(strerror(errno)));
+            }
+        }
+    } catch (...) {
+        close(server_fd);
+        throw;
+    }
     
     // 绑定地址
     struct sockaddr_in server_addr;
+    std::memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
     server_addr.sin_port = htons(port);
@@ -199,18 +343,23 @@ int EpollEventLoop::create_tcp_server(int port, std::shared_ptr<EventHandler> ac
     }
     
     // 开始监听
-    if (listen(server_fd, 128) == -1) {
+    if (listen(server_fd, backlog) == -1) {
         close(server_fd);
         throw epoll_event_loop_exception("Failed to listen on server socket: " + std::string(strerror(errno)));
     }
     
-    // 添加到epoll
-    add_fd(server_fd, EPOLLIN, accept_handler);
-    
-    std::cout << "TCP server started on port " << port << std::endl;
     return server_fd;
 }
 
+int EpollEventLoop::get_local_port(int fd) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr*)&addr, &len) == -1) {
+        throw epoll_event_loop_exception("Failed to get socket name: " + std::string(strerror(errno)));
+    }
+    return ntohs(addr.sin_port);
+}
+
 int EpollEventLoop::create_tcp_client(const std::string& ip, int port, std::shared_ptr<EventHandler> connect_handler) {
     // 创建socket
     int client_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
@@ -288,21 +437,46 @@ void EpollEventLoop::handle_events() {
     
     total_events_ += nfds;
     
-    // 处理事件
+    // 每批读一次时钟作为起点，之后每个处理器结束时读一次，作为下一个处理器的开始时间
+    auto wake_time = std::chrono::steady_clock::now();
+    auto call_start = wake_time;
+    iterations_.store(iterations_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    events_per_wakeup_.record(static_cast<uint64_t>(nfds));
+    
+    bool timers_due = false;
+    bool functors_due = false;
+    
+    // 处理事件：按代数校验后直接通过槽位分发，不加锁、不查哈希表、不增减引用计数。
+    // 代数与处理器是两个独立的原子变量，按seqlock方式在读取处理器前后各校验一次代数，
+    // 避免其他线程在两次读取之间remove_fd + add_fd复用同一fd时，把旧事件分发给新处理器
     for (int i = 0; i < nfds; ++i) {
-        int fd = events_[i].data.fd;
+        uint64_t data = events_[i].data.u64;
+        int fd = static_cast<int>(static_cast<uint32_t>(data));
+        uint32_t generation = static_cast<uint32_t>(data >> 32);
         uint32_t events = events_[i].events;
         
-        std::shared_ptr<EventHandler> handler;
-        {
-            std::lock_guard<std::mutex> lock(fd_mutex_);
-            auto it = fd_map_.find(fd);
-            if (it != fd_map_.end()) {
-                handler = it->second.handler;
-            }
+        if (fd == core_.timer_fd()) {
+            timers_due = true;
+            continue;
+        }
+        if (fd == core_.wakeup_fd()) {
+            functors_due = true;
+            continue;
+        }
+        
+        FdSlot* slot = fd_slots_.find(fd);
+        if (!slot || slot->generation.load(std::memory_order_acquire) != generation) {
+            continue; // fd已被移除或复用，丢弃旧事件
+        }
+        EventHandler* handler = slot->handler.load(std::memory_order_acquire);
+        if (slot->generation.load(std::memory_order_acquire) != generation) {
+            continue; // 读取处理器期间槽位被重新发布
         }
         
         if (handler) {
+            HandlerStats* stats = slot->stats.load(std::memory_order_relaxed);
+            dispatch_delay_.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(call_start - wake_time).count()));
             try {
                 if (events & (EPOLLERR | EPOLLHUP)) {
                     handler->handle_error(fd, "Socket error or hangup");
@@ -312,56 +486,21 @@ void EpollEventLoop::handle_events() {
             } catch (const std::exception& e) {
                 std::cerr << "Error handling event for fd " << fd << ": " << e.what() << std::endl;
             }
+            call_start = core_.finish_call(call_start, stats ? &stats->time_ns : nullptr, fd,
+                                     stats ? stats->type.c_str() : "unknown");
         }
     }
-}
-
-void EpollEventLoop::handle_timers() {
-    while (!stopped_) {
-        std::unique_lock<std::mutex> lock(timer_mutex_);
-        
-        if (timers_.empty()) {
-            timer_cv_.wait(lock, [this] { return stopped_ || !timers_.empty(); });
-            continue;
-        }
-        
-        // 计算等待时间
-        uint64_t current_time = get_current_time_ms();
-        uint64_t next_expire = timers_.front().expire_time;
-        
-        if (current_time >= next_expire) {
-            check_timer_timeout();
-        } else {
-            timer_cv_.wait_for(lock, std::chrono::milliseconds(next_expire - current_time));
-        }
-    }
-}
-
-void EpollEventLoop::check_timer_timeout() {
-    uint64_t current_time = get_current_time_ms();
     
-    while (!timers_.empty() && timers_.front().expire_time <= current_time) {
-        TimerItem timer = timers_.front();
-        std::pop_heap(timers_.begin(), timers_.end());
-        timers_.pop_back();
-        
-        if (!timer.canceled) {
-            try {
-                timer.timer->on_timeout();
-            } catch (const std::exception& e) {
-                std::cerr << "Error in timer callback: " << e.what() << std::endl;
-            }
-        }
+    fd_slots_.release_retired();
+    
+    // 定时器和投递的任务在本批IO事件处理完之后执行
+    if (timers_due) {
+        core_.handle_timers();
     }
-}
-
-uint64_t EpollEventLoop::generate_timer_id() {
-    return next_timer_id_++;
-}
-
-uint64_t EpollEventLoop::get_current_time_ms() {
-    auto now = std::chrono::steady_clock::now();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+    if (functors_due) {
+        core_.run_pending_functors();
+    }
+    core_.run_local_functors();
 }
 
 } // namespace impl
\ No newline at end of file
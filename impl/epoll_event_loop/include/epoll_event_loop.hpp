@@ -1,33 +1,29 @@
 #pragma once
 
 #include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
 #include <functional>
-#include <unordered_map>
 #include <vector>
 #include <memory>
 #include <chrono>
 #include <atomic>
 #include <mutex>
-#include <condition_variable>
 #include <thread>
 #include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
 #include <cstring>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include "loop_core.hpp"
 
 namespace impl {
 
-/**
- * @brief epoll事件循环异常类
- */
-class epoll_event_loop_exception : public std::runtime_error {
-public:
-    explicit epoll_event_loop_exception(const std::string& msg) : std::runtime_error(msg) {}
-};
-
 /**
  * @brief 事件类型枚举
  */
@@ -66,13 +62,20 @@ public:
  * 特点：
  * - 基于epoll的高效IO多路复用
  * - 支持边缘触发和水平触发模式
- * - 内置定时器管理
+ * - 内置分层时间轮定时器，O(1)添加/取消/重新调度，微秒级精度
+ * - 定时器由注册在同一epoll实例中的timerfd驱动，回调与IO处理器都在循环线程上执行
+ * - 其他线程可通过 run_in_loop/queue_in_loop 把任务投递到循环线程（无锁队列 + eventfd唤醒）
+ * - fd槽位表、定时器与跨线程投递由 FdSlotTable 和 LoopCore 实现，与 IoUringEventLoop 共用
+ * - 内置运行时指标：每批事件数、分发延迟、按处理器类型的执行时间、定时器触发延迟，可选慢处理器回调
  * - 线程安全的事件处理
  * - 支持TCP/UDP网络编程
  * - 异步IO处理能力
  */
 class EpollEventLoop {
 public:
+    using Functor = std::function<void()>;
+    using SlowHandlerCallback = std::function<void(const SlowHandlerInfo&)>;
+    
     /**
      * @brief 构造函数
      * @param max_events 最大事件数
@@ -109,18 +112,59 @@ public:
     
     /**
      * @brief 添加定时器
+     * 
+     * 可以从任意线程调用；回调总是在运行run()的循环线程上、两批IO事件之间执行。
      * @param delay 延迟时间（毫秒）
      * @param timer 定时器对象
      * @return 定时器ID
      */
     uint64_t add_timer(uint64_t delay, std::shared_ptr<Timer> timer);
     
+    /**
+     * @brief 添加定时器（微秒精度，可选周期）
+     * @param delay 延迟时间
+     * @param timer 定时器对象
+     * @param interval 周期间隔，0表示一次性定时器；周期定时器需调用cancel_timer停止
+     * @return 定时器ID
+     */
+    uint64_t add_timer(std::chrono::microseconds delay, std::shared_ptr<Timer> timer,
+                       std::chrono::microseconds interval = std::chrono::microseconds(0));
+    
     /**
      * @brief 取消定时器
      * @param timer_id 定时器ID
      */
     void cancel_timer(uint64_t timer_id);
     
+    /**
+     * @brief 重新设置定时器的到期时间，适合连接空闲超时这类频繁推迟的定时器
+     * @param timer_id 定时器ID
+     * @param delay 从现在起的新延迟
+     * @return 定时器仍然存在时返回true
+     */
+    bool reschedule_timer(uint64_t timer_id, std::chrono::microseconds delay);
+    
+    /**
+     * @brief 在循环线程上执行任务
+     * 
+     * 当前就在循环线程上时立即执行，否则投递到队列，由循环线程在本批事件处理完后执行。
+     * @param f 任务
+     */
+    void run_in_loop(Functor f);
+    
+    /**
+     * @brief 把任务投递到循环线程，总是延迟到本批事件处理完后执行
+     * 
+     * 可以从任意线程调用，同一批投递只产生一次eventfd写入。
+     * @param f 任务
+     */
+    void queue_in_loop(Functor f);
+    
+    /**
+     * @brief 检查当前线程是否是正在运行run()的循环线程
+     */
+    bool is_in_loop_thread() const;
+    
     /**
      * @brief 启动事件循环
      */
@@ -128,6 +172,8 @@ public:
     
     /**
      * @brief 停止事件循环
+     * 
+     * 可以从任意线程调用；在run()开始之前调用时，下一次run()会立即返回。
      */
     void stop();
     
@@ -139,20 +185,60 @@ public:
     
     /**
      * @brief 获取统计信息
+     * 
+     * 计数在各自的锁内读取，格式化在锁外进行，不会阻塞fd注册和定时器操作。
      * @return 统计信息字符串
      */
     std::string get_stats() const;
     
+    /**
+     * @brief 获取运行时指标快照
+     * 
+     * 指标只由循环线程写入（每批事件读一次时钟，每个处理器再读一次），可以从任意线程读取。
+     */
+    LoopMetrics get_metrics() const;
+    
+    /**
+     * @brief 设置慢处理器回调
+     * 
+     * IO处理器、定时器回调或投递任务单次执行超过阈值时，在循环线程上回调，用于定位阻塞循环的处理器。
+     * 可以从任意线程调用，设置在循环线程上生效。
+     * @param threshold 阈值，0表示关闭
+     * @param callback 回调
+     */
+    void set_slow_handler_callback(std::chrono::microseconds threshold, SlowHandlerCallback callback);
+    
     /**
      * @brief 创建TCP服务器
      * @param port 端口号
      * @param accept_handler 接受连接处理器
+     * @param backlog 监听队列长度
+     * @param reuse_port 是否设置SO_REUSEPORT，允许多个监听socket绑定同一端口
      * @return 监听socket文件描述符
      */
-    int create_tcp_server(int port, std::shared_ptr<EventHandler> accept_handler);
+    int create_tcp_server(int port, std::shared_ptr<EventHandler> accept_handler,
+                          int backlog = 128, bool reuse_port = false);
+    
+    /**
+     * @brief 创建非阻塞的TCP监听socket（不添加到epoll）
+     * @param port 端口号，0表示由内核分配
+     * @param backlog 监听队列长度
+     * @param reuse_port 是否设置SO_REUSEPORT
+     * @return 监听socket文件描述符
+     */
+    static int create_listen_socket(int port, int backlog, bool reuse_port);
+    
+    /**
+     * @brief 获取socket绑定的本地端口
+     * @param fd socket文件描述符
+     * @return 端口号（主机字节序）
+     */
+    static int get_local_port(int fd);
     
     /**
      * @brief 创建TCP客户端
+     * 
+     * 只发起非阻塞连接并注册处理器，不判断连接结果；需要成功/失败/超时回调时使用 Connector。
      * @param ip 目标IP地址
      * @param port 目标端口
      * @param connect_handler 连接处理器
@@ -185,75 +271,65 @@ public:
 
 private:
     /**
-     * @brief 定时器项结构
+     * @brief 一种处理器类型的执行时间统计，创建后不再释放，地址保持稳定
      */
-    struct TimerItem {
-        uint64_t id;
-        uint64_t expire_time;
-        std::shared_ptr<Timer> timer;
-        bool canceled;
-        
-        bool operator<(const TimerItem& other) const {
-            return expire_time > other.expire_time; // 小顶堆
-        }
+    struct HandlerStats {
+        std::string type;
+        Log2Histogram time_ns;
     };
     
     /**
-     * @brief 文件描述符信息结构
+     * @brief 文件描述符槽位
+     *
+     * 循环线程分发事件时只读取 handler、generation 和 stats 三个原子字段，不加锁；
+     * 其余字段只在持有槽位表的锁时访问。generation 在每次添加和移除时递增，
+     * 并编码进 epoll_event.data，用于丢弃fd被关闭后复用时残留的旧事件。
      */
-    struct FdInfo {
-        std::shared_ptr<EventHandler> handler;
-        uint32_t events;
-        bool is_et;
+    struct FdSlot {
+        std::atomic<EventHandler*> handler{nullptr};
+        std::atomic<uint32_t> generation{0};
+        std::atomic<HandlerStats*> stats{nullptr}; // 处理器类型的执行时间统计
+        std::shared_ptr<EventHandler> owner;     // 持有处理器的生命周期
+        uint32_t events = 0;
+        bool is_et = false;
+        bool active = false;
     };
     
     /**
-     * @brief 处理epoll事件
+     * @brief 编码epoll_event.data：高32位为代数，低32位为fd
      */
-    void handle_events();
-    
-    /**
-     * @brief 处理定时器
-     */
-    void handle_timers();
-    
-    /**
-     * @brief 检查定时器超时
-     */
-    void check_timer_timeout();
+    static uint64_t make_event_data(int fd, uint32_t generation) {
+        return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+    }
     
     /**
-     * @brief 生成定时器ID
-     * @return 新的定时器ID
+     * @brief 查找或创建处理器类型对应的统计（调用时需持有槽位表的锁）
      */
-    uint64_t generate_timer_id();
+    HandlerStats* stats_for(const EventHandler& handler);
     
     /**
-     * @brief 获取当前时间戳（毫秒）
-     * @return 当前时间戳
+     * @brief 处理epoll事件
      */
-    static uint64_t get_current_time_ms();
+    void handle_events();
     
     int epoll_fd_;                           // epoll文件描述符
     int max_events_;                         // 最大事件数
     int timeout_;                            // 超时时间
     std::unique_ptr<epoll_event[]> events_;  // 事件数组
     
-    std::unordered_map<int, FdInfo> fd_map_; // 文件描述符映射
-    std::mutex fd_mutex_;                     // 文件描述符映射互斥锁
-    
-    std::vector<TimerItem> timers_;          // 定时器堆
-    std::mutex timer_mutex_;                 // 定时器互斥锁
-    std::condition_variable timer_cv_;       // 定时器条件变量
+    FdSlotTable<FdSlot> fd_slots_;            // 按fd索引的槽位表
+    std::unordered_map<std::type_index, std::unique_ptr<HandlerStats>> handler_stats_; // 按处理器类型的统计（由槽位表的锁保护）
+    LoopCore core_;                           // 定时器、跨线程投递与执行时间统计
     
     std::atomic<bool> running_;              // 运行标志
     std::atomic<bool> stopped_;              // 停止标志
-    std::atomic<uint64_t> next_timer_id_;    // 下一个定时器ID
     
     std::atomic<uint64_t> total_events_;     // 总事件数
-    std::atomic<uint64_t> total_timers_;     // 总定时器数
     
-    std::thread timer_thread_;               // 定时器线程
+    // 运行时指标（仅循环线程写入）
+    std::atomic<uint64_t> iterations_;       // 返回了事件的epoll_wait次数
+    Log2Histogram events_per_wakeup_;        // 每批事件数
+    Log2Histogram dispatch_delay_;           // epoll_wait返回到处理器开始执行（纳秒）
 };
 
 /**
@@ -0,0 +1,245 @@
+#include "event_loop_group.hpp"
+#include <iostream>
+#include <sstream>
+
+namespace impl {
+
+/**
+ * @brief 监听socket的事件处理器
+ *
+ * 边缘触发：每次可读事件循环调用accept4直到EAGAIN。fd耗尽（EMFILE/ENFILE）时
+ * 临时释放预留的fd接受并立即关闭一个连接，避免监听队列堆积导致边缘触发不再通知。
+ */
+class EventLoopGroup::Acceptor : public EventHandler,
+                                  public std::enable_shared_from_this<EventLoopGroup::Acceptor> {
+public:
+    /**
+     * @param group 所属的事件循环组
+     * @param owner 连接所属的循环；为nullptr时按轮询顺序分发
+     * @param callback 新连接回调
+     */
+    Acceptor(EventLoopGroup& group, EpollEventLoop* owner, ConnectionCallback callback)
+        : group_(group)
+        , owner_(owner)
+        , callback_(std::move(callback))
+        , idle_fd_(open("/dev/null", O_RDONLY | O_CLOEXEC)) {}
+
+    ~Acceptor() override {
+        if (idle_fd_ != -1) {
+            close(idle_fd_);
+        }
+    }
+
+    void handle_event(int fd, uint32_t events) override {
+        (void)events;
+
+        while (true) {
+            int conn_fd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (conn_fd == -1) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) {
+                    continue;
+                }
+                if ((errno == EMFILE || errno == ENFILE) && shed_connection(fd)) {
+                    continue;
+                }
+                std::cerr << "accept4 failed on fd " << fd << ": " << strerror(errno) << std::endl;
+                break;
+            }
+
+            group_.accepted_++;
+            if (owner_) {
+                dispatch(*owner_, conn_fd);
+            } else {
+                hand_off(group_.next_loop(), conn_fd);
+            }
+        }
+    }
+
+    void handle_error(int fd, const std::string& error) override {
+        std::cerr << "Listen socket " << fd << " error: " << error << std::endl;
+    }
+
+private:
+    /**
+     * @brief 待交接的连接，任务未执行就被销毁时关闭fd
+     */
+    struct PendingConnection {
+        int fd;
+        explicit PendingConnection(int f) : fd(f) {}
+        ~PendingConnection() {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    };
+
+    void dispatch(EpollEventLoop& loop, int conn_fd) {
+        try {
+            callback_(loop, conn_fd);
+        } catch (const std::exception& e) {
+            std::cerr << "Error in connection callback for fd " << conn_fd << ": " << e.what() << std::endl;
+        }
+    }
+
+    void hand_off(EpollEventLoop& loop, int conn_fd) {
+        auto pending = std::make_shared<PendingConnection>(conn_fd);
+        auto self = shared_from_this();
+        loop.queue_in_loop([self, &loop, pending]() {
+            int fd = pending->fd;
+            pending->fd = -1;
+            self->dispatch(loop, fd);
+        });
+    }
+
+    bool shed_connection(int listen_fd) {
+        if (idle_fd_ == -1) {
+            return false;
+        }
+        close(idle_fd_);
+        int conn_fd = accept(listen_fd, nullptr, nullptr);
+        if (conn_fd != -1) {
+            close(conn_fd);
+        }
+        idle_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        return conn_fd != -1;
+    }
+
+    EventLoopGroup& group_;
+    EpollEventLoop* owner_;
+    ConnectionCallback callback_;
+    int idle_fd_;                 // 预留的fd，fd耗尽时用于丢弃连接
+};
+
+EventLoopGroup::EventLoopGroup(size_t loop_count, int max_events, int timeout)
+    : max_events_(max_events)
+    , timeout_(timeout)
+    , next_index_(0)
+    , accepted_(0)
+    , running_(false) {
+
+    if (loop_count == 0) {
+        loop_count = std::thread::hardware_concurrency();
+        if (loop_count == 0) {
+            loop_count = 1;
+        }
+    }
+
+    loops_.reserve(loop_count);
+    for (size_t i = 0; i < loop_count; ++i) {
+        loops_.push_back(std::make_unique<EpollEventLoop>(max_events_, timeout_));
+    }
+}
+
+EventLoopGroup::~EventLoopGroup() {
+    stop();
+
+    for (int fd : listen_fds_) {
+        close(fd);
+    }
+}
+
+void EventLoopGroup::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+
+    for (auto& loop : loops_) {
+        start_loop(*loop);
+    }
+    if (acceptor_loop_) {
+        start_loop(*acceptor_loop_);
+    }
+}
+
+void EventLoopGroup::stop() {
+    if (!running_) {
+        return;
+    }
+
+    // 先停止接受新连接，再停止I/O循环
+    if (acceptor_loop_) {
+        acceptor_loop_->stop();
+    }
+    for (auto& loop : loops_) {
+        loop->stop();
+    }
+
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+    running_ = false;
+}
+
+int EventLoopGroup::listen(int port, ConnectionCallback on_connection, AcceptMode mode, int backlog) {
+    if (mode == AcceptMode::REUSE_PORT) {
+        // 每个循环一个监听socket；端口为0时以第一个socket分配到的端口为准
+        for (auto& loop : loops_) {
+            int fd = EpollEventLoop::create_listen_socket(port, backlog, true);
+            listen_fds_.push_back(fd);
+            if (port == 0) {
+                port = EpollEventLoop::get_local_port(fd);
+            }
+
+            auto acceptor = std::make_shared<Acceptor>(*this, loop.get(), on_connection);
+            acceptors_.push_back(acceptor);
+            loop->add_fd(fd, EPOLLIN, acceptor, true);
+        }
+    } else {
+        if (!acceptor_loop_) {
+            acceptor_loop_ = std::make_unique<EpollEventLoop>(max_events_, timeout_);
+            if (running_) {
+                start_loop(*acceptor_loop_);
+            }
+        }
+
+        int fd = EpollEventLoop::create_listen_socket(port, backlog, false);
+        listen_fds_.push_back(fd);
+        if (port == 0) {
+            port = EpollEventLoop::get_local_port(fd);
+        }
+
+        auto acceptor = std::make_shared<Acceptor>(*this, nullptr, std::move(on_connection));
+        acceptors_.push_back(acceptor);
+        acceptor_loop_->add_fd(fd, EPOLLIN, acceptor, true);
+    }
+
+    return port;
+}
+
+EpollEventLoop& EventLoopGroup::loop(size_t index) {
+    if (index >= loops_.size()) {
+        throw epoll_event_loop_exception("Event loop index out of range: " + std::to_string(index));
+    }
+    return *loops_[index];
+}
+
+EpollEventLoop& EventLoopGroup::next_loop() {
+    size_t index = next_index_.fetch_add(1, std::memory_order_relaxed);
+    return *loops_[index % loops_.size()];
+}
+
+std::string EventLoopGroup::get_stats() const {
+    std::stringstream ss;
+    ss << "EventLoopGroup Stats:\n"
+       << "  Running: " << (running_ ? "Yes" : "No") << "\n"
+       << "  Loops: " << loops_.size() << "\n"
+       << "  Dedicated Acceptor: " << (acceptor_loop_ ? "Yes" : "No") << "\n"
+       << "  Listen Sockets: " << listen_fds_.size() << "\n"
+       << "  Accepted Connections: " << accepted_.load();
+    return ss.str();
+}
+
+void EventLoopGroup::start_loop(EpollEventLoop& loop) {
+    threads_.emplace_back([&loop]() {
+        loop.run();
+    });
+}
+
+} // namespace impl
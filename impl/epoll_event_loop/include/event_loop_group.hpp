@@ -0,0 +1,123 @@
+#pragma once
+
+#include "epoll_event_loop.hpp"
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace impl {
+
+/**
+ * @brief 多Reactor事件循环组
+ *
+ * 特点：
+ * - N个 EpollEventLoop 分别运行在N个线程上，网络处理可以扩展到多个CPU核
+ * - 两种接受连接方式：
+ *   - REUSE_PORT：每个循环拥有一个设置了SO_REUSEPORT的监听socket，由内核在循环之间分配连接
+ *   - ACCEPTOR：一个专用的接受线程负责accept，按轮询方式通过 queue_in_loop 把连接交给各个循环
+ * - 监听socket使用边缘触发，每次可读事件批量调用accept4直到EAGAIN
+ * - 监听队列长度可配置
+ */
+class EventLoopGroup {
+public:
+    /**
+     * @brief 接受连接的方式
+     */
+    enum class AcceptMode {
+        REUSE_PORT,   ///< 每个循环一个SO_REUSEPORT监听socket
+        ACCEPTOR      ///< 专用接受线程 + 轮询分发
+    };
+
+    /**
+     * @brief 新连接回调
+     *
+     * 参数为连接所属的事件循环和已设置为非阻塞的连接fd。
+     * 回调负责把fd添加到该循环（通常调用 loop.add_fd）或关闭它。
+     */
+    using ConnectionCallback = std::function<void(EpollEventLoop& loop, int fd)>;
+
+    /**
+     * @brief 构造函数
+     * @param loop_count 事件循环数量（0表示使用硬件并发数）
+     * @param max_events 每个循环的最大事件数
+     * @param timeout 每个循环的epoll_wait超时时间（毫秒）
+     */
+    explicit EventLoopGroup(size_t loop_count = 0, int max_events = 1024, int timeout = 100);
+
+    /**
+     * @brief 析构函数，停止所有循环并关闭监听socket
+     */
+    ~EventLoopGroup();
+
+    /**
+     * @brief 在各自的线程上启动所有事件循环
+     */
+    void start();
+
+    /**
+     * @brief 停止所有事件循环并等待线程结束
+     */
+    void stop();
+
+    /**
+     * @brief 检查事件循环组是否已启动
+     */
+    bool is_running() const { return running_; }
+
+    /**
+     * @brief 监听TCP端口
+     *
+     * 两种模式下回调都在连接所属的循环线程上执行。
+     * @param port 端口号，0表示由内核分配
+     * @param on_connection 新连接回调
+     * @param mode 接受连接的方式
+     * @param backlog 监听队列长度
+     * @return 实际监听的端口号
+     */
+    int listen(int port, ConnectionCallback on_connection,
+               AcceptMode mode = AcceptMode::REUSE_PORT, int backlog = SOMAXCONN);
+
+    /**
+     * @brief 获取事件循环数量
+     */
+    size_t size() const { return loops_.size(); }
+
+    /**
+     * @brief 获取指定的事件循环
+     * @param index 循环下标
+     */
+    EpollEventLoop& loop(size_t index);
+
+    /**
+     * @brief 按轮询顺序获取下一个事件循环
+     */
+    EpollEventLoop& next_loop();
+
+    /**
+     * @brief 获取统计信息
+     */
+    std::string get_stats() const;
+
+    // 禁用拷贝构造和拷贝赋值
+    EventLoopGroup(const EventLoopGroup&) = delete;
+    EventLoopGroup& operator=(const EventLoopGroup&) = delete;
+
+private:
+    class Acceptor;
+
+    void start_loop(EpollEventLoop& loop);
+
+    int max_events_;
+    int timeout_;
+    std::vector<std::unique_ptr<EpollEventLoop>> loops_;   // I/O循环
+    std::unique_ptr<EpollEventLoop> acceptor_loop_;        // ACCEPTOR模式的接受循环（按需创建）
+    std::vector<std::thread> threads_;                     // 循环线程
+    std::vector<int> listen_fds_;                          // 所有监听socket
+    std::vector<std::shared_ptr<Acceptor>> acceptors_;     // 接受连接处理器
+    std::atomic<size_t> next_index_;                       // 轮询下标
+    std::atomic<uint64_t> accepted_;                       // 已接受的连接数
+    bool running_;
+};
+
+} // namespace impl
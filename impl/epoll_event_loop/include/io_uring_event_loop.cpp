@@ -0,0 +1,932 @@
+#include "io_uring_event_loop.hpp"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace impl {
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+} // namespace
+
+/**
+ * @brief accept_multishot 的注册对象
+ *
+ * io_uring后端下由完成事件直接交付新连接；epoll后端下作为普通处理器，可读时批量accept4。
+ */
+class IoUringEventLoop::AcceptOperation : public EventHandler {
+public:
+    explicit AcceptOperation(AcceptCallback callback) : callback_(std::move(callback)) {}
+
+    void deliver(int listen_fd, int conn_fd) {
+        try {
+            callback_(listen_fd, conn_fd);
+        } catch (const std::exception& e) {
+            std::cerr << "Error in accept callback for fd " << listen_fd << ": " << e.what() << std::endl;
+        }
+    }
+
+    void handle_event(int fd, uint32_t events) override {
+        (void)events;
+        while (true) {
+            int conn_fd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (conn_fd == -1) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    std::cerr << "accept4 failed on fd " << fd << ": " << strerror(errno) << std::endl;
+                }
+                break;
+            }
+            deliver(fd, conn_fd);
+        }
+    }
+
+    void handle_error(int fd, const std::string& error) override {
+        std::cerr << "Listen socket " << fd << " error: " << error << std::endl;
+    }
+
+private:
+    AcceptCallback callback_;
+};
+
+/**
+ * @brief recv_multishot 的注册对象
+ *
+ * io_uring后端下数据位于内核挑选的缓冲区中；epoll后端下每次可读事件recv一次到栈上缓冲区。
+ */
+class IoUringEventLoop::RecvOperation : public EventHandler {
+public:
+    RecvOperation(EpollEventLoop* epoll, RecvCallback callback)
+        : epoll_(epoll), callback_(std::move(callback)) {}
+
+    void deliver(int fd, const char* data, ssize_t len) {
+        try {
+            callback_(fd, data, len);
+        } catch (const std::exception& e) {
+            std::cerr << "Error in recv callback for fd " << fd << ": " << e.what() << std::endl;
+        }
+    }
+
+    void handle_event(int fd, uint32_t events) override {
+        (void)events;
+        char buffer[buffer_size];
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            deliver(fd, buffer, n);
+        } else if (n == 0) {
+            finish(fd, 0);
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            finish(fd, -errno);
+        }
+    }
+
+    void handle_error(int fd, const std::string& error) override {
+        (void)error;
+        handle_event(fd, EPOLLIN);
+    }
+
+private:
+    void finish(int fd, ssize_t result) {
+        try {
+            epoll_->remove_fd(fd);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to remove fd " << fd << ": " << e.what() << std::endl;
+        }
+        deliver(fd, nullptr, result);
+    }
+
+    EpollEventLoop* epoll_;
+    RecvCallback callback_;
+};
+
+IoUringEventLoop::IoUringEventLoop(int max_events, int timeout, Backend backend, unsigned queue_depth)
+    : max_events_(max_events)
+    , timeout_(timeout)
+    , ring_fd_(-1)
+    , sq_ring_(MAP_FAILED)
+    , sq_ring_size_(0)
+    , cq_ring_(MAP_FAILED)
+    , cq_ring_size_(0)
+    , sqes_(nullptr)
+    , sqes_size_(0)
+    , sq_head_(nullptr)
+    , sq_tail_(nullptr)
+    , sq_mask_(nullptr)
+    , sq_flags_(nullptr)
+    , sq_array_(nullptr)
+    , sq_entries_(0)
+    , cq_head_(nullptr)
+    , cq_tail_(nullptr)
+    , cq_mask_(nullptr)
+    , cqes_(nullptr)
+    , sq_local_tail_(0)
+    , to_submit_(0)
+    , buf_ring_(nullptr)
+    , buf_ring_size_(0)
+    , buf_ring_tail_(0)
+    , running_(false)
+    , stopped_(false)
+    , total_events_(0)
+    , total_submissions_(0)
+    , total_enters_(0) {
+
+    bool supported = backend != Backend::EPOLL && is_supported();
+    if (backend == Backend::EPOLL || (backend == Backend::AUTO && !supported)) {
+        epoll_ = std::make_unique<EpollEventLoop>(max_events, timeout);
+        return;
+    }
+    if (!supported) {
+        throw epoll_event_loop_exception("io_uring is not supported by this kernel");
+    }
+
+    try {
+        setup_ring(queue_depth);
+        setup_buffer_ring();
+        setup_fixed_files();
+        core_ = std::make_unique<LoopCore>();
+
+        // timerfd和eventfd使用multishot poll，run()之前只有构造线程访问提交队列
+        int timer_fd = core_->timer_fd();
+        int wakeup_fd = core_->wakeup_fd();
+        submit_poll(timer_fd, EPOLLIN, true, make_user_data(OpKind::TIMER, timer_fd, 0));
+        submit_poll(wakeup_fd, EPOLLIN, true, make_user_data(OpKind::WAKEUP, wakeup_fd, 0));
+        submit_and_wait(false);
+    } catch (...) {
+        core_.reset();
+        if (buf_ring_) {
+            munmap(buf_ring_, buf_ring_size_);
+        }
+        if (sqes_) {
+            munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        if (sq_ring_ != MAP_FAILED) {
+            munmap(sq_ring_, sq_ring_size_);
+        }
+        if (ring_fd_ != -1) {
+            close(ring_fd_);
+        }
+        throw;
+    }
+}
+
+IoUringEventLoop::~IoUringEventLoop() {
+    if (epoll_) {
+        return;
+    }
+    stop();
+
+    // 关闭ring之前取消所有未完成的请求，避免内核在缓冲区释放后仍写入接收数据
+    if (!running_) {
+        io_uring_sqe* sqe = get_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL | IORING_ASYNC_CANCEL_ANY;
+        sqe->user_data = make_user_data(OpKind::IGNORED, 0, 0);
+        __atomic_store_n(sq_tail_, ++sq_local_tail_, __ATOMIC_RELEASE);
+        to_submit_++;
+        submit_and_wait(true);
+    }
+
+    close(ring_fd_);
+    munmap(sqes_, sqes_size_);
+    if (cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    munmap(sq_ring_, sq_ring_size_);
+    munmap(buf_ring_, buf_ring_size_);
+}
+
+bool IoUringEventLoop::is_supported() {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = io_uring_setup(4, &params);
+    if (fd == -1) {
+        return false;
+    }
+
+    const unsigned required = IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_FAST_POLL;
+    bool supported = (params.features & required) == required;
+
+    // multishot recv与缓冲区环在6.0内核加入，用同一版本加入的SEND_ZC操作码判断
+    const size_t probe_size = sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op);
+    std::unique_ptr<char[]> storage(new char[probe_size]());
+    auto* probe = reinterpret_cast<io_uring_probe*>(storage.get());
+    if (supported && io_uring_register(fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0) {
+        supported = probe->last_op >= IORING_OP_SEND_ZC;
+    } else {
+        supported = false;
+    }
+
+    close(fd);
+    return supported;
+}
+
+void IoUringEventLoop::setup_ring(unsigned queue_depth) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    // 完成队列取提交队列的4倍，multishot请求一个SQE会产生多个CQE
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = queue_depth * 4;
+
+    ring_fd_ = io_uring_setup(queue_depth, &params);
+    if (ring_fd_ == -1) {
+        throw epoll_event_loop_exception("Failed to set up io_uring: " + std::string(strerror(errno)));
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        throw epoll_event_loop_exception("Failed to map submission ring: " + std::string(strerror(errno)));
+    }
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            throw epoll_event_loop_exception("Failed to map completion ring: " + std::string(strerror(errno)));
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        throw epoll_event_loop_exception("Failed to map submission entries: " + std::string(strerror(errno)));
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_flags_ = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // SQE下标与提交队列数组一一对应，之后不再修改数组
+    for (unsigned i = 0; i < sq_entries_; ++i) {
+        sq_array_[i] = i;
+    }
+}
+
+void IoUringEventLoop::setup_buffer_ring() {
+    buf_ring_size_ = buffer_count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        throw epoll_event_loop_exception("Failed to allocate buffer ring: " + std::string(strerror(errno)));
+    }
+    buf_ring_ = static_cast<io_uring_buf_ring*>(ring);
+    buffers_.reset(new char[static_cast<size_t>(buffer_count) * buffer_size]);
+
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+    reg.ring_entries = buffer_count;
+    reg.bgid = buffer_group;
+    if (io_uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+        throw epoll_event_loop_exception("Failed to register buffer ring: " + std::string(strerror(errno)));
+    }
+
+    for (unsigned i = 0; i < buffer_count; ++i) {
+        recycle_buffer(static_cast<uint16_t>(i));
+    }
+}
+
+void IoUringEventLoop::setup_fixed_files() {
+    io_uring_rsrc_register reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.nr = fixed_file_slots;
+    reg.flags = IORING_RSRC_REGISTER_SPARSE;
+    if (io_uring_register(ring_fd_, IORING_REGISTER_FILES2, &reg, sizeof(reg)) == -1) {
+        throw epoll_event_loop_exception("Failed to register fixed files: " + std::string(strerror(errno)));
+    }
+
+    free_fixed_files_.reserve(fixed_file_slots);
+    for (unsigned i = fixed_file_slots; i > 0; --i) {
+        free_fixed_files_.push_back(static_cast<int>(i - 1));
+    }
+}
+
+void IoUringEventLoop::recycle_buffer(uint16_t bid) {
+    // 直接按 io_uring_buf 数组访问：头文件中 bufs 的弹性数组宏在C++下会多出一个空结构体，偏移与内核不一致；
+    // 尾指针与第一个表项的resv字段重叠
+    io_uring_buf* bufs = reinterpret_cast<io_uring_buf*>(buf_ring_);
+    io_uring_buf* buf = &bufs[buf_ring_tail_ & (buffer_count - 1)];
+    buf->addr = reinterpret_cast<uint64_t>(buffers_.get() + static_cast<size_t>(bid) * buffer_size);
+    buf->len = buffer_size;
+    buf->bid = bid;
+    // 发布尾指针之后内核才能看到这个缓冲区
+    __atomic_store_n(&bufs[0].resv, ++buf_ring_tail_, __ATOMIC_RELEASE);
+}
+
+int IoUringEventLoop::allocate_fixed_file(int fd) {
+    if (free_fixed_files_.empty()) {
+        return -1;
+    }
+    int index = free_fixed_files_.back();
+
+    io_uring_files_update update;
+    std::memset(&update, 0, sizeof(update));
+    update.offset = static_cast<uint32_t>(index);
+    update.fds = reinterpret_cast<uint64_t>(&fd);
+    if (io_uring_register(ring_fd_, IORING_REGISTER_FILES_UPDATE, &update, 1) != 1) {
+        return -1;
+    }
+    free_fixed_files_.pop_back();
+    return index;
+}
+
+void IoUringEventLoop::release_fixed_file(int index) {
+    // 已提交的请求在提交时已经持有文件引用，更新表项不影响它们
+    int empty = -1;
+    io_uring_files_update update;
+    std::memset(&update, 0, sizeof(update));
+    update.offset = static_cast<uint32_t>(index);
+    update.fds = reinterpret_cast<uint64_t>(&empty);
+    io_uring_register(ring_fd_, IORING_REGISTER_FILES_UPDATE, &update, 1);
+    free_fixed_files_.push_back(index);
+}
+
+bool IoUringEventLoop::slot_is_current(const FdSlot& slot, uint32_t generation) const {
+    return ((slot.generation.load(std::memory_order_acquire) ^ generation) & generation_mask) == 0;
+}
+
+void IoUringEventLoop::add_fd(int fd, uint32_t events, std::shared_ptr<EventHandler> handler, bool is_et) {
+    if (epoll_) {
+        epoll_->add_fd(fd, events, std::move(handler), is_et);
+        return;
+    }
+    register_slot(fd, events, std::move(handler), is_et, OpKind::POLL, false);
+}
+
+void IoUringEventLoop::accept_multishot(int listen_fd, AcceptCallback callback) {
+    auto operation = std::make_shared<AcceptOperation>(std::move(callback));
+    if (epoll_) {
+        epoll_->add_fd(listen_fd, EPOLLIN, std::move(operation));
+        return;
+    }
+    register_slot(listen_fd, EPOLLIN, std::move(operation), false, OpKind::ACCEPT, false);
+}
+
+void IoUringEventLoop::recv_multishot(int fd, RecvCallback callback, bool use_fixed_file) {
+    auto operation = std::make_shared<RecvOperation>(epoll_.get(), std::move(callback));
+    if (epoll_) {
+        epoll_->add_fd(fd, EPOLLIN, std::move(operation));
+        return;
+    }
+    register_slot(fd, EPOLLIN, std::move(operation), false, OpKind::RECV, use_fixed_file);
+}
+
+void IoUringEventLoop::register_slot(int fd, uint32_t events, std::shared_ptr<EventHandler> handler,
+                                     bool is_et, OpKind kind, bool use_fixed_file) {
+    if (fd < 0 || fcntl(fd, F_GETFD) == -1) {
+        throw epoll_event_loop_exception("Failed to add fd to io_uring: invalid file descriptor " +
+                                         std::to_string(fd));
+    }
+    EpollEventLoop::set_nonblocking(fd);
+
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(fd_slots_.mutex());
+
+        FdSlot& slot = fd_slots_.ensure(fd);
+        if (slot.active) {
+            throw epoll_event_loop_exception("File descriptor already registered: " + std::to_string(fd));
+        }
+
+        int fixed_index = use_fixed_file ? allocate_fixed_file(fd) : -1;
+        generation = slot.generation.load(std::memory_order_relaxed) + 1;
+
+        // 先写入其余字段，最后发布代数；循环线程看到新代数时其余字段都已可见
+        slot.owner = std::move(handler);
+        slot.handler.store(slot.owner.get(), std::memory_order_release);
+        slot.events.store(events | (is_et ? static_cast<uint32_t>(EPOLLET) : 0), std::memory_order_relaxed);
+        slot.fixed_index.store(fixed_index, std::memory_order_relaxed);
+        slot.generation.store(generation, std::memory_order_release);
+        slot.kind = kind;
+        slot.active = true;
+        fd_slots_.activated();
+    }
+
+    uint64_t user_data = make_user_data(kind, fd, generation);
+    in_ring([this, fd, kind, generation, user_data]() {
+        FdSlot* slot = fd_slots_.find(fd);
+        if (!slot || !slot_is_current(*slot, generation)) {
+            return; // 提交之前已被移除或修改
+        }
+        if (kind == OpKind::ACCEPT) {
+            submit_accept(fd, user_data);
+        } else if (kind == OpKind::RECV) {
+            submit_recv(fd, slot->fixed_index.load(std::memory_order_relaxed), user_data);
+        } else {
+            uint32_t events = slot->events.load(std::memory_order_relaxed);
+            submit_poll(fd, events & ~static_cast<uint32_t>(EPOLLET), events & EPOLLET, user_data);
+        }
+    });
+}
+
+void IoUringEventLoop::modify_fd(int fd, uint32_t events) {
+    if (epoll_) {
+        epoll_->modify_fd(fd, events);
+        return;
+    }
+
+    uint64_t old_user_data;
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(fd_slots_.mutex());
+
+        FdSlot* slot = fd_slots_.find(fd);
+        if (!slot || !slot->active) {
+            throw epoll_event_loop_exception("File descriptor not found in io_uring");
+        }
+        if (slot->kind != OpKind::POLL) {
+            throw epoll_event_loop_exception("Only poll registrations can be modified");
+        }
+
+        uint32_t current = slot->generation.load(std::memory_order_relaxed);
+        old_user_data = make_user_data(OpKind::POLL, fd, current);
+        generation = current + 1;
+        uint32_t et = slot->events.load(std::memory_order_relaxed) & EPOLLET;
+        slot->events.store(events | et, std::memory_order_relaxed);
+        slot->generation.store(generation, std::memory_order_release);
+    }
+
+    // 取消旧的poll并以新代数重新提交，旧poll残留的完成事件因代数不匹配被丢弃
+    in_ring([this, fd, generation, old_user_data]() {
+        submit_cancel(old_user_data);
+        FdSlot* slot = fd_slots_.find(fd);
+        if (slot && slot_is_current(*slot, generation)) {
+            uint32_t events = slot->events.load(std::memory_order_relaxed);
+            submit_poll(fd, events & ~static_cast<uint32_t>(EPOLLET), events & EPOLLET,
+                        make_user_data(OpKind::POLL, fd, generation));
+        }
+    });
+}
+
+void IoUringEventLoop::remove_fd(int fd) {
+    if (epoll_) {
+        epoll_->remove_fd(fd);
+        return;
+    }
+
+    uint64_t user_data;
+    {
+        std::lock_guard<std::mutex> lock(fd_slots_.mutex());
+
+        FdSlot* slot = fd_slots_.find(fd);
+        if (!slot || !slot->active) {
+            throw epoll_event_loop_exception("Failed to remove fd from io_uring: fd not registered");
+        }
+        user_data = unregister_slot_locked(*slot, fd);
+    }
+
+    in_ring([this, user_data]() {
+        submit_cancel(user_data);
+    });
+}
+
+uint64_t IoUringEventLoop::unregister_slot_locked(FdSlot& slot, int fd) {
+    uint32_t generation = slot.generation.load(std::memory_order_relaxed);
+    uint64_t user_data = make_user_data(slot.kind, fd, generation);
+
+    // 递增代数使未分发的完成事件失效，处理器延迟到本批结束后释放
+    slot.generation.store(generation + 1, std::memory_order_release);
+    slot.handler.store(nullptr, std::memory_order_release);
+    fd_slots_.retire(std::move(slot.owner));
+    slot.active = false;
+    fd_slots_.deactivated();
+
+    int fixed_index = slot.fixed_index.exchange(-1, std::memory_order_relaxed);
+    if (fixed_index != -1) {
+        release_fixed_file(fixed_index);
+    }
+    return user_data;
+}
+
+io_uring_sqe* IoUringEventLoop::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sq_local_tail_ - head >= sq_entries_) {
+        // 提交队列已满：先提交已有的SQE，不等待完成事件
+        submit_and_wait(false);
+        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sq_local_tail_ - head >= sq_entries_) {
+            throw epoll_event_loop_exception("io_uring submission queue is full");
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sq_local_tail_ & *sq_mask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+void IoUringEventLoop::submit_poll(int fd, uint32_t events, bool multishot, uint64_t user_data) {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = user_data;
+    __atomic_store_n(sq_tail_, ++sq_local_tail_, __ATOMIC_RELEASE);
+    to_submit_++;
+}
+
+void IoUringEventLoop::submit_accept(int fd, uint64_t user_data) {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = user_data;
+    __atomic_store_n(sq_tail_, ++sq_local_tail_, __ATOMIC_RELEASE);
+    to_submit_++;
+}
+
+void IoUringEventLoop::submit_recv(int fd, int fixed_index, uint64_t user_data) {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    if (fixed_index != -1) {
+        sqe->fd = fixed_index;
+        sqe->flags = IOSQE_FIXED_FILE;
+    } else {
+        sqe->fd = fd;
+    }
+    // 不指定缓冲区，由内核在数据到达时从缓冲区环中挑选
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffer_group;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = user_data;
+    __atomic_store_n(sq_tail_, ++sq_local_tail_, __ATOMIC_RELEASE);
+    to_submit_++;
+}
+
+void IoUringEventLoop::submit_cancel(uint64_t target) {
+    io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = make_user_data(OpKind::IGNORED, 0, 0);
+    __atomic_store_n(sq_tail_, ++sq_local_tail_, __ATOMIC_RELEASE);
+    to_submit_++;
+}
+
+int IoUringEventLoop::enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+                            const void* arg, size_t arg_size) {
+    total_enters_++;
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags,
+                                    arg, arg_size));
+}
+
+void IoUringEventLoop::submit_and_wait(bool wait) {
+    int ret;
+    if (wait) {
+        // 提交与等待合并为一次系统调用，超时通过扩展参数传入
+        struct __kernel_timespec ts;
+        io_uring_getevents_arg arg;
+        std::memset(&arg, 0, sizeof(arg));
+        if (timeout_ >= 0) {
+            ts.tv_sec = timeout_ / 1000;
+            ts.tv_nsec = static_cast<long long>(timeout_ % 1000) * 1000000;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+        ret = enter(to_submit_, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    } else if (to_submit_ > 0) {
+        ret = enter(to_submit_, 0, 0, nullptr, 0);
+    } else {
+        return;
+    }
+
+    if (ret >= 0) {
+        to_submit_ -= static_cast<unsigned>(ret);
+        total_submissions_ += static_cast<uint64_t>(ret);
+        return;
+    }
+    if (errno != ETIME && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+        throw epoll_event_loop_exception("io_uring_enter failed: " + std::string(strerror(errno)));
+    }
+}
+
+void IoUringEventLoop::handle_completions() {
+    bool timers_due = false;
+    bool functors_due = false;
+    int handled = 0;
+
+    while (handled < max_events_) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            // 完成队列曾经溢出时，内核暂存的完成事件需要再进入一次内核才会写回
+            if (__atomic_load_n(sq_flags_, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) {
+                enter(0, 0, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (*cq_head_ != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+                    continue;
+                }
+            }
+            break;
+        }
+
+        // 先复制再归还队列位置，处理器中产生的新完成事件不会被挡住
+        io_uring_cqe cqe = cqes_[head & *cq_mask_];
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        handled++;
+
+        auto kind = static_cast<OpKind>(cqe.user_data >> 56);
+        if (kind == OpKind::TIMER || kind == OpKind::WAKEUP) {
+            (kind == OpKind::TIMER ? timers_due : functors_due) = true;
+            if (!(cqe.flags & IORING_CQE_F_MORE) && !stopped_) {
+                int fd = kind == OpKind::TIMER ? core_->timer_fd() : core_->wakeup_fd();
+                submit_poll(fd, EPOLLIN, true, make_user_data(kind, fd, 0));
+            }
+            continue;
+        }
+        dispatch_completion(cqe);
+    }
+
+    total_events_ += handled;
+
+    fd_slots_.release_retired();
+    if (timers_due) {
+        core_->handle_timers();
+    }
+    if (functors_due) {
+        core_->run_pending_functors();
+    }
+    core_->run_local_functors();
+}
+
+void IoUringEventLoop::dispatch_completion(const io_uring_cqe& cqe) {
+    auto kind = static_cast<OpKind>(cqe.user_data >> 56);
+    if (kind == OpKind::IGNORED) {
+        return;
+    }
+    int fd = static_cast<int>(static_cast<uint32_t>(cqe.user_data));
+    uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32) & generation_mask;
+
+    FdSlot* slot = fd_slots_.find(fd);
+    EventHandler* handler = nullptr;
+    if (slot && slot_is_current(*slot, generation)) {
+        handler = slot->handler.load(std::memory_order_acquire);
+        if (!slot_is_current(*slot, generation)) {
+            handler = nullptr;
+        }
+    }
+
+    if (!handler) {
+        // 已移除的注册：丢弃事件，但内核挑选的接收缓冲区必须归还
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            recycle_buffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+        return;
+    }
+
+    try {
+        switch (kind) {
+        case OpKind::POLL:
+            handle_poll(*slot, handler, fd, generation, cqe);
+            break;
+        case OpKind::ACCEPT:
+            handle_accept(*slot, handler, fd, generation, cqe);
+            break;
+        case OpKind::RECV:
+            handle_recv(*slot, handler, fd, generation, cqe);
+            break;
+        default:
+            break;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error handling completion for fd " << fd << ": " << e.what() << std::endl;
+    }
+}
+
+void IoUringEventLoop::handle_poll(FdSlot& slot, EventHandler* handler, int fd, uint32_t generation,
+                                   const io_uring_cqe& cqe) {
+    if (cqe.res == -ECANCELED) {
+        return;
+    }
+
+    try {
+        if (cqe.res < 0) {
+            handler->handle_error(fd, strerror(-cqe.res));
+        } else if (cqe.res & (EPOLLERR | EPOLLHUP)) {
+            handler->handle_error(fd, "Socket error or hangup");
+        } else {
+            handler->handle_event(fd, static_cast<uint32_t>(cqe.res));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error handling event for fd " << fd << ": " << e.what() << std::endl;
+    }
+
+    // 水平触发：单次poll在分发后重新提交，fd仍就绪时会立即再次完成；
+    // 边缘触发：multishot poll持续有效，只有内核结束它时才重新提交
+    uint32_t events = slot.events.load(std::memory_order_relaxed);
+    if (!slot_is_current(slot, generation)) {
+        return;
+    }
+    bool is_et = events & EPOLLET;
+    if (!is_et || !(cqe.flags & IORING_CQE_F_MORE)) {
+        submit_poll(fd, events & ~static_cast<uint32_t>(EPOLLET), is_et, cqe.user_data);
+    }
+}
+
+void IoUringEventLoop::handle_accept(FdSlot& slot, EventHandler* handler, int fd, uint32_t generation,
+                                     const io_uring_cqe& cqe) {
+    auto* operation = static_cast<AcceptOperation*>(handler);
+    if (cqe.res >= 0) {
+        operation->deliver(fd, cqe.res);
+    } else if (cqe.res == -ECANCELED) {
+        return;
+    } else if (cqe.res != -EINTR && cqe.res != -ECONNABORTED) {
+        std::cerr << "Multishot accept failed on fd " << fd << ": " << strerror(-cqe.res) << std::endl;
+        return; // 不可恢复的错误（如fd耗尽）不再重新提交，避免空转
+    }
+
+    if (!(cqe.flags & IORING_CQE_F_MORE) && slot_is_current(slot, generation)) {
+        submit_accept(fd, cqe.user_data);
+    }
+}
+
+void IoUringEventLoop::handle_recv(FdSlot& slot, EventHandler* handler, int fd, uint32_t generation,
+                                   const io_uring_cqe& cqe) {
+    auto* operation = static_cast<RecvOperation*>(handler);
+
+    if (cqe.res > 0) {
+        auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        operation->deliver(fd, buffers_.get() + static_cast<size_t>(bid) * buffer_size, cqe.res);
+        recycle_buffer(bid);
+    } else if (cqe.flags & IORING_CQE_F_BUFFER) {
+        recycle_buffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+    }
+
+    if (cqe.res > 0 || cqe.res == -ENOBUFS) {
+        // 缓冲区耗尽时multishot请求结束；上面的回调已归还缓冲区，重新提交即可
+        if (!(cqe.flags & IORING_CQE_F_MORE) && slot_is_current(slot, generation)) {
+            submit_recv(fd, slot.fixed_index.load(std::memory_order_relaxed), cqe.user_data);
+        }
+        return;
+    }
+    if (cqe.res == -ECANCELED) {
+        return;
+    }
+
+    // 对端关闭或出错：先解除注册再通知，回调中可以直接关闭fd
+    {
+        std::lock_guard<std::mutex> lock(fd_slots_.mutex());
+        if (slot.active && slot_is_current(slot, generation)) {
+            unregister_slot_locked(slot, fd);
+        }
+    }
+    operation->deliver(fd, nullptr, cqe.res);
+}
+
+void IoUringEventLoop::in_ring(Functor f) {
+    // 提交队列只由循环线程填写，不需要加锁
+    run_in_loop(std::move(f));
+}
+
+uint64_t IoUringEventLoop::add_timer(uint64_t delay, std::shared_ptr<Timer> timer) {
+    return add_timer(std::chrono::milliseconds(delay), std::move(timer));
+}
+
+uint64_t IoUringEventLoop::add_timer(std::chrono::microseconds delay, std::shared_ptr<Timer> timer,
+                                     std::chrono::microseconds interval) {
+    if (epoll_) {
+        return epoll_->add_timer(delay, std::move(timer), interval);
+    }
+
+    return core_->add_timer(delay, std::move(timer), interval);
+}
+
+void IoUringEventLoop::cancel_timer(uint64_t timer_id) {
+    if (epoll_) {
+        epoll_->cancel_timer(timer_id);
+        return;
+    }
+    core_->cancel_timer(timer_id);
+}
+
+bool IoUringEventLoop::reschedule_timer(uint64_t timer_id, std::chrono::microseconds delay) {
+    if (epoll_) {
+        return epoll_->reschedule_timer(timer_id, delay);
+    }
+    return core_->reschedule_timer(timer_id, delay);
+}
+
+void IoUringEventLoop::run_in_loop(Functor f) {
+    if (epoll_) {
+        epoll_->run_in_loop(std::move(f));
+    } else {
+        core_->run_in_loop(std::move(f));
+    }
+}
+
+void IoUringEventLoop::queue_in_loop(Functor f) {
+    if (epoll_) {
+        epoll_->queue_in_loop(std::move(f));
+    } else {
+        core_->queue_in_loop(std::move(f));
+    }
+}
+
+bool IoUringEventLoop::is_in_loop_thread() const {
+    return epoll_ ? epoll_->is_in_loop_thread() : core_->is_in_loop_thread();
+}
+
+void IoUringEventLoop::run() {
+    if (epoll_) {
+        epoll_->run();
+        return;
+    }
+    if (running_.exchange(true)) {
+        return;
+    }
+
+    core_->set_loop_thread(std::this_thread::get_id());
+
+    std::cout << "io_uring event loop started..." << std::endl;
+
+    while (!stopped_) {
+        submit_and_wait(true);
+        handle_completions();
+    }
+
+    // 退出前提交剩余的SQE（如取消请求）
+    submit_and_wait(false);
+
+    core_->set_loop_thread(std::thread::id());
+    stopped_ = false;
+    running_ = false;
+    std::cout << "io_uring event loop stopped." << std::endl;
+}
+
+void IoUringEventLoop::stop() {
+    if (epoll_) {
+        epoll_->stop();
+        return;
+    }
+    stopped_ = true;
+    if (!core_->is_in_loop_thread()) {
+        core_->wakeup();
+    }
+}
+
+bool IoUringEventLoop::is_running() const {
+    return epoll_ ? epoll_->is_running() : running_.load();
+}
+
+std::string IoUringEventLoop::get_stats() const {
+    if (epoll_) {
+        return "IoUringEventLoop Stats:\n  Backend: epoll\n" + epoll_->get_stats();
+    }
+
+    size_t active_fds = fd_slots_.active_count();
+    size_t active_timers = core_->timer_count();
+
+    std::stringstream ss;
+    ss << "IoUringEventLoop Stats:\n"
+       << "  Backend: io_uring\n"
+       << "  Running: " << (running_ ? "Yes" : "No") << "\n"
+       << "  Ring FD: " << ring_fd_ << "\n"
+       << "  SQ Entries: " << sq_entries_ << "\n"
+       << "  Timeout: " << timeout_ << "ms\n"
+       << "  Active FDs: " << active_fds << "\n"
+       << "  Active Timers: " << active_timers << "\n"
+       << "  Total Events: " << total_events_.load() << "\n"
+       << "  Total Timers: " << core_->total_timers() << "\n"
+       << "  Total Functors: " << core_->total_functors() << "\n"
+       << "  Wakeups: " << core_->total_wakeups() << "\n"
+       << "  Submissions: " << total_submissions_.load() << "\n"
+       << "  Enter Calls: " << total_enters_.load();
+    return ss.str();
+}
+
+} // namespace impl
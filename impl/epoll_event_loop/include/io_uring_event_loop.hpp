@@ -0,0 +1,267 @@
+#pragma once
+
+#include "epoll_event_loop.hpp"
+#include <linux/io_uring.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace impl {
+
+/**
+ * @brief 基于io_uring的事件循环
+ *
+ * 与 EpollEventLoop 提供相同的fd注册、定时器和跨线程投递接口，内部改为io_uring：
+ * - 就绪通知使用 IORING_OP_POLL_ADD：水平触发注册在每次事件分发后重新提交单次poll，
+ *   边缘触发注册使用multishot poll
+ * - 所有SQE只在循环线程上填写，积攒到下一次 io_uring_enter 时与等待完成事件合并为一次系统调用提交
+ * - accept_multishot：一次提交持续接受连接，每个新连接一个CQE，不再需要“可读 -> accept”两步
+ * - recv_multishot：从注册到内核的缓冲区环（provided buffer ring）中由内核挑选缓冲区接收数据，
+ *   可选使用注册的固定文件（fixed file）省去每次操作的fd查找与引用计数
+ * - fd槽位表、定时器与跨线程投递与 EpollEventLoop 共用 FdSlotTable 和 LoopCore，
+ *   LoopCore 的timerfd与eventfd都通过multishot poll接入ring
+ * - 内核不支持所需特性时（见 is_supported）自动退化为内部的 EpollEventLoop，接口行为不变
+ *
+ * 与 EpollEventLoop 的差异：关闭fd之前必须先调用 remove_fd，同一fd编号重复添加会抛出异常。
+ */
+class IoUringEventLoop {
+public:
+    using Functor = std::function<void()>;
+
+    /**
+     * @brief 新连接回调，参数为监听fd和已设置为非阻塞的连接fd
+     */
+    using AcceptCallback = std::function<void(int listen_fd, int conn_fd)>;
+
+    /**
+     * @brief 接收回调
+     *
+     * len > 0 时data指向本次收到的数据，仅在回调期间有效；len == 0 表示对端关闭；
+     * len < 0 为负的errno。后两种情况下注册已自动解除，由调用者关闭fd。
+     */
+    using RecvCallback = std::function<void(int fd, const char* data, ssize_t len)>;
+
+    /**
+     * @brief 后端选择
+     */
+    enum class Backend {
+        AUTO,       ///< 支持时使用io_uring，否则使用epoll
+        IO_URING,   ///< 强制使用io_uring，不支持时抛出异常
+        EPOLL       ///< 强制使用epoll
+    };
+
+    /**
+     * @brief 构造函数
+     * @param max_events 每批最多处理的完成事件数
+     * @param timeout 等待超时时间（毫秒）
+     * @param backend 后端选择
+     * @param queue_depth 提交队列深度（完成队列为其4倍）
+     */
+    explicit IoUringEventLoop(int max_events = 1024, int timeout = 100,
+                              Backend backend = Backend::AUTO, unsigned queue_depth = 1024);
+
+    ~IoUringEventLoop();
+
+    /**
+     * @brief 检查内核是否支持本实现需要的io_uring特性
+     *
+     * 需要 NODROP、EXT_ARG、FAST_POLL 特性以及multishot recv和缓冲区环（6.0及以上内核）。
+     */
+    static bool is_supported();
+
+    /**
+     * @brief 当前是否使用io_uring后端
+     */
+    bool using_io_uring() const { return epoll_ == nullptr; }
+
+    void add_fd(int fd, uint32_t events, std::shared_ptr<EventHandler> handler, bool is_et = false);
+    void modify_fd(int fd, uint32_t events);
+    void remove_fd(int fd);
+
+    uint64_t add_timer(uint64_t delay, std::shared_ptr<Timer> timer);
+    uint64_t add_timer(std::chrono::microseconds delay, std::shared_ptr<Timer> timer,
+                       std::chrono::microseconds interval = std::chrono::microseconds(0));
+    void cancel_timer(uint64_t timer_id);
+    bool reschedule_timer(uint64_t timer_id, std::chrono::microseconds delay);
+
+    void run_in_loop(Functor f);
+    void queue_in_loop(Functor f);
+    bool is_in_loop_thread() const;
+
+    void run();
+    void stop();
+    bool is_running() const;
+    std::string get_stats() const;
+
+    /**
+     * @brief 在监听socket上持续接受连接
+     *
+     * 注册通过 remove_fd(listen_fd) 解除。epoll后端下退化为可读事件 + 批量accept4。
+     * @param listen_fd 非阻塞的监听socket
+     * @param callback 新连接回调（在循环线程上执行）
+     */
+    void accept_multishot(int listen_fd, AcceptCallback callback);
+
+    /**
+     * @brief 在已连接socket上持续接收数据
+     *
+     * 注册通过 remove_fd(fd) 解除。epoll后端下退化为每次可读事件recv一次。
+     * @param fd 已连接socket
+     * @param callback 接收回调（在循环线程上执行）
+     * @param use_fixed_file 是否把fd注册为固定文件
+     */
+    void recv_multishot(int fd, RecvCallback callback, bool use_fixed_file = true);
+
+    IoUringEventLoop(const IoUringEventLoop&) = delete;
+    IoUringEventLoop& operator=(const IoUringEventLoop&) = delete;
+
+private:
+    class AcceptOperation;
+    class RecvOperation;
+
+    /**
+     * @brief 注册类型，编码在user_data的高8位
+     */
+    enum class OpKind : uint8_t {
+        IGNORED = 0,   ///< 取消请求等不需要处理的完成事件
+        POLL = 1,
+        ACCEPT = 2,
+        RECV = 3,
+        TIMER = 4,
+        WAKEUP = 5
+    };
+
+    /**
+     * @brief fd槽位
+     *
+     * 循环线程只读取原子字段并按seqlock方式前后校验代数；
+     * owner、kind、active 只在持有槽位表的锁时访问。
+     */
+    struct FdSlot {
+        std::atomic<EventHandler*> handler{nullptr};
+        std::atomic<uint32_t> generation{0};
+        std::atomic<uint32_t> events{0};     // poll事件，边缘触发时包含EPOLLET
+        std::atomic<int> fixed_index{-1};    // 固定文件下标，-1表示未注册
+        std::shared_ptr<EventHandler> owner;
+        OpKind kind = OpKind::POLL;
+        bool active = false;
+    };
+
+    static constexpr uint32_t generation_mask = 0xFFFFFF;   // user_data中代数只占24位
+    static constexpr unsigned buffer_count = 256;            // 接收缓冲区数量（2的幂）
+    static constexpr unsigned buffer_size = 16384;           // 每个接收缓冲区的大小
+    static constexpr uint16_t buffer_group = 0;
+    static constexpr unsigned fixed_file_slots = 4096;
+
+    /**
+     * @brief 编码user_data：类型(8位) | 代数(24位) | fd(32位)
+     */
+    static uint64_t make_user_data(OpKind kind, int fd, uint32_t generation) {
+        return (static_cast<uint64_t>(kind) << 56) |
+               (static_cast<uint64_t>(generation & generation_mask) << 32) |
+               static_cast<uint32_t>(fd);
+    }
+
+    /**
+     * @brief 注册一个槽位并在循环线程上提交对应的SQE
+     */
+    void register_slot(int fd, uint32_t events, std::shared_ptr<EventHandler> handler,
+                       bool is_et, OpKind kind, bool use_fixed_file);
+
+    /**
+     * @brief 解除槽位注册（调用时需持有槽位表的锁），返回需要取消的user_data
+     */
+    uint64_t unregister_slot_locked(FdSlot& slot, int fd);
+
+    void setup_ring(unsigned queue_depth);
+    void setup_buffer_ring();
+    void setup_fixed_files();
+
+    /**
+     * @brief 取得一个空闲SQE；提交队列已满时先提交已填写的SQE
+     */
+    io_uring_sqe* get_sqe();
+    void submit_poll(int fd, uint32_t events, bool multishot, uint64_t user_data);
+    void submit_accept(int fd, uint64_t user_data);
+    void submit_recv(int fd, int fixed_index, uint64_t user_data);
+    void submit_cancel(uint64_t target);
+
+    /**
+     * @brief 提交已填写的SQE；wait为true时在同一次系统调用中等待至少一个完成事件（带超时）
+     */
+    void submit_and_wait(bool wait);
+
+    /**
+     * @brief 直接调用io_uring_enter
+     */
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t arg_size);
+
+    /**
+     * @brief 处理一批完成事件，随后执行定时器和投递的任务
+     */
+    void handle_completions();
+    void dispatch_completion(const io_uring_cqe& cqe);
+    void handle_poll(FdSlot& slot, EventHandler* handler, int fd, uint32_t generation, const io_uring_cqe& cqe);
+    void handle_accept(FdSlot& slot, EventHandler* handler, int fd, uint32_t generation, const io_uring_cqe& cqe);
+    void handle_recv(FdSlot& slot, EventHandler* handler, int fd, uint32_t generation, const io_uring_cqe& cqe);
+
+    /**
+     * @brief 把接收缓冲区归还到缓冲区环
+     */
+    void recycle_buffer(uint16_t bid);
+
+    /**
+     * @brief 在循环线程上执行SQE相关操作；其他线程调用时投递
+     */
+    void in_ring(Functor f);
+
+    int allocate_fixed_file(int fd);
+    void release_fixed_file(int index);
+    bool slot_is_current(const FdSlot& slot, uint32_t generation) const;
+
+    std::unique_ptr<EpollEventLoop> epoll_;   // 退化为epoll时使用
+
+    int max_events_;
+    int timeout_;
+
+    // io_uring
+    int ring_fd_;
+    void* sq_ring_;
+    size_t sq_ring_size_;
+    void* cq_ring_;
+    size_t cq_ring_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_mask_;
+    unsigned* sq_flags_;
+    unsigned* sq_array_;
+    unsigned sq_entries_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned* cq_mask_;
+    io_uring_cqe* cqes_;
+    unsigned sq_local_tail_;                  // 本地SQE末尾，填写后立即发布
+    unsigned to_submit_;                      // 已发布但尚未提交的SQE数量
+
+    // 缓冲区环与固定文件
+    io_uring_buf_ring* buf_ring_;
+    size_t buf_ring_size_;
+    std::unique_ptr<char[]> buffers_;
+    uint16_t buf_ring_tail_;
+    std::vector<int> free_fixed_files_;
+
+    FdSlotTable<FdSlot> fd_slots_;            // fd槽位表
+    std::unique_ptr<LoopCore> core_;          // 定时器与跨线程投递，退化为epoll时为空
+
+    std::atomic<bool> running_;
+    std::atomic<bool> stopped_;
+
+    std::atomic<uint64_t> total_events_;      // 已分发的完成事件数
+    std::atomic<uint64_t> total_submissions_; // 已提交的SQE数
+    std::atomic<uint64_t> total_enters_;      // io_uring_enter调用次数
+};
+
+} // namespace impl
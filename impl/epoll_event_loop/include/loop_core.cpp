@@ -0,0 +1,252 @@
+#include "epoll_event_loop.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace impl {
+
+LoopCore::LoopCore()
+    : timer_fd_(-1)
+    , timer_armed_(std::chrono::steady_clock::time_point::max())
+    , timer_cancels_(0)
+    , wakeup_fd_(-1)
+    , wakeup_pending_(false)
+    , pending_count_(0)
+    , total_timers_(0)
+    , total_functors_(0)
+    , total_wakeups_(0)
+    , slow_calls_(0)
+    , slow_threshold_ns_(0) {
+
+    // 定时器到期与跨线程唤醒都表现为fd可读，由所属循环注册到自己的IO后端
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd_ == -1) {
+        throw epoll_event_loop_exception("Failed to create timerfd: " + std::string(strerror(errno)));
+    }
+
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ == -1) {
+        close(timer_fd_);
+        throw epoll_event_loop_exception("Failed to create eventfd: " + std::string(strerror(errno)));
+    }
+}
+
+LoopCore::~LoopCore() {
+    close(timer_fd_);
+    close(wakeup_fd_);
+}
+
+uint64_t LoopCore::add_timer(std::chrono::microseconds delay, std::shared_ptr<Timer> timer,
+                             std::chrono::microseconds interval) {
+    auto deadline = std::chrono::steady_clock::now() + delay;
+
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+
+    uint64_t timer_id = timer_wheel_.add(deadline, std::move(timer), interval);
+
+    // 只有比timerfd当前到期时间更早时才需要重新设置
+    if (deadline < timer_armed_) {
+        arm_timerfd(timer_wheel_.next_expiry());
+    }
+
+    total_timers_++;
+
+    return timer_id;
+}
+
+void LoopCore::cancel_timer(uint64_t timer_id) {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    if (timer_wheel_.cancel(timer_id)) {
+        timer_cancels_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool LoopCore::reschedule_timer(uint64_t timer_id, std::chrono::microseconds delay) {
+    auto deadline = std::chrono::steady_clock::now() + delay;
+
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+
+    if (!timer_wheel_.reschedule(timer_id, deadline)) {
+        return false;
+    }
+    if (deadline < timer_armed_) {
+        arm_timerfd(timer_wheel_.next_expiry());
+    }
+    return true;
+}
+
+size_t LoopCore::timer_count() const {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    return timer_wheel_.size();
+}
+
+void LoopCore::handle_timers() {
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+
+        uint64_t expirations;
+        ssize_t n = read(timer_fd_, &expirations, sizeof(expirations));
+        (void)n; // EAGAIN表示已被重新设置，照常推进即可
+
+        timer_wheel_.advance(std::chrono::steady_clock::now(), expired_timers_);
+        arm_timerfd(timer_wheel_.next_expiry());
+    }
+
+    // 回调在锁外执行，允许回调中添加、取消或重新调度定时器；
+    // 同一批中前面的回调（或其他线程）可能取消了后面的定时器，有取消发生时逐个确认
+    uint64_t cancels = timer_cancels_.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    for (auto& item : expired_timers_) {
+        if (!item.timer || item.timer->is_canceled()) {
+            continue;
+        }
+        if (timer_cancels_.load(std::memory_order_relaxed) != cancels) {
+            std::lock_guard<std::mutex> lock(timer_mutex_);
+            if (!timer_wheel_.alive(item.id)) {
+                continue;
+            }
+        }
+        int64_t lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(start - item.deadline).count();
+        timer_lateness_.record(static_cast<uint64_t>(std::max<int64_t>(lateness, 0)));
+        try {
+            item.timer->on_timeout();
+        } catch (const std::exception& e) {
+            std::cerr << "Error in timer callback: " << e.what() << std::endl;
+        }
+        start = finish_call(start, nullptr, -1, "timer");
+    }
+    expired_timers_.clear();
+
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    timer_wheel_.release_fired();
+}
+
+void LoopCore::arm_timerfd(std::chrono::steady_clock::time_point deadline) {
+    struct itimerspec spec;
+    std::memset(&spec, 0, sizeof(spec));
+
+    if (deadline != std::chrono::steady_clock::time_point::max()) {
+        // steady_clock基于CLOCK_MONOTONIC，可以直接作为绝对时间使用
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline.time_since_epoch()).count();
+        if (ns <= 0) {
+            ns = 1; // it_value全0表示停用，已过期的时间点取最小值立即触发
+        }
+        spec.it_value.tv_sec = ns / 1000000000;
+        spec.it_value.tv_nsec = ns % 1000000000;
+    }
+
+    if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) == -1) {
+        throw epoll_event_loop_exception("Failed to arm timerfd: " + std::string(strerror(errno)));
+    }
+    timer_armed_ = deadline;
+}
+
+void LoopCore::run_in_loop(Functor f) {
+    if (is_in_loop_thread()) {
+        f();
+    } else {
+        queue_in_loop(std::move(f));
+    }
+}
+
+void LoopCore::queue_in_loop(Functor f) {
+    // 循环线程自己投递的任务放入本地列表，本批结束时执行，不需要写eventfd
+    if (is_in_loop_thread()) {
+        local_functors_.push_back(std::move(f));
+        total_functors_++;
+        return;
+    }
+
+    pending_functors_.push(std::move(f));
+    pending_count_.fetch_add(1, std::memory_order_release);
+    total_functors_++;
+
+    // 只有第一个把标志从false改为true的投递者需要写eventfd，其余投递合并到同一次唤醒
+    if (!wakeup_pending_.exchange(true, std::memory_order_acq_rel)) {
+        wakeup();
+    }
+}
+
+bool LoopCore::is_in_loop_thread() const {
+    return loop_thread_id_.load(std::memory_order_relaxed) == std::this_thread::get_id();
+}
+
+void LoopCore::wakeup() {
+    uint64_t one = 1;
+    ssize_t n = write(wakeup_fd_, &one, sizeof(one));
+    (void)n; // 计数器溢出前总会被读取，EAGAIN时循环线程本来就会被唤醒
+    total_wakeups_++;
+}
+
+void LoopCore::run_local_functors() {
+    // 执行过程中新投递的任务进入local_functors_，循环直到清空
+    while (!local_functors_.empty()) {
+        running_functors_.swap(local_functors_);
+        auto start = std::chrono::steady_clock::now();
+        for (auto& f : running_functors_) {
+            try {
+                f();
+            } catch (const std::exception& e) {
+                std::cerr << "Error in queued functor: " << e.what() << std::endl;
+            }
+            start = finish_call(start, &functor_time_, -1, "functor");
+        }
+        running_functors_.clear();
+    }
+}
+
+void LoopCore::run_pending_functors() {
+    uint64_t value;
+    ssize_t n = read(wakeup_fd_, &value, sizeof(value));
+    (void)n;
+
+    // 先清除标志再取任务：此后的投递会重新写eventfd，不会丢失唤醒
+    wakeup_pending_.store(false, std::memory_order_seq_cst);
+
+    // 只执行此刻已计数的任务，执行期间新投递的任务留给下一次唤醒，
+    // 生产者持续投递时也不会让循环线程一直停在这里而饿死IO和定时器
+    size_t count = pending_count_.exchange(0, std::memory_order_acq_rel);
+
+    Functor f;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count && pending_functors_.pop_blocking(f); ++i) {
+        try {
+            f();
+        } catch (const std::exception& e) {
+            std::cerr << "Error in queued functor: " << e.what() << std::endl;
+        }
+        f = nullptr;
+        start = finish_call(start, &functor_time_, -1, "functor");
+    }
+}
+
+void LoopCore::set_slow_handler_callback(std::chrono::microseconds threshold, SlowHandlerCallback callback) {
+    run_in_loop([this, threshold, callback = std::move(callback)]() mutable {
+        slow_threshold_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(threshold).count();
+        slow_callback_ = std::move(callback);
+    });
+}
+
+std::chrono::steady_clock::time_point LoopCore::finish_call(std::chrono::steady_clock::time_point start,
+                                                            Log2Histogram* histogram, int fd, const char* kind) {
+    auto end = std::chrono::steady_clock::now();
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    if (histogram) {
+        histogram->record(static_cast<uint64_t>(elapsed));
+    }
+    if (slow_threshold_ns_ > 0 && elapsed >= slow_threshold_ns_) {
+        slow_calls_.store(slow_calls_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (slow_callback_) {
+            try {
+                slow_callback_(SlowHandlerInfo{fd, kind, std::chrono::nanoseconds(elapsed)});
+            } catch (const std::exception& e) {
+                std::cerr << "Error in slow handler callback: " << e.what() << std::endl;
+            }
+        }
+        // 回调本身的耗时不计入下一个处理器
+        end = std::chrono::steady_clock::now();
+    }
+    return end;
+}
+
+} // namespace impl
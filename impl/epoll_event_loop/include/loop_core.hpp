@@ -0,0 +1,257 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "timing_wheel.hpp"
+#include "mpsc_queue.hpp"
+#include "loop_metrics.hpp"
+
+namespace impl {
+
+class EventHandler;
+class Timer;
+
+/**
+ * @brief epoll事件循环异常类
+ */
+class epoll_event_loop_exception : public std::runtime_error {
+public:
+    explicit epoll_event_loop_exception(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+/**
+ * @brief 按fd编号索引的槽位表，EpollEventLoop 与 IoUringEventLoop 共用
+ *
+ * - 按1024个槽位分块，分块分配后不再移动也不释放，循环线程可以无锁查找
+ * - 注册、修改和移除由调用者在持有 mutex() 时进行
+ * - 移除的处理器可能正被循环线程使用，先放入待释放列表，循环线程在一批事件分发完成后释放
+ *
+ * @tparam Slot 槽位类型，需要可默认构造
+ */
+template <typename Slot>
+class FdSlotTable {
+public:
+    static constexpr int chunk_bits = 10;
+    static constexpr size_t chunk_size = size_t(1) << chunk_bits;
+    static constexpr size_t max_chunks = 1024;   // 最多支持约100万个fd
+
+    FdSlotTable() {
+        for (auto& chunk : chunks_) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~FdSlotTable() {
+        for (auto& chunk : chunks_) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    FdSlotTable(const FdSlotTable&) = delete;
+    FdSlotTable& operator=(const FdSlotTable&) = delete;
+
+    /**
+     * @brief 无锁查找fd对应的槽位
+     * @return 槽位所在分块尚未分配时返回nullptr
+     */
+    Slot* find(int fd) const {
+        size_t index = static_cast<size_t>(fd);
+        size_t chunk = index >> chunk_bits;
+        if (fd < 0 || chunk >= max_chunks) {
+            return nullptr;
+        }
+        Slot* slots = chunks_[chunk].load(std::memory_order_acquire);
+        return slots ? &slots[index & (chunk_size - 1)] : nullptr;
+    }
+
+    /**
+     * @brief 查找或分配fd对应的槽位（调用时需持有mutex()）
+     */
+    Slot& ensure(int fd) {
+        size_t index = static_cast<size_t>(fd);
+        size_t chunk = index >> chunk_bits;
+        if (fd < 0 || chunk >= max_chunks) {
+            throw epoll_event_loop_exception("File descriptor out of range: " + std::to_string(fd));
+        }
+        Slot* slots = chunks_[chunk].load(std::memory_order_relaxed);
+        if (!slots) {
+            slots = new Slot[chunk_size];
+            chunks_[chunk].store(slots, std::memory_order_release);
+        }
+        return slots[index & (chunk_size - 1)];
+    }
+
+    /**
+     * @brief 保护注册状态的互斥锁
+     */
+    std::mutex& mutex() const { return mutex_; }
+
+    /**
+     * @brief 记录一次注册或移除（调用时需持有mutex()）
+     */
+    void activated() { active_++; }
+    void deactivated() { active_--; }
+
+    /**
+     * @brief 已注册的fd数量
+     */
+    size_t active_count() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return active_;
+    }
+
+    /**
+     * @brief 延迟释放处理器（调用时需持有mutex()）
+     */
+    void retire(std::shared_ptr<EventHandler> handler) {
+        retired_.push_back(std::move(handler));
+        has_retired_.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief 释放待释放的处理器（在循环线程上一批事件分发完成后调用）
+     */
+    void release_retired() {
+        if (!has_retired_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::vector<std::shared_ptr<EventHandler>> retired;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            retired.swap(retired_);
+            has_retired_.store(false, std::memory_order_relaxed);
+        }
+        // 在锁外析构，处理器析构函数中可以再次调用remove_fd等接口
+    }
+
+private:
+    std::atomic<Slot*> chunks_[max_chunks];  // 分块分配后不再移动
+    size_t active_ = 0;                      // 已注册的fd数量
+    std::vector<std::shared_ptr<EventHandler>> retired_; // 待释放的处理器
+    std::atomic<bool> has_retired_{false};   // 是否有待释放的处理器
+    mutable std::mutex mutex_;
+};
+
+/**
+ * @brief 事件循环中与IO后端无关的部分，EpollEventLoop 与 IoUringEventLoop 共用
+ *
+ * - 定时器：分层时间轮 + timerfd，任意线程添加、取消、重新调度，回调在循环线程上执行
+ * - 跨线程投递：无锁队列 + eventfd，同一批投递只写一次eventfd；循环线程自己投递的任务进入本地列表
+ * - 执行时间统计：定时器触发延迟、投递任务执行时间，以及超过阈值时的慢处理器回调
+ *
+ * timerfd 与 eventfd 由本类创建和关闭，由所属的循环注册到各自的IO后端，
+ * 可读时分别调用 handle_timers() 与 run_pending_functors()。
+ */
+class LoopCore {
+public:
+    using Functor = std::function<void()>;
+    using SlowHandlerCallback = std::function<void(const SlowHandlerInfo&)>;
+
+    LoopCore();
+    ~LoopCore();
+
+    LoopCore(const LoopCore&) = delete;
+    LoopCore& operator=(const LoopCore&) = delete;
+
+    int timer_fd() const { return timer_fd_; }
+    int wakeup_fd() const { return wakeup_fd_; }
+
+    uint64_t add_timer(std::chrono::microseconds delay, std::shared_ptr<Timer> timer,
+                       std::chrono::microseconds interval);
+    void cancel_timer(uint64_t timer_id);
+    bool reschedule_timer(uint64_t timer_id, std::chrono::microseconds delay);
+
+    /**
+     * @brief 当前定时器数量
+     */
+    size_t timer_count() const;
+
+    /**
+     * @brief 推进时间轮并执行到期的定时器回调（仅循环线程）
+     */
+    void handle_timers();
+
+    void run_in_loop(Functor f);
+    void queue_in_loop(Functor f);
+    bool is_in_loop_thread() const;
+
+    /**
+     * @brief 唤醒阻塞在IO后端中的循环线程
+     */
+    void wakeup();
+
+    /**
+     * @brief 执行其他线程投递的任务，每次最多执行进入时已入队的任务（仅循环线程）
+     */
+    void run_pending_functors();
+
+    /**
+     * @brief 执行循环线程自己在本批中投递的任务（仅循环线程）
+     */
+    void run_local_functors();
+
+    /**
+     * @brief 记录运行run()的线程，退出时传入默认构造的线程ID
+     */
+    void set_loop_thread(std::thread::id id) { loop_thread_id_.store(id); }
+
+    /**
+     * @brief 设置慢处理器回调，在循环线程上生效
+     */
+    void set_slow_handler_callback(std::chrono::microseconds threshold, SlowHandlerCallback callback);
+
+    /**
+     * @brief 记录一次执行时间并在超过阈值时报告（仅循环线程）
+     * @return 结束时间，作为下一个处理器的开始时间
+     */
+    std::chrono::steady_clock::time_point finish_call(std::chrono::steady_clock::time_point start,
+                                                      Log2Histogram* histogram, int fd, const char* kind);
+
+    const Log2Histogram& timer_lateness() const { return timer_lateness_; }
+    const Log2Histogram& functor_time() const { return functor_time_; }
+    uint64_t slow_calls() const { return slow_calls_.load(std::memory_order_relaxed); }
+    uint64_t total_timers() const { return total_timers_.load(); }
+    uint64_t total_functors() const { return total_functors_.load(); }
+    uint64_t total_wakeups() const { return total_wakeups_.load(); }
+
+private:
+    /**
+     * @brief 按时间轮的下一个到期时间设置timerfd（调用时需持有定时器锁）
+     * @param deadline 到期时间，time_point::max()表示停用
+     */
+    void arm_timerfd(std::chrono::steady_clock::time_point deadline);
+
+    int timer_fd_;                           // 驱动定时器的timerfd
+    TimingWheel timer_wheel_;                // 定时器时间轮
+    std::chrono::steady_clock::time_point timer_armed_; // timerfd当前设置的到期时间
+    mutable std::mutex timer_mutex_;         // 定时器互斥锁（保护跨线程添加/取消）
+    std::vector<TimingWheel::Expired> expired_timers_; // 到期定时器（仅循环线程访问）
+    std::atomic<uint64_t> timer_cancels_;    // 取消次数，执行到期批次时据此判断是否需要逐个检查
+
+    int wakeup_fd_;                          // 跨线程唤醒用的eventfd
+    MpscQueue<Functor> pending_functors_;    // 投递到循环线程的任务
+    std::atomic<bool> wakeup_pending_;       // 已写eventfd但循环线程尚未处理，用于合并唤醒
+    std::atomic<size_t> pending_count_;      // 已入队但尚未被取走计数的任务数，限定每次执行的数量
+    std::vector<Functor> local_functors_;    // 循环线程自己投递的任务（仅循环线程访问）
+    std::vector<Functor> running_functors_;  // 正在执行的本地任务，复用容量
+    std::atomic<std::thread::id> loop_thread_id_; // 正在运行run()的线程
+
+    std::atomic<uint64_t> total_timers_;     // 总定时器数
+    std::atomic<uint64_t> total_functors_;   // 总投递任务数
+    std::atomic<uint64_t> total_wakeups_;    // eventfd写入次数
+
+    Log2Histogram timer_lateness_;           // 定时器回调开始时间减去到期时间（纳秒）
+    Log2Histogram functor_time_;             // 投递任务执行时间（纳秒）
+    std::atomic<uint64_t> slow_calls_;       // 超过阈值的执行次数
+    int64_t slow_threshold_ns_;              // 慢处理器阈值，0表示关闭（仅循环线程访问）
+    SlowHandlerCallback slow_callback_;      // 慢处理器回调（仅循环线程访问）
+};
+
+} // namespace impl
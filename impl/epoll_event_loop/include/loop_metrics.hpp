@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace impl {
+
+/**
+ * @brief 按2的幂分桶的直方图
+ *
+ * 第0桶记录0，第b桶记录 [2^(b-1), 2^b) 的值。只允许一个线程写入（循环线程），
+ * 写入只做relaxed的读-改-写，不使用带锁前缀的原子指令；其他线程可以随时读取快照，
+ * 快照各字段之间不保证严格一致，用于监控足够。
+ */
+class Log2Histogram {
+public:
+    static constexpr size_t bucket_count = 48;
+
+    /**
+     * @brief 直方图快照
+     */
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        uint64_t buckets[bucket_count] = {};
+
+        /**
+         * @brief 近似百分位数，返回所在桶的上界（不超过max）
+         * @param p 百分位，取值0到100
+         */
+        uint64_t percentile(double p) const {
+            if (count == 0) {
+                return 0;
+            }
+            uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(count));
+            if (rank >= count) {
+                rank = count - 1;
+            }
+            uint64_t seen = 0;
+            for (size_t b = 0; b < bucket_count; ++b) {
+                seen += buckets[b];
+                if (seen > rank) {
+                    uint64_t upper = b == 0 ? 0 : (b >= 64 ? UINT64_MAX : (uint64_t(1) << b) - 1);
+                    return upper < max ? upper : max;
+                }
+            }
+            return max;
+        }
+
+        double mean() const {
+            return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+        }
+    };
+
+    void record(uint64_t value) {
+        size_t bucket = value == 0 ? 0 : static_cast<size_t>(64 - __builtin_clzll(value));
+        if (bucket >= bucket_count) {
+            bucket = bucket_count - 1;
+        }
+        bump(buckets_[bucket], 1);
+        bump(count_, 1);
+        bump(sum_, value);
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    Snapshot snapshot() const {
+        Snapshot snap;
+        snap.count = count_.load(std::memory_order_relaxed);
+        snap.sum = sum_.load(std::memory_order_relaxed);
+        snap.max = max_.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < bucket_count; ++b) {
+            snap.buckets[b] = buckets_[b].load(std::memory_order_relaxed);
+        }
+        return snap;
+    }
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> buckets_[bucket_count] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+/**
+ * @brief 事件循环的运行时指标快照
+ *
+ * 时间单位均为纳秒。
+ */
+struct LoopMetrics {
+    /**
+     * @brief 单个处理器类型的执行时间
+     */
+    struct HandlerTime {
+        std::string type;                    ///< 处理器类型名（已还原的C++类型名）
+        Log2Histogram::Snapshot time_ns;
+    };
+
+    uint64_t iterations = 0;                 ///< 返回了事件的epoll_wait次数
+    Log2Histogram::Snapshot events_per_wakeup;
+    Log2Histogram::Snapshot dispatch_delay_ns;   ///< epoll_wait返回到处理器开始执行的时间
+    Log2Histogram::Snapshot timer_lateness_ns;   ///< 定时器回调开始执行时间减去到期时间
+    Log2Histogram::Snapshot functor_time_ns;     ///< 投递任务的执行时间
+    std::vector<HandlerTime> handler_time_ns;    ///< 按处理器类型统计的执行时间
+    uint64_t slow_calls = 0;                 ///< 超过慢处理器阈值的次数
+};
+
+/**
+ * @brief 慢处理器报告
+ */
+struct SlowHandlerInfo {
+    int fd;                                  ///< IO处理器对应的fd，定时器和投递任务为-1
+    const char* kind;                        ///< 处理器类型名，定时器为"timer"，投递任务为"functor"
+    std::chrono::nanoseconds elapsed;        ///< 本次执行时间
+};
+
+} // namespace impl
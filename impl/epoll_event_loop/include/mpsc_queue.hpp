@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <utility>
+
+namespace impl {
+
+/**
+ * @brief 无锁多生产者单消费者队列（Vyukov算法）
+ *
+ * 特点：
+ * - push 只有一次原子交换和一次release存储，生产者之间不会互相等待
+ * - pop 只能由单个消费者线程调用
+ * - 队列中始终保留一个哨兵节点，出队时哨兵后移
+ *
+ * 生产者在交换头指针与链接next之间被挂起时，消费者会短暂看到“非空但取不到”的状态，
+ * pop_blocking 在这种情况下自旋等待链接完成。
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() {
+        Node* stub = new Node();
+        head_.store(stub, std::memory_order_relaxed);
+        tail_ = stub;
+    }
+
+    ~MpscQueue() {
+        T discard;
+        while (pop(discard)) {
+        }
+        delete tail_;
+    }
+
+    /**
+     * @brief 入队（任意线程）
+     */
+    void push(T value) {
+        Node* node = new Node(std::move(value));
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief 出队（仅消费者线程）
+     * @return 队列为空或生产者尚未完成链接时返回false
+     */
+    bool pop(T& value) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = std::move(next->value);
+        next->value = T();
+        tail_ = next;
+        delete tail;
+        return true;
+    }
+
+    /**
+     * @brief 出队，生产者正在入队时等待其完成（仅消费者线程）
+     * @return 队列确实为空时返回false
+     */
+    bool pop_blocking(T& value) {
+        while (!pop(value)) {
+            if (head_.load(std::memory_order_acquire) == tail_) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    /**
+     * @brief 检查队列是否为空（仅消费者线程）
+     */
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+private:
+    struct Node {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    alignas(64) std::atomic<Node*> head_;   // 生产者端
+    alignas(64) Node* tail_;                // 消费者端（哨兵）
+};
+
+} // namespace impl
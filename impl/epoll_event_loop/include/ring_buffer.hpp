@@ -0,0 +1,246 @@
+#pragma once
+
+#include <sys/uio.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace impl {
+
+/**
+ * @brief 可增长的环形字节缓冲区
+ *
+ * 特点：
+ * - 容量为2的幂，读写位置按掩码回绕，追加和消费都不移动数据
+ * - 可读/可写区域最多分为两段，直接映射为iovec供readv/writev使用
+ * - 空间不足时按2倍扩容并把数据整理为连续的一段
+ * - read_fd 使用readv同时读入缓冲区和栈上的溢出区，一次系统调用即可读取大块数据
+ */
+class RingBuffer {
+public:
+    static constexpr size_t initial_capacity = 4096;
+    static constexpr size_t spill_size = 65536;
+
+    explicit RingBuffer(size_t capacity = initial_capacity)
+        : capacity_(round_up(capacity))
+        , data_(new char[capacity_])
+        , read_pos_(0)
+        , size_(0) {}
+
+    RingBuffer(RingBuffer&&) noexcept = default;
+    RingBuffer& operator=(RingBuffer&&) noexcept = default;
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    /**
+     * @brief 可读字节数
+     */
+    size_t readable_bytes() const { return size_; }
+
+    /**
+     * @brief 不扩容时的可写字节数
+     */
+    size_t writable_bytes() const { return capacity_ - size_; }
+
+    /**
+     * @brief 当前容量
+     */
+    size_t capacity() const { return capacity_; }
+
+    bool empty() const { return size_ == 0; }
+
+    /**
+     * @brief 追加数据，空间不足时扩容
+     */
+    void append(const void* data, size_t len) {
+        ensure_writable(len);
+        const char* src = static_cast<const char*>(data);
+        size_t write_pos = (read_pos_ + size_) & mask();
+        size_t first = std::min(len, capacity_ - write_pos);
+        std::memcpy(data_.get() + write_pos, src, first);
+        std::memcpy(data_.get(), src + first, len - first);
+        size_ += len;
+    }
+
+    void append(const std::string& data) {
+        append(data.data(), data.size());
+    }
+
+    /**
+     * @brief 确保至少有len字节的可写空间
+     */
+    void ensure_writable(size_t len) {
+        if (writable_bytes() < len) {
+            grow(size_ + len);
+        }
+    }
+
+    /**
+     * @brief 填充可读区域的iovec
+     * @param vec 至少2个元素的数组
+     * @return 使用的iovec数量（0~2）
+     */
+    int readable_segments(struct iovec* vec) const {
+        if (size_ == 0) {
+            return 0;
+        }
+        size_t first = std::min(size_, capacity_ - read_pos_);
+        vec[0].iov_base = data_.get() + read_pos_;
+        vec[0].iov_len = first;
+        if (first == size_) {
+            return 1;
+        }
+        vec[1].iov_base = data_.get();
+        vec[1].iov_len = size_ - first;
+        return 2;
+    }
+
+    /**
+     * @brief 填充可写区域的iovec
+     * @param vec 至少2个元素的数组
+     * @return 使用的iovec数量（0~2）
+     */
+    int writable_segments(struct iovec* vec) {
+        size_t free = writable_bytes();
+        if (free == 0) {
+            return 0;
+        }
+        size_t write_pos = (read_pos_ + size_) & mask();
+        size_t first = std::min(free, capacity_ - write_pos);
+        vec[0].iov_base = data_.get() + write_pos;
+        vec[0].iov_len = first;
+        if (first == free) {
+            return 1;
+        }
+        vec[1].iov_base = data_.get();
+        vec[1].iov_len = free - first;
+        return 2;
+    }
+
+    /**
+     * @brief 确认通过writable_segments写入了len字节
+     */
+    void commit(size_t len) {
+        size_ += std::min(len, writable_bytes());
+    }
+
+    /**
+     * @brief 消费len字节
+     */
+    void retrieve(size_t len) {
+        if (len >= size_) {
+            retrieve_all();
+            return;
+        }
+        read_pos_ = (read_pos_ + len) & mask();
+        size_ -= len;
+    }
+
+    /**
+     * @brief 消费全部数据；清空后读位置归零，使后续数据尽量保持连续
+     */
+    void retrieve_all() {
+        read_pos_ = 0;
+        size_ = 0;
+    }
+
+    /**
+     * @brief 取出len字节为字符串
+     */
+    std::string retrieve_as_string(size_t len) {
+        len = std::min(len, size_);
+        std::string result(len, '\0');
+        copy_out(&result[0], len);
+        retrieve(len);
+        return result;
+    }
+
+    std::string retrieve_all_as_string() {
+        return retrieve_as_string(size_);
+    }
+
+    /**
+     * @brief 复制前len字节但不消费
+     */
+    size_t copy_out(void* dest, size_t len) const {
+        len = std::min(len, size_);
+        size_t first = std::min(len, capacity_ - read_pos_);
+        std::memcpy(dest, data_.get() + read_pos_, first);
+        std::memcpy(static_cast<char*>(dest) + first, data_.get(), len - first);
+        return len;
+    }
+
+    /**
+     * @brief 返回指向全部可读数据的连续指针
+     *
+     * 数据回绕时先整理为连续的一段，因此解析协议时可以直接按指针访问。
+     */
+    const char* linearize() {
+        if (read_pos_ + size_ > capacity_) {
+            std::unique_ptr<char[]> data(new char[capacity_]);
+            copy_out(data.get(), size_);
+            data_ = std::move(data);
+            read_pos_ = 0;
+        }
+        return data_.get() + read_pos_;
+    }
+
+    /**
+     * @brief 从fd读取数据
+     *
+     * 一次readv同时读入缓冲区空闲区域和栈上64KB溢出区，溢出部分再追加到缓冲区。
+     * 小连接不必预先分配大缓冲区，大块数据也只需一次系统调用。
+     * @param fd 文件描述符
+     * @param saved_errno 读取失败时保存errno
+     * @return readv的返回值
+     */
+    ssize_t read_fd(int fd, int* saved_errno) {
+        char spill[spill_size];
+        struct iovec vec[3] = {};
+        int count = writable_segments(vec);
+        size_t writable = writable_bytes();
+        vec[count].iov_base = spill;
+        vec[count].iov_len = sizeof(spill);
+        ++count;
+
+        ssize_t n = readv(fd, vec, count);
+        if (n < 0) {
+            *saved_errno = errno;
+        } else if (static_cast<size_t>(n) <= writable) {
+            commit(static_cast<size_t>(n));
+        } else {
+            commit(writable);
+            append(spill, static_cast<size_t>(n) - writable);
+        }
+        return n;
+    }
+
+private:
+    static size_t round_up(size_t n) {
+        size_t capacity = 1;
+        while (capacity < n) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    size_t mask() const { return capacity_ - 1; }
+
+    void grow(size_t min_capacity) {
+        size_t capacity = round_up(std::max(min_capacity, capacity_ * 2));
+        std::unique_ptr<char[]> data(new char[capacity]);
+        copy_out(data.get(), size_);
+        data_ = std::move(data);
+        capacity_ = capacity;
+        read_pos_ = 0;
+    }
+
+    size_t capacity_;
+    std::unique_ptr<char[]> data_;
+    size_t read_pos_;
+    size_t size_;
+};
+
+} // namespace impl
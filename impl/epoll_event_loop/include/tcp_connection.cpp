@@ -0,0 +1,426 @@
+#include "tcp_connection.hpp"
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include <signal.h>
+#include <algorithm>
+#include <iostream>
+
+namespace impl {
+
+namespace {
+
+/**
+ * @brief 不会触发SIGPIPE的sendfile
+ *
+ * sendfile不能像sendmsg一样传MSG_NOSIGNAL。对端关闭时内核向当前线程发送SIGPIPE，
+ * 默认处理是终止进程，因此调用期间在本线程屏蔽SIGPIPE，并取走这次调用产生的信号。
+ * 调用前已经挂起的SIGPIPE不属于这次调用，保持原样。
+ */
+ssize_t sendfile_nosignal(int out_fd, int in_fd, off_t* offset, size_t count) {
+    sigset_t pipe_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+
+    sigset_t pending;
+    sigpending(&pending);
+    bool was_pending = sigismember(&pending, SIGPIPE) == 1;
+
+    sigset_t old_set;
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+    ssize_t n = ::sendfile(out_fd, in_fd, offset, count);
+    int saved_errno = errno;
+
+    if (n < 0 && saved_errno == EPIPE && !was_pending) {
+        struct timespec zero = {0, 0};
+        while (sigtimedwait(&pipe_set, nullptr, &zero) == -1 && errno == EINTR) {
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+    errno = saved_errno;
+    return n;
+}
+
+} // namespace
+
+TcpConnection::Ptr TcpConnection::create(EpollEventLoop& loop, int fd) {
+    return std::make_shared<TcpConnection>(private_tag{}, loop, fd);
+}
+
+TcpConnection::TcpConnection(private_tag, EpollEventLoop& loop, int fd)
+    : loop_(loop)
+    , fd_(fd)
+    , state_(State::CONNECTING)
+    , interest_(0)
+    , flush_scheduled_(false)
+    , above_high_water_(false)
+    , high_water_mark_(64 * 1024 * 1024)
+    , low_water_mark_(0)
+    , write_calls_(0)
+    , sendfile_calls_(0)
+    , file_marked_bytes_(0) {}
+
+TcpConnection::~TcpConnection() {
+    if (fd_ != -1 && state_ != State::DISCONNECTED) {
+        close(fd_);
+    }
+}
+
+void TcpConnection::start() {
+    auto self = shared_from_this();
+    loop_.run_in_loop([self]() {
+        if (self->state_ != State::CONNECTING) {
+            return;
+        }
+        // 保留start之前send可能记录的EPOLLOUT，一并注册
+        self->interest_ |= EPOLLIN;
+        self->loop_.add_fd(self->fd_, self->interest_, self);
+        self->state_ = State::CONNECTED;
+        if (self->connection_callback_) {
+            self->connection_callback_(self);
+        }
+        if (!self->output_.empty()) {
+            self->schedule_flush();
+        }
+    });
+}
+
+void TcpConnection::send(const void* data, size_t len) {
+    if (loop_.is_in_loop_thread()) {
+        send_in_loop(data, len);
+        return;
+    }
+    auto self = shared_from_this();
+    std::string copy(static_cast<const char*>(data), len);
+    loop_.queue_in_loop([self, copy = std::move(copy)]() {
+        self->send_in_loop(copy.data(), copy.size());
+    });
+}
+
+void TcpConnection::send(const std::string& data) {
+    send(data.data(), data.size());
+}
+
+void TcpConnection::send(RingBuffer& buffer) {
+    struct iovec vec[2] = {};
+    int count = buffer.readable_segments(vec);
+    for (int i = 0; i < count; ++i) {
+        send_in_loop(vec[i].iov_base, vec[i].iov_len);
+    }
+    buffer.retrieve_all();
+}
+
+void TcpConnection::send_file(int fd, off_t offset, size_t len, SendFileCallback callback) {
+    if (loop_.is_in_loop_thread()) {
+        send_file_in_loop(fd, offset, len, std::move(callback));
+        return;
+    }
+    auto self = shared_from_this();
+    loop_.queue_in_loop([self, fd, offset, len, callback = std::move(callback)]() mutable {
+        self->send_file_in_loop(fd, offset, len, std::move(callback));
+    });
+}
+
+size_t TcpConnection::pending_file_bytes() const {
+    size_t total = 0;
+    for (const auto& file : files_) {
+        total += file.remaining;
+    }
+    return total;
+}
+
+void TcpConnection::shutdown() {
+    auto self = shared_from_this();
+    loop_.run_in_loop([self]() {
+        if (self->state_ != State::CONNECTED) {
+            return;
+        }
+        self->state_ = State::DISCONNECTING;
+        // 没有待写数据时立即关闭写端，否则等输出缓冲区写完
+        if (self->output_.empty() && self->files_.empty() && !self->flush_scheduled_ &&
+            !(self->interest_ & EPOLLOUT)) {
+            ::shutdown(self->fd_, SHUT_WR);
+        }
+    });
+}
+
+void TcpConnection::force_close() {
+    auto self = shared_from_this();
+    loop_.run_in_loop([self]() {
+        self->handle_close();
+    });
+}
+
+void TcpConnection::pause_reading() {
+    auto self = shared_from_this();
+    loop_.run_in_loop([self]() {
+        self->update_interest(self->interest_ & ~static_cast<uint32_t>(EPOLLIN));
+    });
+}
+
+void TcpConnection::resume_reading() {
+    auto self = shared_from_this();
+    loop_.run_in_loop([self]() {
+        self->update_interest(self->interest_ | EPOLLIN);
+    });
+}
+
+void TcpConnection::handle_event(int fd, uint32_t events) {
+    (void)fd;
+    // 回调中可能释放外部持有的引用，处理期间保持连接存活
+    Ptr guard = shared_from_this();
+
+    if (events & (EPOLLIN | EPOLLPRI)) {
+        handle_read();
+    }
+    if ((events & EPOLLOUT) && state_ != State::DISCONNECTED) {
+        handle_write();
+    }
+}
+
+void TcpConnection::handle_error(int fd, const std::string& error) {
+    (void)fd;
+    (void)error;
+    Ptr guard = shared_from_this();
+
+    // 对端关闭时可能还有未读数据，先尽量读出再关闭
+    if (state_ != State::DISCONNECTED) {
+        handle_read();
+    }
+    handle_close();
+}
+
+void TcpConnection::send_in_loop(const void* data, size_t len) {
+    if (state_ == State::DISCONNECTED || len == 0) {
+        return;
+    }
+
+    size_t before = output_.readable_bytes();
+    output_.append(data, len);
+    size_t after = output_.readable_bytes();
+
+    if (before < high_water_mark_ && after >= high_water_mark_) {
+        above_high_water_ = true;
+        if (high_water_mark_callback_) {
+            high_water_mark_callback_(shared_from_this(), after);
+        }
+    }
+
+    schedule_flush();
+}
+
+void TcpConnection::send_file_in_loop(int fd, off_t offset, size_t len, SendFileCallback callback) {
+    if (state_ == State::DISCONNECTED) {
+        if (callback) {
+            callback(shared_from_this(), false);
+        }
+        return;
+    }
+
+    // 当前输出缓冲区中尚未归属任何文件段的字节都排在这个文件之前
+    FileSegment file;
+    file.fd = fd;
+    file.offset = offset;
+    file.remaining = len;
+    file.preceding_bytes = output_.readable_bytes() - file_marked_bytes_;
+    file.callback = std::move(callback);
+    file_marked_bytes_ += file.preceding_bytes;
+    files_.push_back(std::move(file));
+
+    schedule_flush();
+}
+
+void TcpConnection::schedule_flush() {
+    // EPOLLOUT已注册时由可写事件负责写出；否则本批结束时统一写一次
+    if (flush_scheduled_ || (interest_ & EPOLLOUT)) {
+        return;
+    }
+    flush_scheduled_ = true;
+    auto self = shared_from_this();
+    loop_.queue_in_loop([self]() {
+        self->flush_scheduled_ = false;
+        // 尚未start的连接先积压数据，注册后再写出
+        if (self->state_ == State::CONNECTED || self->state_ == State::DISCONNECTING) {
+            self->handle_write();
+        }
+    });
+}
+
+void TcpConnection::update_interest(uint32_t interest) {
+    if (interest == interest_ || state_ == State::DISCONNECTED || state_ == State::CONNECTING) {
+        interest_ = interest;
+        return;
+    }
+    interest_ = interest;
+    loop_.modify_fd(fd_, interest_);
+}
+
+void TcpConnection::handle_read() {
+    int saved_errno = 0;
+    ssize_t n = input_.read_fd(fd_, &saved_errno);
+
+    if (n > 0) {
+        if (message_callback_) {
+            message_callback_(shared_from_this(), input_);
+        } else {
+            input_.retrieve_all();
+        }
+    } else if (n == 0) {
+        handle_close();
+    } else if (saved_errno != EAGAIN && saved_errno != EWOULDBLOCK && saved_errno != EINTR) {
+        handle_close();
+    }
+}
+
+void TcpConnection::handle_write() {
+    bool blocked = false;
+    while (!blocked && (!output_.empty() || !files_.empty())) {
+        // 队首文件之前的缓冲数据先写出；没有文件时写出全部缓冲数据
+        size_t limit = files_.empty() ? output_.readable_bytes() : files_.front().preceding_bytes;
+        if (limit > 0) {
+            ssize_t n = write_buffered(limit);
+            if (n < 0) {
+                handle_close();
+                return;
+            }
+            if (!files_.empty()) {
+                files_.front().preceding_bytes -= static_cast<size_t>(n);
+                file_marked_bytes_ -= static_cast<size_t>(n);
+            }
+            blocked = static_cast<size_t>(n) < limit;
+            continue;
+        }
+        if (!write_front_file(blocked)) {
+            return;
+        }
+    }
+
+    if (output_.empty() && files_.empty()) {
+        after_output_drained();
+    } else if (!(interest_ & EPOLLOUT)) {
+        update_interest(interest_ | EPOLLOUT);
+    }
+}
+
+ssize_t TcpConnection::write_buffered(size_t limit) {
+    struct iovec vec[2] = {};
+    int count = output_.readable_segments(vec);
+    size_t total = 0;
+    for (int i = 0; i < count; ++i) {
+        vec[i].iov_len = std::min(vec[i].iov_len, limit - total);
+        total += vec[i].iov_len;
+    }
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = vec;
+    msg.msg_iovlen = static_cast<size_t>(count);
+
+    // 等价于writev，MSG_NOSIGNAL避免对端关闭时触发SIGPIPE
+    ssize_t n = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+    write_calls_++;
+
+    if (n > 0) {
+        output_.retrieve(static_cast<size_t>(n));
+        check_low_water_mark();
+        return n;
+    }
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        return -1;
+    }
+    return 0;
+}
+
+bool TcpConnection::write_front_file(bool& blocked) {
+    FileSegment& file = files_.front();
+    while (file.remaining > 0) {
+        // sendfile在内核中把页缓存直接送入socket，不经过用户态缓冲区
+        off_t offset = file.offset;
+        ssize_t n = sendfile_nosignal(fd_, file.fd, &offset, file.remaining);
+        sendfile_calls_++;
+
+        if (n > 0) {
+            file.offset += n;
+            file.remaining -= static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            blocked = true;
+            return true;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        // 文件不足len字节或读取/写出出错：已发出的部分无法撤回，只能关闭连接
+        handle_close();
+        return false;
+    }
+
+    finish_front_file(true);
+    return state_ != State::DISCONNECTED;
+}
+
+void TcpConnection::finish_front_file(bool success) {
+    // 先出队再回调，回调中可以继续send或send_file
+    SendFileCallback callback = std::move(files_.front().callback);
+    file_marked_bytes_ -= files_.front().preceding_bytes;
+    files_.pop_front();
+    if (callback) {
+        callback(shared_from_this(), success);
+    }
+}
+
+void TcpConnection::check_low_water_mark() {
+    // 每次部分写出后都检查，积压降到低水位即可恢复生产，不必等到完全写空
+    if (above_high_water_ && output_.readable_bytes() <= low_water_mark_) {
+        above_high_water_ = false;
+        if (low_water_mark_callback_) {
+            low_water_mark_callback_(shared_from_this(), output_.readable_bytes());
+        }
+    }
+}
+
+void TcpConnection::after_output_drained() {
+    if (interest_ & EPOLLOUT) {
+        update_interest(interest_ & ~static_cast<uint32_t>(EPOLLOUT));
+    }
+
+    if (write_complete_callback_) {
+        write_complete_callback_(shared_from_this());
+    }
+
+    if (state_ == State::DISCONNECTING) {
+        ::shutdown(fd_, SHUT_WR);
+    }
+}
+
+void TcpConnection::handle_close() {
+    if (state_ == State::DISCONNECTED) {
+        return;
+    }
+    Ptr guard = shared_from_this();
+    bool registered = state_ != State::CONNECTING;
+    state_ = State::DISCONNECTED;
+
+    if (registered) {
+        try {
+            loop_.remove_fd(fd_);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to remove connection fd " << fd_ << ": " << e.what() << std::endl;
+        }
+    }
+
+    // 未发送完的文件段全部以失败结束
+    while (!files_.empty()) {
+        finish_front_file(false);
+    }
+
+    if (close_callback_) {
+        close_callback_(guard);
+    }
+    close(fd_);
+}
+
+} // namespace impl
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "epoll_event_loop.hpp"
+#include "ring_buffer.hpp"
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace impl {
+
+/**
+ * @brief 基于EpollEventLoop的带缓冲TCP连接
+ *
+ * 特点：
+ * - 输入/输出使用可增长的环形缓冲区，读取使用readv + 栈上溢出区，写出使用writev
+ * - 写不完的数据留在输出缓冲区，自动注册EPOLLOUT，写完后自动注销
+ * - 同一轮事件循环中多次send只在本批结束时合并为一次写出
+ * - 高/低水位回调用于背压：输出积压超过高水位时通知上层暂停生产，降到低水位以下时再通知恢复
+ * - send_file 用sendfile把文件内容直接从页缓存写到socket，与缓冲数据按调用顺序排队
+ * - 所有状态只在所属循环线程上访问；send/shutdown/force_close 可以从任意线程调用
+ *
+ * 连接注册到事件循环后由循环持有引用，关闭时自动从循环中移除。
+ */
+class TcpConnection : public EventHandler, public std::enable_shared_from_this<TcpConnection> {
+    struct private_tag {};
+
+public:
+    using Ptr = std::shared_ptr<TcpConnection>;
+    using ConnectionCallback = std::function<void(const Ptr&)>;
+    using MessageCallback = std::function<void(const Ptr&, RingBuffer&)>;
+    using WaterMarkCallback = std::function<void(const Ptr&, size_t)>;
+
+    /**
+     * @brief 文件发送完成回调，success为false表示发送失败或连接在发送完之前关闭
+     */
+    using SendFileCallback = std::function<void(const Ptr&, bool success)>;
+
+    /**
+     * @brief 连接状态
+     */
+    enum class State {
+        CONNECTING,
+        CONNECTED,
+        DISCONNECTING,   ///< 已调用shutdown，等待输出缓冲区写完后关闭写端
+        DISCONNECTED
+    };
+
+    /**
+     * @brief 创建连接，连接接管fd的所有权
+     * @param loop 所属事件循环
+     * @param fd 已连接的socket
+     */
+    static Ptr create(EpollEventLoop& loop, int fd);
+
+    TcpConnection(private_tag, EpollEventLoop& loop, int fd);
+    ~TcpConnection() override;
+
+    /**
+     * @brief 注册到事件循环并开始读取（在循环线程上执行）
+     */
+    void start();
+
+    /**
+     * @brief 发送数据
+     *
+     * 在循环线程上调用时追加到输出缓冲区，本批结束时统一写出；其他线程调用时复制数据后投递到循环线程。
+     */
+    void send(const void* data, size_t len);
+    void send(const std::string& data);
+
+    /**
+     * @brief 发送缓冲区中的全部数据并清空该缓冲区（仅循环线程）
+     */
+    void send(RingBuffer& buffer);
+
+    /**
+     * @brief 零拷贝发送文件的一段内容
+     *
+     * 之前send的数据写完后才开始发送文件，之后send的数据在文件发送完后写出。
+     * 写不完时在EPOLLOUT上继续；文件读取出错或不足len字节时连接被关闭（对端已无法区分消息边界）。
+     * 调用者需保证fd在回调之前保持打开，文件读取位置不受影响。可以从任意线程调用。
+     * @param fd 文件描述符
+     * @param offset 文件偏移
+     * @param len 发送字节数
+     * @param callback 完成回调（在循环线程上执行），可为空
+     */
+    void send_file(int fd, off_t offset, size_t len, SendFileCallback callback = nullptr);
+
+    /**
+     * @brief 输出缓冲区和待发送文件都写完后关闭写端
+     */
+    void shutdown();
+
+    /**
+     * @brief 立即关闭连接，丢弃未写出的数据
+     */
+    void force_close();
+
+    /**
+     * @brief 暂停/恢复读取，用于向对端施加背压
+     */
+    void pause_reading();
+    void resume_reading();
+
+    void set_connection_callback(ConnectionCallback cb) { connection_callback_ = std::move(cb); }
+    void set_message_callback(MessageCallback cb) { message_callback_ = std::move(cb); }
+    void set_close_callback(ConnectionCallback cb) { close_callback_ = std::move(cb); }
+    void set_write_complete_callback(ConnectionCallback cb) { write_complete_callback_ = std::move(cb); }
+
+    /**
+     * @brief 输出缓冲区从高水位以下增长到高水位及以上时回调
+     */
+    void set_high_water_mark_callback(WaterMarkCallback cb, size_t high_water_mark) {
+        high_water_mark_callback_ = std::move(cb);
+        high_water_mark_ = high_water_mark;
+    }
+
+    /**
+     * @brief 触发过高水位后，输出缓冲区降到低水位及以下时回调
+     */
+    void set_low_water_mark_callback(WaterMarkCallback cb, size_t low_water_mark) {
+        low_water_mark_callback_ = std::move(cb);
+        low_water_mark_ = low_water_mark;
+    }
+
+    int fd() const { return fd_; }
+    EpollEventLoop& loop() const { return loop_; }
+    State state() const { return state_; }
+    bool connected() const { return state_ == State::CONNECTED; }
+
+    /**
+     * @brief 是否已注册EPOLLOUT（输出缓冲区有数据未能一次写完）
+     */
+    bool writing() const { return (interest_ & EPOLLOUT) != 0; }
+
+    RingBuffer& input_buffer() { return input_; }
+    size_t pending_output_bytes() const { return output_.readable_bytes(); }
+
+    /**
+     * @brief 尚未发送的文件字节数（仅循环线程）
+     */
+    size_t pending_file_bytes() const;
+
+    /**
+     * @brief 写系统调用次数（用于观察写合并效果）
+     */
+    uint64_t write_calls() const { return write_calls_; }
+
+    /**
+     * @brief sendfile系统调用次数
+     */
+    uint64_t sendfile_calls() const { return sendfile_calls_; }
+
+    /**
+     * @brief 关联任意上层状态
+     */
+    void set_context(std::shared_ptr<void> context) { context_ = std::move(context); }
+
+    template <typename T>
+    std::shared_ptr<T> context() const {
+        return std::static_pointer_cast<T>(context_);
+    }
+
+    void handle_event(int fd, uint32_t events) override;
+    void handle_error(int fd, const std::string& error) override;
+
+    TcpConnection(const TcpConnection&) = delete;
+    TcpConnection& operator=(const TcpConnection&) = delete;
+
+private:
+    /**
+     * @brief 排队中的文件段
+     *
+     * preceding_bytes 是输出缓冲区中排在该文件之前、尚未写出的字节数（相对于前一个文件段）。
+     */
+    struct FileSegment {
+        int fd;
+        off_t offset;
+        size_t remaining;
+        size_t preceding_bytes;
+        SendFileCallback callback;
+    };
+
+    void send_in_loop(const void* data, size_t len);
+    void send_file_in_loop(int fd, off_t offset, size_t len, SendFileCallback callback);
+    ssize_t write_buffered(size_t limit);
+    bool write_front_file(bool& blocked);
+    void finish_front_file(bool success);
+    void schedule_flush();
+    void update_interest(uint32_t interest);
+    void handle_read();
+    void handle_write();
+    void handle_close();
+    void check_low_water_mark();
+    void after_output_drained();
+
+    EpollEventLoop& loop_;
+    int fd_;
+    State state_;
+    uint32_t interest_;                 // 当前注册的epoll事件
+    bool flush_scheduled_;              // 本批结束时是否已安排写出
+    bool above_high_water_;             // 是否处于高水位状态
+
+    RingBuffer input_;
+    RingBuffer output_;
+
+    size_t high_water_mark_;
+    size_t low_water_mark_;
+    uint64_t write_calls_;
+    uint64_t sendfile_calls_;
+
+    std::deque<FileSegment> files_;
+    size_t file_marked_bytes_;          // 所有文件段的preceding_bytes之和，超出部分排在最后一个文件之后
+
+    ConnectionCallback connection_callback_;
+    MessageCallback message_callback_;
+    ConnectionCallback close_callback_;
+    ConnectionCallback write_complete_callback_;
+    WaterMarkCallback high_water_mark_callback_;
+    WaterMarkCallback low_water_mark_callback_;
+
+    std::shared_ptr<void> context_;
+};
+
+} // namespace impl
@@ -0,0 +1,329 @@
+#include "timing_wheel.hpp"
+#include <algorithm>
+
+namespace impl {
+
+TimingWheel::TimingWheel(std::chrono::nanoseconds tick)
+    : origin_(clock::now())
+    , tick_ns_(std::max<int64_t>(1, tick.count()))
+    , now_(0)
+    , size_(0)
+    , stale_overflow_(0) {
+    std::fill(std::begin(heads_), std::end(heads_), nil);
+    std::fill(std::begin(occupied_), std::end(occupied_), 0);
+}
+
+uint64_t TimingWheel::add(clock::time_point deadline, std::shared_ptr<Timer> timer,
+                          std::chrono::nanoseconds interval) {
+    uint32_t index = allocate_node();
+    Node& node = nodes_[index];
+    node.timer = std::move(timer);
+    node.interval = interval.count() > 0
+        ? std::max<uint64_t>(1, (interval.count() + tick_ns_ - 1) / tick_ns_)
+        : 0;
+    node.expire = std::max(to_ticks_ceil(deadline), now_ + 1);
+    place(index);
+    ++size_;
+    return (static_cast<uint64_t>(node.generation) << 32) | index;
+}
+
+bool TimingWheel::cancel(uint64_t id) {
+    Node* node = find(id);
+    if (!node) {
+        return false;
+    }
+    uint32_t index = static_cast<uint32_t>(id);
+    if (node->bucket == fired) {
+        release_node(index); // 已到期的节点不在时间轮中，也已从计数中扣除
+        return true;
+    }
+    unlink(index);
+    release_node(index);
+    --size_;
+    return true;
+}
+
+bool TimingWheel::reschedule(uint64_t id, clock::time_point deadline) {
+    Node* node = find(id);
+    if (!node || node->bucket == fired) {
+        return false;
+    }
+    uint32_t index = static_cast<uint32_t>(id);
+    unlink(index);
+    node->expire = std::max(to_ticks_ceil(deadline), now_ + 1);
+    place(index);
+    return true;
+}
+
+size_t TimingWheel::advance(clock::time_point now, std::vector<Expired>& expired) {
+    uint64_t target = to_ticks_floor(now);
+    release_fired();
+    if (target <= now_) {
+        return 0;
+    }
+
+    pending_.clear();
+
+    // 收集被越过的槽：若更高位发生变化，本层所有槽都被越过；否则只收集 (旧位置, 新位置] 区间
+    for (int level = 0; level < levels; ++level) {
+        const int shift = level * level_bits;
+        const int upper = shift + level_bits;
+        const bool wrapped = (target >> upper) != (now_ >> upper);
+
+        uint64_t mask;
+        if (wrapped) {
+            mask = ~uint64_t(0);
+        } else {
+            uint64_t old_slot = (now_ >> shift) & (slots_per_level - 1);
+            uint64_t new_slot = (target >> shift) & (slots_per_level - 1);
+            mask = ((uint64_t(2) << new_slot) - 1) & ~((uint64_t(2) << old_slot) - 1);
+        }
+
+        uint64_t hit = mask & occupied_[level];
+        while (hit) {
+            int slot = __builtin_ctzll(hit);
+            hit &= hit - 1;
+            collect_slot(static_cast<uint16_t>(level * slots_per_level + slot), pending_);
+        }
+        occupied_[level] &= ~mask;
+
+        if (!wrapped) {
+            break; // 更高层的位置没有变化
+        }
+    }
+
+    now_ = target;
+
+    // 溢出堆中进入时间轮范围或已到期的定时器
+    const int wheel_bits = levels * level_bits;
+    while (!overflow_.empty()) {
+        const OverflowEntry& top = overflow_.front();
+        if (top.expire > now_ && ((top.expire ^ now_) >> wheel_bits) != 0) {
+            break;
+        }
+        OverflowEntry entry = top;
+        std::pop_heap(overflow_.begin(), overflow_.end());
+        overflow_.pop_back();
+
+        Node& node = nodes_[entry.index];
+        if (node.bucket != in_overflow || node.overflow_token != entry.token) {
+            --stale_overflow_;
+            continue;
+        }
+        node.bucket = detached;
+        pending_.push_back(entry.index);
+    }
+
+    due_.clear();
+    for (uint32_t index : pending_) {
+        if (nodes_[index].expire <= now_) {
+            due_.push_back(index);
+        } else {
+            place(index);
+        }
+    }
+
+    std::stable_sort(due_.begin(), due_.end(), [this](uint32_t a, uint32_t b) {
+        return nodes_[a].expire < nodes_[b].expire;
+    });
+
+    for (uint32_t index : due_) {
+        Node& node = nodes_[index];
+        expired.push_back({(static_cast<uint64_t>(node.generation) << 32) | index, node.timer,
+                           from_ticks(node.expire)});
+
+        if (node.interval != 0) {
+            // 周期定时器：落后太多时跳过错过的周期，避免突发
+            node.expire += node.interval;
+            if (node.expire <= now_) {
+                node.expire = now_ + node.interval;
+            }
+            place(index);
+        } else {
+            // 回调执行前仍可被取消，由调用者在执行完这一批后调用release_fired()释放
+            node.bucket = fired;
+            fired_.push_back(index);
+            --size_;
+        }
+    }
+
+    return due_.size();
+}
+
+void TimingWheel::release_fired() {
+    for (uint32_t index : fired_) {
+        if (nodes_[index].bucket == fired) {
+            release_node(index);
+        }
+    }
+    fired_.clear();
+}
+
+TimingWheel::clock::time_point TimingWheel::next_expiry() {
+    for (int level = 0; level < levels; ++level) {
+        if (occupied_[level] == 0) {
+            continue;
+        }
+        const int shift = level * level_bits;
+        const int upper = shift + level_bits;
+        uint64_t slot = static_cast<uint64_t>(__builtin_ctzll(occupied_[level]));
+        uint64_t start = ((now_ >> upper) << upper) | (slot << shift);
+        return from_ticks(start);
+    }
+
+    prune_overflow();
+    if (!overflow_.empty()) {
+        return from_ticks(overflow_.front().expire);
+    }
+    return clock::time_point::max();
+}
+
+uint64_t TimingWheel::to_ticks_floor(clock::time_point tp) const {
+    if (tp <= origin_) {
+        return 0;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(tp - origin_).count();
+    return static_cast<uint64_t>(ns) / tick_ns_;
+}
+
+uint64_t TimingWheel::to_ticks_ceil(clock::time_point tp) const {
+    if (tp <= origin_) {
+        return 0;
+    }
+    if (tp == clock::time_point::max()) {
+        return ~uint64_t(0) >> 1;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(tp - origin_).count();
+    return (static_cast<uint64_t>(ns) + tick_ns_ - 1) / tick_ns_;
+}
+
+TimingWheel::clock::time_point TimingWheel::from_ticks(uint64_t ticks) const {
+    uint64_t limit = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(clock::time_point::max() - origin_).count())
+        / tick_ns_;
+    if (ticks >= limit) {
+        return clock::time_point::max();
+    }
+    return origin_ + std::chrono::duration_cast<clock::duration>(
+        std::chrono::nanoseconds(static_cast<int64_t>(ticks) * tick_ns_));
+}
+
+TimingWheel::Node* TimingWheel::find(uint64_t id) {
+    uint32_t index = static_cast<uint32_t>(id);
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+    if (index >= nodes_.size()) {
+        return nullptr;
+    }
+    Node& node = nodes_[index];
+    if (node.generation != generation || node.bucket == free_node) {
+        return nullptr;
+    }
+    return &node;
+}
+
+uint32_t TimingWheel::allocate_node() {
+    if (!free_nodes_.empty()) {
+        uint32_t index = free_nodes_.back();
+        free_nodes_.pop_back();
+        return index;
+    }
+    nodes_.emplace_back();
+    return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+void TimingWheel::release_node(uint32_t index) {
+    Node& node = nodes_[index];
+    node.timer.reset();
+    node.bucket = free_node;
+    node.prev = node.next = nil;
+    if (++node.generation == 0) {
+        node.generation = 1; // ID必须非0
+    }
+    free_nodes_.push_back(index);
+}
+
+void TimingWheel::place(uint32_t index) {
+    Node& node = nodes_[index];
+    uint64_t diff = node.expire ^ now_;
+    int level = (63 - __builtin_clzll(diff)) / level_bits;
+
+    if (level >= levels) {
+        node.bucket = in_overflow;
+        overflow_.push_back({node.expire, index, node.overflow_token});
+        std::push_heap(overflow_.begin(), overflow_.end());
+        return;
+    }
+
+    uint32_t slot = static_cast<uint32_t>(node.expire >> (level * level_bits)) & (slots_per_level - 1);
+    uint16_t bucket = static_cast<uint16_t>(level * slots_per_level + slot);
+
+    node.bucket = bucket;
+    node.prev = nil;
+    node.next = heads_[bucket];
+    if (node.next != nil) {
+        nodes_[node.next].prev = index;
+    }
+    heads_[bucket] = index;
+    occupied_[level] |= uint64_t(1) << slot;
+}
+
+void TimingWheel::unlink(uint32_t index) {
+    Node& node = nodes_[index];
+
+    if (node.bucket == in_overflow) {
+        // 堆条目延迟删除：修改token使其失效
+        ++node.overflow_token;
+        ++stale_overflow_;
+        node.bucket = detached;
+        if (overflow_.size() > 64 && stale_overflow_ * 2 > overflow_.size()) {
+            prune_overflow();
+        }
+        return;
+    }
+
+    if (node.bucket >= bucket_count) {
+        return;
+    }
+
+    if (node.prev != nil) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        heads_[node.bucket] = node.next;
+        if (node.next == nil) {
+            occupied_[node.bucket / slots_per_level] &= ~(uint64_t(1) << (node.bucket % slots_per_level));
+        }
+    }
+    if (node.next != nil) {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.prev = node.next = nil;
+    node.bucket = detached;
+}
+
+void TimingWheel::collect_slot(uint16_t bucket, std::vector<uint32_t>& out) {
+    uint32_t index = heads_[bucket];
+    heads_[bucket] = nil;
+    while (index != nil) {
+        Node& node = nodes_[index];
+        uint32_t next = node.next;
+        node.prev = node.next = nil;
+        node.bucket = detached;
+        out.push_back(index);
+        index = next;
+    }
+}
+
+void TimingWheel::prune_overflow() {
+    if (stale_overflow_ == 0) {
+        return;
+    }
+    auto is_stale = [this](const OverflowEntry& entry) {
+        const Node& node = nodes_[entry.index];
+        return node.bucket != in_overflow || node.overflow_token != entry.token;
+    };
+    overflow_.erase(std::remove_if(overflow_.begin(), overflow_.end(), is_stale), overflow_.end());
+    std::make_heap(overflow_.begin(), overflow_.end());
+    stale_overflow_ = 0;
+}
+
+} // namespace impl
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace impl {
+
+class Timer;
+
+/**
+ * @brief 分层时间轮
+ *
+ * 特点：
+ * - 6层、每层64个槽，时间粒度可配置（默认1微秒），覆盖约19小时；更远的定时器进入溢出小顶堆
+ * - 定时器节点存放在slab数组中，槽内用下标组成侵入式双向链表，添加/取消/重新调度均为O(1)
+ * - 每层用64位占用位图定位非空槽，推进时间时按位图批量收集到期槽，不逐tick扫描
+ * - 定时器ID由“代数<<32 | 下标”组成，节点复用后旧ID自动失效
+ * - 支持周期定时器，触发后按间隔重新挂入时间轮
+ * - 到期的一次性定时器保留到 release_fired()，期间仍可被取消，调用者用 alive() 跳过同一批中已被取消的定时器
+ *
+ * 放置规则：定时器到期tick与当前tick按6位一组比较，最高的不同组决定所在层，
+ * 该组的值决定槽位。时间推进越过某个槽时，槽内定时器要么到期，要么下沉到更低的层。
+ *
+ * 本类不是线程安全的，由 EpollEventLoop 负责串行化访问。
+ */
+class TimingWheel {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr int level_bits = 6;
+    static constexpr int levels = 6;
+    static constexpr int slots_per_level = 1 << level_bits;
+
+    /**
+     * @brief 到期的定时器
+     */
+    struct Expired {
+        uint64_t id;
+        std::shared_ptr<Timer> timer;
+        clock::time_point deadline;      // 本次到期时间（按tick取整），用于统计触发延迟
+    };
+
+    /**
+     * @brief 构造函数
+     * @param tick 时间粒度
+     */
+    explicit TimingWheel(std::chrono::nanoseconds tick = std::chrono::microseconds(1));
+
+    /**
+     * @brief 添加定时器
+     * @param deadline 到期时间，已过去的时间点在下一次推进时触发
+     * @param timer 定时器对象
+     * @param interval 周期间隔，0表示一次性定时器
+     * @return 定时器ID（非0）
+     */
+    uint64_t add(clock::time_point deadline, std::shared_ptr<Timer> timer,
+                 std::chrono::nanoseconds interval = std::chrono::nanoseconds(0));
+
+    /**
+     * @brief 取消定时器
+     *
+     * 也可以取消已由 advance() 返回、尚未执行回调的定时器。
+     * @param id 定时器ID
+     * @return 定时器存在且被取消时返回true
+     */
+    bool cancel(uint64_t id);
+
+    /**
+     * @brief 修改定时器的到期时间，周期间隔保持不变
+     * @param id 定时器ID
+     * @param deadline 新的到期时间
+     * @return 定时器存在且尚未到期（周期定时器总是未到期）时返回true
+     */
+    bool reschedule(uint64_t id, clock::time_point deadline);
+
+    /**
+     * @brief 推进时间并收集到期的定时器
+     * @param now 当前时间
+     * @param expired 输出参数，到期定时器按到期时间顺序追加到末尾
+     * @return 本次到期的定时器数量
+     */
+    size_t advance(clock::time_point now, std::vector<Expired>& expired);
+
+    /**
+     * @brief 检查定时器是否仍然有效（未被取消；一次性定时器在 release_fired() 之前都有效）
+     */
+    bool alive(uint64_t id) { return find(id) != nullptr; }
+
+    /**
+     * @brief 释放上一次 advance() 返回的一次性定时器，在执行完它们的回调后调用
+     *
+     * advance() 开始时也会调用，未调用时不会泄漏节点。
+     */
+    void release_fired();
+
+    /**
+     * @brief 下一次需要推进的时间
+     *
+     * 对最低层的定时器是精确到期时间；对更高层是所在槽的起始时间，届时定时器会下沉或到期。
+     * @return 没有定时器时返回 clock::time_point::max()
+     */
+    clock::time_point next_expiry();
+
+    /**
+     * @brief 获取定时器数量
+     */
+    size_t size() const { return size_; }
+
+    /**
+     * @brief 检查是否没有定时器
+     */
+    bool empty() const { return size_ == 0; }
+
+private:
+    static constexpr uint32_t nil = 0xFFFFFFFFu;
+    static constexpr uint16_t bucket_count = levels * slots_per_level;
+    static constexpr uint16_t in_overflow = bucket_count;
+    static constexpr uint16_t detached = bucket_count + 1;
+    static constexpr uint16_t free_node = bucket_count + 2;
+    static constexpr uint16_t fired = bucket_count + 3;    // 已到期、等待 release_fired() 的一次性定时器
+
+    /**
+     * @brief 定时器节点
+     */
+    struct Node {
+        uint64_t expire = 0;             // 到期tick
+        uint64_t interval = 0;           // 周期tick，0表示一次性
+        std::shared_ptr<Timer> timer;
+        uint32_t prev = nil;
+        uint32_t next = nil;
+        uint32_t generation = 1;         // 节点复用时递增，使旧ID失效
+        uint32_t overflow_token = 0;     // 溢出堆条目的有效性标记
+        uint16_t bucket = free_node;     // 所在槽（level * 64 + slot）或状态
+    };
+
+    /**
+     * @brief 溢出堆条目，token不匹配的条目已失效
+     */
+    struct OverflowEntry {
+        uint64_t expire;
+        uint32_t index;
+        uint32_t token;
+
+        bool operator<(const OverflowEntry& other) const {
+            return expire > other.expire; // 小顶堆
+        }
+    };
+
+    uint64_t to_ticks_floor(clock::time_point tp) const;
+    uint64_t to_ticks_ceil(clock::time_point tp) const;
+    clock::time_point from_ticks(uint64_t ticks) const;
+
+    Node* find(uint64_t id);
+    uint32_t allocate_node();
+    void release_node(uint32_t index);
+    void place(uint32_t index);
+    void unlink(uint32_t index);
+    void collect_slot(uint16_t bucket, std::vector<uint32_t>& out);
+    void prune_overflow();
+
+    clock::time_point origin_;                  // tick 0 对应的时间
+    int64_t tick_ns_;                           // 每tick纳秒数
+    uint64_t now_;                              // 已推进到的tick
+    size_t size_;                               // 定时器数量
+    size_t stale_overflow_;                     // 溢出堆中失效条目数
+
+    std::vector<Node> nodes_;                   // 节点slab
+    std::vector<uint32_t> free_nodes_;          // 空闲节点下标
+    uint32_t heads_[bucket_count];              // 各槽链表头
+    uint64_t occupied_[levels];                 // 各层槽占用位图
+    std::vector<OverflowEntry> overflow_;       // 超出时间轮范围的定时器
+    std::vector<uint32_t> pending_;             // 推进时的临时收集列表
+    std::vector<uint32_t> due_;                 // 推进时的到期列表
+    std::vector<uint32_t> fired_;               // 已到期、尚未释放的一次性定时器
+};
+
+} // namespace impl
@@ -0,0 +1,342 @@
+#include "udp_endpoint.hpp"
+#include <arpa/inet.h>
+#include <netinet/udp.h>
+#include <algorithm>
+#include <iostream>
+
+namespace impl {
+
+UdpEndpoint::Ptr UdpEndpoint::create(EpollEventLoop& loop, int fd, size_t batch_size, size_t max_datagram) {
+    return std::make_shared<UdpEndpoint>(private_tag{}, loop, fd, batch_size, max_datagram);
+}
+
+int UdpEndpoint::bind_socket(const std::string& ip, int port, bool reuse_port) {
+    sockaddr_in addr = make_address(ip, port);
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw epoll_event_loop_exception("Failed to create UDP socket: " + std::string(strerror(errno)));
+    }
+
+    try {
+        EpollEventLoop::set_reuseaddr(fd);
+        if (reuse_port) {
+            int opt = 1;
+            if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
+                throw epoll_event_loop_exception("Failed to set SO_REUSEPORT: " + std::string(strerror(errno)));
+            }
+        }
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+            throw epoll_event_loop_exception("Failed to bind UDP socket: " + std::string(strerror(errno)));
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    return fd;
+}
+
+sockaddr_in UdpEndpoint::make_address(const std::string& ip, int port) {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+        throw epoll_event_loop_exception("Invalid IPv4 address: " + ip);
+    }
+    return addr;
+}
+
+UdpEndpoint::UdpEndpoint(private_tag, EpollEventLoop& loop, int fd, size_t batch_size, size_t max_datagram)
+    : loop_(loop)
+    , fd_(fd)
+    , registered_(false)
+    , writing_(false)
+    , flush_scheduled_(false)
+    , gso_size_(0)
+    , batch_size_(std::max<size_t>(batch_size, 1))
+    , max_datagram_(std::max<size_t>(max_datagram, 1))
+    , recv_buffer_(batch_size_ * max_datagram_)
+    , recv_iov_(batch_size_)
+    , recv_addrs_(batch_size_)
+    , recv_msgs_(batch_size_)
+    , datagrams_(batch_size_)
+    , send_index_(0)
+    , recv_calls_(0)
+    , send_calls_(0)
+    , datagrams_received_(0)
+    , datagrams_sent_(0)
+    , send_errors_(0) {
+
+    // 接收批次的iovec和地址只在构造时设置一次，每次接收只需重置地址长度
+    for (size_t i = 0; i < batch_size_; ++i) {
+        recv_iov_[i].iov_base = &recv_buffer_[i * max_datagram_];
+        recv_iov_[i].iov_len = max_datagram_;
+
+        msghdr& hdr = recv_msgs_[i].msg_hdr;
+        std::memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_name = &recv_addrs_[i];
+        hdr.msg_iov = &recv_iov_[i];
+        hdr.msg_iovlen = 1;
+    }
+}
+
+UdpEndpoint::~UdpEndpoint() {
+    if (fd_ != -1) {
+        ::close(fd_);
+    }
+}
+
+void UdpEndpoint::start() {
+    auto self = shared_from_this();
+    loop_.run_in_loop([self]() {
+        if (self->registered_ || self->fd_ == -1) {
+            return;
+        }
+        // start之前发送遇到EAGAIN时记录的EPOLLOUT一并注册
+        uint32_t events = EPOLLIN | (self->writing_ ? static_cast<uint32_t>(EPOLLOUT) : 0);
+        self->loop_.add_fd(self->fd_, events, self);
+        self->registered_ = true;
+    });
+}
+
+void UdpEndpoint::close() {
+    auto self = shared_from_this();
+    loop_.run_in_loop([self]() {
+        if (self->fd_ == -1) {
+            return;
+        }
+        if (self->registered_) {
+            try {
+                self->loop_.remove_fd(self->fd_);
+            } catch (const std::exception& e) {
+                std::cerr << "Failed to remove UDP fd " << self->fd_ << ": " << e.what() << std::endl;
+            }
+            self->registered_ = false;
+        }
+        ::close(self->fd_);
+        self->fd_ = -1;
+        self->send_buffer_.clear();
+        self->send_queue_.clear();
+        self->send_index_ = 0;
+    });
+}
+
+bool UdpEndpoint::enable_gso(uint16_t segment_size) {
+    // 只用socket选项探测内核是否支持，随后清零：分段大小通过每个消息的控制信息指定，
+    // 否则所有超过分段大小的普通数据报也会被切分
+    int value = segment_size;
+    if (segment_size == 0 || setsockopt(fd_, SOL_UDP, UDP_SEGMENT, &value, sizeof(value)) == -1) {
+        return false;
+    }
+    value = 0;
+    setsockopt(fd_, SOL_UDP, UDP_SEGMENT, &value, sizeof(value));
+    gso_size_ = segment_size;
+    return true;
+}
+
+void UdpEndpoint::send_to(const sockaddr_in& peer, const void* data, size_t len) {
+    if (loop_.is_in_loop_thread()) {
+        send_in_loop(peer, data, len);
+        return;
+    }
+    auto self = shared_from_this();
+    std::string copy(static_cast<const char*>(data), len);
+    loop_.queue_in_loop([self, peer, copy = std::move(copy)]() {
+        self->send_in_loop(peer, copy.data(), copy.size());
+    });
+}
+
+void UdpEndpoint::send_to(const sockaddr_in& peer, const std::string& data) {
+    send_to(peer, data.data(), data.size());
+}
+
+void UdpEndpoint::send_in_loop(const sockaddr_in& peer, const void* data, size_t len) {
+    if (fd_ == -1) {
+        return;
+    }
+
+    if (!try_coalesce(peer, len)) {
+        Outgoing out;
+        out.offset = send_buffer_.size();
+        out.len = len;
+        out.peer = peer;
+        out.segments = 1;
+        out.sealed = gso_size_ == 0 || len != gso_size_;
+        send_queue_.push_back(out);
+    }
+    const char* bytes = static_cast<const char*>(data);
+    send_buffer_.insert(send_buffer_.end(), bytes, bytes + len);
+
+    schedule_flush();
+}
+
+bool UdpEndpoint::try_coalesce(const sockaddr_in& peer, size_t len) {
+    if (gso_size_ == 0 || len == 0 || len > gso_size_ || send_index_ == send_queue_.size()) {
+        return false;
+    }
+
+    // 只能追加到队尾消息：它的数据正好位于发送缓冲区末尾
+    Outgoing& last = send_queue_.back();
+    if (last.sealed || last.segments >= max_gso_segments || last.len + len > max_gso_bytes ||
+        last.peer.sin_addr.s_addr != peer.sin_addr.s_addr || last.peer.sin_port != peer.sin_port) {
+        return false;
+    }
+
+    last.len += len;
+    last.segments++;
+    last.sealed = len < gso_size_;
+    return true;
+}
+
+void UdpEndpoint::schedule_flush() {
+    // EPOLLOUT已注册时由可写事件负责发送；否则本批结束时统一发送一次
+    if (flush_scheduled_ || writing_) {
+        return;
+    }
+    flush_scheduled_ = true;
+    auto self = shared_from_this();
+    loop_.queue_in_loop([self]() {
+        self->flush_scheduled_ = false;
+        if (self->fd_ != -1) {
+            self->flush();
+        }
+    });
+}
+
+void UdpEndpoint::flush() {
+    while (send_index_ < send_queue_.size()) {
+        size_t count = std::min(send_queue_.size() - send_index_, max_send_batch);
+
+        send_iov_.resize(count);
+        send_msgs_.resize(count);
+        send_control_.assign(count * CMSG_SPACE(sizeof(uint16_t)), 0);
+
+        for (size_t i = 0; i < count; ++i) {
+            Outgoing& out = send_queue_[send_index_ + i];
+            send_iov_[i].iov_base = &send_buffer_[out.offset];
+            send_iov_[i].iov_len = out.len;
+
+            msghdr& hdr = send_msgs_[i].msg_hdr;
+            std::memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = &out.peer;
+            hdr.msg_namelen = sizeof(out.peer);
+            hdr.msg_iov = &send_iov_[i];
+            hdr.msg_iovlen = 1;
+
+            if (out.segments > 1) {
+                hdr.msg_control = &send_control_[i * CMSG_SPACE(sizeof(uint16_t))];
+                hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                std::memcpy(CMSG_DATA(cmsg), &gso_size_, sizeof(uint16_t));
+            }
+        }
+
+        int n = sendmmsg(fd_, send_msgs_.data(), static_cast<unsigned>(count), 0);
+        send_calls_++;
+
+        if (n > 0) {
+            for (int i = 0; i < n; ++i) {
+                datagrams_sent_ += send_queue_[send_index_ + static_cast<size_t>(i)].segments;
+            }
+            send_index_ += static_cast<size_t>(n);
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+            update_writing(true);
+            return;
+        }
+
+        // sendmmsg只对第一个消息报告错误（如EMSGSIZE、ECONNREFUSED），丢弃它后继续发送其余消息
+        send_errors_++;
+        send_index_++;
+    }
+
+    send_buffer_.clear();
+    send_queue_.clear();
+    send_index_ = 0;
+    update_writing(false);
+}
+
+void UdpEndpoint::update_writing(bool writing) {
+    if (writing == writing_) {
+        return;
+    }
+    writing_ = writing;
+    // 尚未注册时只记录，start时一并注册
+    if (registered_) {
+        loop_.modify_fd(fd_, EPOLLIN | (writing_ ? static_cast<uint32_t>(EPOLLOUT) : 0));
+    }
+}
+
+void UdpEndpoint::handle_event(int fd, uint32_t events) {
+    (void)fd;
+    // 回调中可能释放外部持有的引用，处理期间保持端点存活
+    Ptr guard = shared_from_this();
+
+    if (events & EPOLLIN) {
+        handle_read();
+    }
+    if ((events & EPOLLOUT) && fd_ != -1) {
+        flush();
+    }
+}
+
+void UdpEndpoint::handle_error(int fd, const std::string& error) {
+    (void)error;
+    Ptr guard = shared_from_this();
+
+    // UDP上的EPOLLERR来自ICMP错误（如端口不可达），读出SO_ERROR清除后继续收发
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err != 0) {
+        send_errors_++;
+    }
+    handle_read();
+}
+
+void UdpEndpoint::handle_read() {
+    for (int round = 0; round < max_batches_per_event && fd_ != -1; ++round) {
+        for (auto& msg : recv_msgs_) {
+            msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        }
+
+        int n = recvmmsg(fd_, recv_msgs_.data(), static_cast<unsigned>(batch_size_), MSG_DONTWAIT, nullptr);
+        recv_calls_++;
+
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "recvmmsg failed on fd " << fd_ << ": " << strerror(errno) << std::endl;
+            }
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const mmsghdr& msg = recv_msgs_[static_cast<size_t>(i)];
+            Datagram& dgram = datagrams_[static_cast<size_t>(i)];
+            dgram.data = static_cast<const char*>(msg.msg_hdr.msg_iov->iov_base);
+            dgram.len = msg.msg_len;
+            dgram.peer = recv_addrs_[static_cast<size_t>(i)];
+            dgram.truncated = (msg.msg_hdr.msg_flags & MSG_TRUNC) != 0;
+        }
+        datagrams_received_ += static_cast<uint64_t>(n);
+
+        if (batch_callback_) {
+            batch_callback_(shared_from_this(), datagrams_.data(), static_cast<size_t>(n));
+        }
+
+        // 不满一批说明socket已读空
+        if (static_cast<size_t>(n) < batch_size_) {
+            break;
+        }
+    }
+}
+
+} // namespace impl
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "epoll_event_loop.hpp"
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace impl {
+
+/**
+ * @brief 一次批量接收中的一个数据报
+ *
+ * data 指向端点内部预分配的接收缓冲区，仅在批量回调期间有效。
+ */
+struct Datagram {
+    const char* data;
+    size_t len;
+    sockaddr_in peer;
+    bool truncated;     ///< 数据报超过单个缓冲区大小，超出部分被内核丢弃
+};
+
+/**
+ * @brief 基于EpollEventLoop的批量UDP端点
+ *
+ * 特点：
+ * - 接收：可读时用 recvmmsg 一次读入一整批数据报到预分配的缓冲区，整批交给回调
+ * - 发送：send_to 只追加到发送队列，本批事件结束时用 sendmmsg 一次写出；内核缓冲区满时注册EPOLLOUT
+ * - 可选UDP GSO：发往同一对端、长度等于分段大小的连续数据报合并为一个消息，由内核（或网卡）切分
+ * - 所有状态只在所属循环线程上访问；send_to/close 可以从任意线程调用
+ */
+class UdpEndpoint : public EventHandler, public std::enable_shared_from_this<UdpEndpoint> {
+    struct private_tag {};
+
+public:
+    using Ptr = std::shared_ptr<UdpEndpoint>;
+
+    /**
+     * @brief 批量接收回调
+     * @param endpoint 端点
+     * @param datagrams 本批收到的数据报
+     * @param count 数据报数量
+     */
+    using BatchCallback = std::function<void(const Ptr& endpoint, const Datagram* datagrams, size_t count)>;
+
+    /**
+     * @brief 创建端点，端点接管fd的所有权
+     * @param loop 所属事件循环
+     * @param fd 非阻塞UDP socket
+     * @param batch_size 每次recvmmsg最多接收的数据报数
+     * @param max_datagram 单个接收缓冲区大小
+     */
+    static Ptr create(EpollEventLoop& loop, int fd, size_t batch_size = 64, size_t max_datagram = 2048);
+
+    /**
+     * @brief 创建并绑定非阻塞UDP socket
+     * @param ip 绑定地址
+     * @param port 绑定端口，0表示由内核分配
+     * @param reuse_port 是否设置SO_REUSEPORT
+     * @return socket文件描述符
+     */
+    static int bind_socket(const std::string& ip, int port, bool reuse_port = false);
+
+    /**
+     * @brief 构造点分十进制IPv4地址
+     */
+    static sockaddr_in make_address(const std::string& ip, int port);
+
+    UdpEndpoint(private_tag, EpollEventLoop& loop, int fd, size_t batch_size, size_t max_datagram);
+    ~UdpEndpoint() override;
+
+    /**
+     * @brief 注册到事件循环并开始接收（在循环线程上执行）
+     */
+    void start();
+
+    /**
+     * @brief 从事件循环中移除并关闭socket，丢弃未发送的数据报
+     */
+    void close();
+
+    /**
+     * @brief 发送一个数据报
+     *
+     * 在循环线程上调用时追加到发送队列，本批结束时统一发送；其他线程调用时复制数据后投递到循环线程。
+     */
+    void send_to(const sockaddr_in& peer, const void* data, size_t len);
+    void send_to(const sockaddr_in& peer, const std::string& data);
+
+    /**
+     * @brief 启用UDP GSO（UDP_SEGMENT）
+     *
+     * 启用后，发往同一对端的连续数据报中长度等于segment_size的会合并为一个消息发送，
+     * 最后一个可以更短；其他长度的数据报照常单独发送。
+     * @param segment_size 分段大小
+     * @return 内核不支持时返回false，发送路径保持不变
+     */
+    bool enable_gso(uint16_t segment_size);
+
+    void set_batch_callback(BatchCallback cb) { batch_callback_ = std::move(cb); }
+
+    int fd() const { return fd_; }
+    EpollEventLoop& loop() const { return loop_; }
+    size_t pending_datagrams() const { return send_queue_.size() - send_index_; }
+
+    /**
+     * @brief 统计：recvmmsg/sendmmsg调用次数与收发的数据报数
+     */
+    uint64_t recv_calls() const { return recv_calls_; }
+    uint64_t send_calls() const { return send_calls_; }
+    uint64_t datagrams_received() const { return datagrams_received_; }
+    uint64_t datagrams_sent() const { return datagrams_sent_; }
+    uint64_t send_errors() const { return send_errors_; }
+
+    void handle_event(int fd, uint32_t events) override;
+    void handle_error(int fd, const std::string& error) override;
+
+    UdpEndpoint(const UdpEndpoint&) = delete;
+    UdpEndpoint& operator=(const UdpEndpoint&) = delete;
+
+private:
+    /**
+     * @brief 发送队列中的一个消息，数据位于 send_buffer_ 中
+     */
+    struct Outgoing {
+        size_t offset;
+        size_t len;
+        sockaddr_in peer;
+        uint16_t segments;      // GSO合并的数据报数，1表示普通数据报
+        bool sealed;            // 最后一段短于分段大小，不能再合并
+    };
+
+    void send_in_loop(const sockaddr_in& peer, const void* data, size_t len);
+    bool try_coalesce(const sockaddr_in& peer, size_t len);
+    void schedule_flush();
+    void handle_read();
+    void flush();
+    void update_writing(bool writing);
+
+    static constexpr size_t max_send_batch = 1024;   // 单次sendmmsg的上限（UIO_MAXIOV）
+    static constexpr size_t max_gso_segments = 64;   // 内核单个GSO消息的分段上限
+    static constexpr size_t max_gso_bytes = 65000;   // 合并后的消息需小于UDP最大载荷
+    static constexpr int max_batches_per_event = 16; // 每次可读事件最多读取的批数，避免饿死其他fd
+
+    EpollEventLoop& loop_;
+    int fd_;
+    bool registered_;
+    bool writing_;                      // 是否已注册EPOLLOUT
+    bool flush_scheduled_;
+    uint16_t gso_size_;                 // 0表示未启用GSO
+
+    // 接收批次
+    size_t batch_size_;
+    size_t max_datagram_;
+    std::vector<char> recv_buffer_;
+    std::vector<iovec> recv_iov_;
+    std::vector<sockaddr_in> recv_addrs_;
+    std::vector<mmsghdr> recv_msgs_;
+    std::vector<Datagram> datagrams_;
+
+    // 发送队列
+    std::vector<char> send_buffer_;
+    std::vector<Outgoing> send_queue_;
+    size_t send_index_;                 // 第一个未发送的消息
+    std::vector<iovec> send_iov_;
+    std::vector<mmsghdr> send_msgs_;
+    std::vector<char> send_control_;
+
+    uint64_t recv_calls_;
+    uint64_t send_calls_;
+    uint64_t datagrams_received_;
+    uint64_t datagrams_sent_;
+    uint64_t send_errors_;
+
+    BatchCallback batch_callback_;
+};
+
+} // namespace impl
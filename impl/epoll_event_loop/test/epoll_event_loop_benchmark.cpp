@@ -0,0 +1,443 @@
+/**
+ * @file epoll_event_loop_benchmark.cpp
+ * @brief 事件循环回环echo吞吐量/延迟基准测试
+ *
+ * 服务端在一个EpollEventLoop线程上监听127.0.0.1，分别以水平触发、边缘触发的原始echo处理器
+ * 以及TcpConnection三种方式回显数据；客户端由独立线程用原生epoll驱动多条连接，
+ * 每条连接闭环地发送一条消息、收齐回显后再发下一条。对每种模式和每种消息大小输出
+ * 请求数/秒、MB/秒以及往返延迟分位数，作为事件循环改动前后的对比基准。
+ *
+ * 用法：epoll_event_loop_benchmark [连接数] [每项时长(毫秒)] [客户端线程数]
+ *   连接数默认为16，每项时长默认为1000毫秒，客户端线程数默认为2。
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "epoll_event_loop.hpp"
+#include "tcp_connection.hpp"
+
+using namespace impl;
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+enum class ServerMode {
+    LEVEL_TRIGGERED,
+    EDGE_TRIGGERED,
+    TCP_CONNECTION
+};
+
+const char* mode_name(ServerMode mode) {
+    switch (mode) {
+        case ServerMode::LEVEL_TRIGGERED: return "LT raw";
+        case ServerMode::EDGE_TRIGGERED: return "ET raw";
+        case ServerMode::TCP_CONNECTION: return "TcpConnection";
+    }
+    return "?";
+}
+
+/**
+ * @brief 单项测试结果
+ */
+struct bench_result {
+    double seconds = 0.0;       ///< 实际测量时长
+    size_t requests = 0;        ///< 完成的往返次数
+    double p50_us = 0.0;        ///< 往返延迟中位数（微秒）
+    double p99_us = 0.0;
+    double p999_us = 0.0;
+};
+
+struct bench_config {
+    size_t connections = 16;
+    size_t duration_ms = 1000;
+    size_t client_threads = 2;
+};
+
+/**
+ * @brief 原始echo处理器
+ *
+ * 水平触发时每次事件只读一次，剩余数据等下一次通知；边缘触发时一直读到EAGAIN，
+ * 并从一开始就同时关注EPOLLOUT，不需要来回修改关注事件。写不完的数据留在pending_中。
+ */
+class EchoSession : public EventHandler {
+public:
+    EchoSession(EpollEventLoop& loop, int fd, bool is_et)
+        : loop_(loop), fd_(fd), is_et_(is_et), buffer_(64 * 1024), want_write_(false) {}
+
+    ~EchoSession() override {
+        close(fd_);
+    }
+
+    void handle_event(int fd, uint32_t events) override {
+        if (events & (EPOLLERR | EPOLLHUP)) {
+            loop_.remove_fd(fd);
+            return;
+        }
+        if ((events & EPOLLOUT) && !flush()) {
+            loop_.remove_fd(fd);
+            return;
+        }
+        if (events & EPOLLIN) {
+            do {
+                ssize_t n = read(fd_, buffer_.data(), buffer_.size());
+                if (n > 0) {
+                    pending_.append(buffer_.data(), static_cast<size_t>(n));
+                    if (!flush()) {
+                        loop_.remove_fd(fd);
+                        return;
+                    }
+                    continue;
+                }
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    loop_.remove_fd(fd);
+                    return;
+                }
+                if (errno != EINTR) {
+                    break;
+                }
+            } while (is_et_);
+        }
+        if (!is_et_) {
+            // 水平触发：只在有数据积压时关注EPOLLOUT，否则会持续收到可写通知
+            bool want_write = !pending_.empty();
+            if (want_write != want_write_) {
+                want_write_ = want_write;
+                loop_.modify_fd(fd_, want_write ? (EPOLLIN | EPOLLOUT) : EPOLLIN);
+            }
+        }
+    }
+
+    void handle_error(int fd, const std::string&) override {
+        loop_.remove_fd(fd);
+    }
+
+private:
+    /**
+     * @brief 尽量写出积压数据，连接出错时返回false
+     */
+    bool flush() {
+        size_t written = 0;
+        while (written < pending_.size()) {
+            ssize_t n = write(fd_, pending_.data() + written, pending_.size() - written);
+            if (n > 0) {
+                written += static_cast<size_t>(n);
+            } else if (n == -1 && errno == EINTR) {
+                continue;
+            } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                return false;
+            }
+        }
+        pending_.erase(0, written);
+        return true;
+    }
+
+    EpollEventLoop& loop_;
+    int fd_;
+    bool is_et_;
+    std::vector<char> buffer_;
+    std::string pending_;
+    bool want_write_;
+};
+
+/**
+ * @brief 监听socket的接受处理器，为每个新连接创建对应模式的echo会话
+ */
+class EchoAcceptor : public EventHandler {
+public:
+    EchoAcceptor(EpollEventLoop& loop, ServerMode mode) : loop_(loop), mode_(mode) {}
+
+    void handle_event(int fd, uint32_t) override {
+        while (true) {
+            int client = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client == -1) {
+                return;
+            }
+            int one = 1;
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            if (mode_ == ServerMode::TCP_CONNECTION) {
+                auto conn = TcpConnection::create(loop_, client);
+                conn->set_message_callback([](const TcpConnection::Ptr& c, RingBuffer& input) {
+                    c->send(input);
+                });
+                conn->start();
+            } else {
+                bool is_et = mode_ == ServerMode::EDGE_TRIGGERED;
+                uint32_t events = is_et ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+                loop_.add_fd(client, events, std::make_shared<EchoSession>(loop_, client, is_et), is_et);
+            }
+        }
+    }
+
+    void handle_error(int, const std::string&) override {}
+
+private:
+    EpollEventLoop& loop_;
+    ServerMode mode_;
+};
+
+/**
+ * @brief 客户端连接的闭环状态
+ */
+struct ClientConn {
+    int fd = -1;
+    size_t sent = 0;
+    size_t received = 0;
+    bench_clock::time_point start;
+};
+
+int connect_loopback(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        std::perror("socket");
+        std::exit(1);
+    }
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        std::perror("connect");
+        std::exit(1);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    EpollEventLoop::set_nonblocking(fd);
+    return fd;
+}
+
+/**
+ * @brief 推进一条连接的收发，返回false表示连接出错
+ *
+ * 先写后读，读到完整回显时记录延迟并立即开始下一条消息。
+ */
+bool drive(ClientConn& c, const std::vector<char>& payload, std::vector<char>& sink,
+           std::vector<uint32_t>& latencies_ns, bool measuring) {
+    const size_t size = payload.size();
+    while (true) {
+        bool progressed = false;
+        while (c.sent < size) {
+            ssize_t n = write(c.fd, payload.data() + c.sent, size - c.sent);
+            if (n > 0) {
+                c.sent += static_cast<size_t>(n);
+                progressed = true;
+            } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else if (n == -1 && errno == EINTR) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+        while (c.received < size) {
+            ssize_t n = read(c.fd, sink.data(), std::min(sink.size(), size - c.received));
+            if (n > 0) {
+                c.received += static_cast<size_t>(n);
+                progressed = true;
+            } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else if (n == -1 && errno == EINTR) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+        if (c.received == size) {
+            auto now = bench_clock::now();
+            if (measuring) {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - c.start).count();
+                latencies_ns.push_back(static_cast<uint32_t>(std::min<int64_t>(ns, UINT32_MAX)));
+            }
+            c.sent = 0;
+            c.received = 0;
+            c.start = now;
+            continue;
+        }
+        if (!progressed) {
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief 一个客户端线程：用边缘触发的原生epoll驱动分配给它的连接
+ *
+ * 预热期的往返不计入结果；measure_start到deadline之间完成的往返记录延迟。
+ */
+void client_worker(int port, size_t connections, size_t message_size,
+                   bench_clock::time_point measure_start, bench_clock::time_point deadline,
+                   std::vector<uint32_t>& latencies_ns) {
+    std::vector<char> payload(message_size, 'x');
+    std::vector<char> sink(256 * 1024);
+    std::vector<ClientConn> conns(connections);
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    for (size_t i = 0; i < connections; ++i) {
+        conns[i].fd = connect_loopback(port);
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.u64 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, conns[i].fd, &ev);
+    }
+
+    auto now = bench_clock::now();
+    for (auto& c : conns) {
+        c.start = now;
+        if (!drive(c, payload, sink, latencies_ns, false)) {
+            std::fprintf(stderr, "client connection failed\n");
+            std::exit(1);
+        }
+    }
+
+    std::vector<epoll_event> events(connections);
+    while ((now = bench_clock::now()) < deadline) {
+        int n = epoll_wait(ep, events.data(), static_cast<int>(events.size()), 10);
+        bool measuring = now >= measure_start;
+        for (int i = 0; i < n; ++i) {
+            if (!drive(conns[events[i].data.u64], payload, sink, latencies_ns, measuring)) {
+                std::fprintf(stderr, "client connection failed\n");
+                std::exit(1);
+            }
+        }
+    }
+
+    for (auto& c : conns) {
+        close(c.fd);
+    }
+    close(ep);
+}
+
+double percentile_us(const std::vector<uint32_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return static_cast<double>(sorted[index]) / 1000.0;
+}
+
+bench_result run_one(ServerMode mode, size_t message_size, const bench_config& config) {
+    EpollEventLoop loop;
+    int listen_fd = EpollEventLoop::create_listen_socket(0, 1024, false);
+    int port = EpollEventLoop::get_local_port(listen_fd);
+    loop.add_fd(listen_fd, EPOLLIN, std::make_shared<EchoAcceptor>(loop, mode));
+
+    std::thread server([&loop]() { loop.run(); });
+
+    // 预热时长为测量时长的1/5，用于建立连接并让TCP窗口增长到稳定状态
+    auto warmup = std::chrono::milliseconds(config.duration_ms / 5);
+    auto measure = std::chrono::milliseconds(config.duration_ms);
+    auto measure_start = bench_clock::now() + warmup;
+    auto deadline = measure_start + measure;
+
+    size_t threads = std::min(config.client_threads, config.connections);
+    std::vector<std::vector<uint32_t>> latencies(threads);
+    std::vector<std::thread> clients;
+    for (size_t t = 0; t < threads; ++t) {
+        size_t share = config.connections / threads + (t < config.connections % threads ? 1 : 0);
+        clients.emplace_back(client_worker, port, share, message_size, measure_start, deadline,
+                             std::ref(latencies[t]));
+    }
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    loop.stop();
+    server.join();
+    loop.remove_fd(listen_fd);
+    close(listen_fd);
+
+    std::vector<uint32_t> all;
+    for (auto& l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    bench_result r;
+    r.seconds = std::chrono::duration<double>(measure).count();
+    r.requests = all.size();
+    r.p50_us = percentile_us(all, 0.50);
+    r.p99_us = percentile_us(all, 0.99);
+    r.p999_us = percentile_us(all, 0.999);
+    return r;
+}
+
+std::string format_size(size_t bytes) {
+    char buf[32];
+    if (bytes >= 1024 * 1024) {
+        std::snprintf(buf, sizeof(buf), "%zuMB", bytes / (1024 * 1024));
+    } else if (bytes >= 1024) {
+        std::snprintf(buf, sizeof(buf), "%zuKB", bytes / 1024);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%zuB", bytes);
+    }
+    return buf;
+}
+
+void print_header() {
+    std::printf("%-14s %8s %12s %10s %10s %10s %10s\n",
+                "mode", "size", "req/s", "MB/s", "p50(us)", "p99(us)", "p999(us)");
+    std::printf("%s\n", std::string(80, '-').c_str());
+}
+
+void print_row(ServerMode mode, size_t size, const bench_result& r) {
+    double rps = static_cast<double>(r.requests) / r.seconds;
+    // 每次往返在回环上传输两次消息，MB/s只按单向的请求字节计算
+    double mbps = rps * static_cast<double>(size) / (1024.0 * 1024.0);
+    std::printf("%-14s %8s %12.0f %10.1f %10.1f %10.1f %10.1f\n",
+                mode_name(mode), format_size(size).c_str(), rps, mbps, r.p50_us, r.p99_us, r.p999_us);
+    std::fflush(stdout);
+}
+
+size_t parse_arg(int argc, char** argv, int index, size_t fallback) {
+    if (argc <= index) {
+        return fallback;
+    }
+    long value = std::strtol(argv[index], nullptr, 10);
+    return value > 0 ? static_cast<size_t>(value) : fallback;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // 客户端在每项结束时直接关闭连接，服务端可能仍在回写
+    std::signal(SIGPIPE, SIG_IGN);
+
+    bench_config config;
+    config.connections = parse_arg(argc, argv, 1, 16);
+    config.duration_ms = parse_arg(argc, argv, 2, 1000);
+    config.client_threads = parse_arg(argc, argv, 3, 2);
+
+    const size_t sizes[] = {16, 256, 4 * 1024, 64 * 1024, 1024 * 1024};
+    const ServerMode modes[] = {ServerMode::LEVEL_TRIGGERED, ServerMode::EDGE_TRIGGERED,
+                                ServerMode::TCP_CONNECTION};
+
+    std::printf("epoll_event_loop benchmark: connections=%zu duration=%zums client_threads=%zu\n\n",
+                config.connections, config.duration_ms, config.client_threads);
+    print_header();
+
+    for (ServerMode mode : modes) {
+        for (size_t size : sizes) {
+            print_row(mode, size, run_one(mode, size, config));
+        }
+    }
+    return 0;
+}
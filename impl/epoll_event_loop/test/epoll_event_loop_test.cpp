@@ -11,6 +11,14 @@
 #include <unistd.h>
 #include <cstring>
 #include "epoll_event_loop.hpp"
+#include "event_loop_group.hpp"
+#include "tcp_connection.hpp"
+#include "io_uring_event_loop.hpp"
+#include "udp_endpoint.hpp"
+#include "connector.hpp"
+#include <map>
+#include <mutex>
+#include <future>
 
 using namespace impl;
 
@@ -161,6 +169,38 @@ TEST_F(EpollEventLoopTest, TimerCancellation) {
     loop_thread.join();
 }
 
+// 同一批到期的定时器中，前面的回调取消后面的定时器
+TEST_F(EpollEventLoopTest, CancelSiblingInSameBatch) {
+    std::atomic<int> first_count{0};
+    std::atomic<int> second_count{0};
+    std::atomic<uint64_t> second_id{0};
+    
+    std::thread loop_thread([this]() {
+        loop->run();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    
+    // 在循环线程上添加两个定时器后阻塞循环线程，使两者在同一次推进中到期
+    loop->queue_in_loop([&]() {
+        loop->add_timer(10, make_simple_timer([&]() {
+            first_count++;
+            loop->cancel_timer(second_id.load());
+        }));
+        second_id = loop->add_timer(20, make_simple_timer([&]() {
+            second_count++;
+        }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    
+    EXPECT_EQ(first_count, 1);
+    EXPECT_EQ(second_count, 0);
+    
+    loop->stop();
+    loop_thread.join();
+}
+
 // TCP服务器测试
 TEST_F(EpollEventLoopTest, TCPServer) {
     std::atomic<int> accept_count{0};
@@ -556,7 +596,1361 @@ TEST_F(EpollEventLoopTest, EdgeTriggered) {
     close(pipe_fds[1]);
 }
 
+// 定时器回调与IO处理器在同一个循环线程上执行
+TEST_F(EpollEventLoopTest, TimersRunOnLoopThread) {
+    std::thread::id loop_id;
+    std::thread::id timer_id;
+    std::thread::id handler_id;
+    std::atomic<int> done{0};
+    
+    int pipe_fds[2];
+    ASSERT_EQ(pipe(pipe_fds), 0);
+    
+    auto handler = make_simple_handler(
+        [&handler_id, &done](int fd) {
+            char buffer[16];
+            read(fd, buffer, sizeof(buffer));
+            handler_id = std::this_thread::get_id();
+            done++;
+        },
+        [](int, const std::string&) {}
+    );
+    loop->add_fd(pipe_fds[0], EPOLLIN, handler);
+    
+    std::thread loop_thread([this, &loop_id]() {
+        loop_id = std::this_thread::get_id();
+        loop->run();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    
+    loop->add_timer(std::chrono::microseconds(200), make_simple_timer([&timer_id, &done]() {
+        timer_id = std::this_thread::get_id();
+        done++;
+    }));
+    write(pipe_fds[1], "x", 1);
+    
+    for (int i = 0; i < 100 && done < 2; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    
+    loop->stop();
+    loop_thread.join();
+    
+    EXPECT_EQ(done, 2);
+    EXPECT_EQ(timer_id, loop_id);
+    EXPECT_EQ(handler_id, loop_id);
+    
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+}
+
+// fd复用测试：同一批事件中fd被关闭并复用时，旧事件不能分发给新的处理器
+TEST_F(EpollEventLoopTest, StaleEventAfterFdReuse) {
+    int pipe_a[2];
+    int pipe_b[2];
+    ASSERT_EQ(pipe(pipe_a), 0);
+    ASSERT_EQ(pipe(pipe_b), 0);
+    
+    std::atomic<int> first_calls{0};
+    std::atomic<int> reused_calls{0};
+    int reused_pipe[2] = {-1, -1};
+    
+    auto reused_handler = make_simple_handler(
+        [&reused_calls](int) { reused_calls++; },
+        [](int, const std::string&) {}
+    );
+    
+    // 先执行的处理器移除并关闭另一个fd，然后创建新管道复用该fd编号
+    auto make_handler = [&](int* other) {
+        return make_simple_handler(
+            [&, other](int fd) {
+                char buffer[16];
+                read(fd, buffer, sizeof(buffer));
+                if (first_calls++ != 0) {
+                    return;
+                }
+                loop->remove_fd(other[0]);
+                close(other[0]);
+                ASSERT_EQ(pipe(reused_pipe), 0);
+                loop->add_fd(reused_pipe[0], EPOLLIN, reused_handler);
+            },
+            [](int, const std::string&) {}
+        );
+    };
+    
+    loop->add_fd(pipe_a[0], EPOLLIN, make_handler(pipe_b));
+    loop->add_fd(pipe_b[0], EPOLLIN, make_handler(pipe_a));
+    
+    // 启动前两个管道都已可读，保证在同一批事件中返回
+    write(pipe_a[1], "a", 1);
+    write(pipe_b[1], "b", 1);
+    
+    std::thread loop_thread([this]() {
+        loop->run();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    
+    loop->stop();
+    loop_thread.join();
+    
+    EXPECT_EQ(first_calls, 1);
+    EXPECT_EQ(reused_calls, 0);
+    
+    close(pipe_a[1]);
+    close(pipe_b[1]);
+    for (int fd : {pipe_a[0], pipe_b[0]}) {
+        if (fd != reused_pipe[0]) {
+            close(fd);
+        }
+    }
+    close(reused_pipe[0]);
+    close(reused_pipe[1]);
+}
+
+// fd复用测试：其他线程在循环分发期间反复移除并复用同一fd编号
+TEST_F(EpollEventLoopTest, StaleEventAfterCrossThreadFdReuse) {
+    std::atomic<int> stale_calls{0};
+    
+    // 旧fd是写入过且从不读取的eventfd（水平触发下每轮都可读），新fd从不写入，
+    // 新处理器收到的任何可读事件都只能是旧fd残留的事件
+    auto busy_handler = make_simple_handler([](int) {}, [](int, const std::string&) {});
+    auto idle_handler = make_simple_handler(
+        [&stale_calls](int) { stale_calls++; },
+        [](int, const std::string&) {}
+    );
+    
+    std::thread loop_thread([this]() {
+        loop->run();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    
+    int reused = 0;
+    for (int i = 0; i < 2000; ++i) {
+        int busy = eventfd(1, EFD_NONBLOCK);
+        ASSERT_NE(busy, -1);
+        loop->add_fd(busy, EPOLLIN, busy_handler);
+        std::this_thread::yield();
+        loop->remove_fd(busy);
+        close(busy);
+        
+        int idle = eventfd(0, EFD_NONBLOCK);
+        ASSERT_NE(idle, -1);
+        reused += idle == busy;
+        loop->add_fd(idle, EPOLLIN, idle_handler);
+        std::this_thread::yield();
+        loop->remove_fd(idle);
+        close(idle);
+    }
+    
+    loop->stop();
+    loop_thread.join();
+    
+    EXPECT_GT(reused, 0);
+    EXPECT_EQ(stale_calls, 0);
+}
+
+// 多Reactor测试：连接被分配到组内的各个循环，并可正常收发数据
+namespace {
+
+int connect_local(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void run_group_echo_test(EventLoopGroup::AcceptMode mode, size_t connections,
+                         std::map<EpollEventLoop*, int>& per_loop) {
+    EventLoopGroup group(2);
+    std::mutex mutex;
+    
+    int port = group.listen(0, [&](EpollEventLoop& loop, int fd) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            per_loop[&loop]++;
+        }
+        loop.add_fd(fd, EPOLLIN, make_simple_handler(
+            [&loop](int conn_fd) {
+                char buffer[256];
+                ssize_t n = read(conn_fd, buffer, sizeof(buffer));
+                if (n > 0) {
+                    write(conn_fd, buffer, n);
+                } else {
+                    loop.remove_fd(conn_fd);
+                    close(conn_fd);
+                }
+            },
+            [&loop](int conn_fd, const std::string&) {
+                loop.remove_fd(conn_fd);
+                close(conn_fd);
+            }));
+    }, mode, 1024);
+    ASSERT_GT(port, 0);
+    group.start();
+    
+    std::vector<int> clients;
+    for (size_t i = 0; i < connections; ++i) {
+        int fd = connect_local(port);
+        ASSERT_NE(fd, -1);
+        clients.push_back(fd);
+    }
+    for (size_t i = 0; i < clients.size(); ++i) {
+        std::string message = "ping " + std::to_string(i);
+        ASSERT_EQ(write(clients[i], message.data(), message.size()), static_cast<ssize_t>(message.size()));
+        char buffer[256];
+        ssize_t n = read(clients[i], buffer, sizeof(buffer));
+        ASSERT_GT(n, 0);
+        EXPECT_EQ(std::string(buffer, n), message);
+    }
+    for (int fd : clients) {
+        close(fd);
+    }
+    
+    EXPECT_NE(group.get_stats().find("Accepted Connections: " + std::to_string(connections)), std::string::npos);
+    group.stop();
+    EXPECT_FALSE(group.is_running());
+}
+
+} // namespace
+
+TEST(EventLoopGroupTest, ReusePortListeners) {
+    std::map<EpollEventLoop*, int> per_loop;
+    run_group_echo_test(EventLoopGroup::AcceptMode::REUSE_PORT, 16, per_loop);
+    
+    int total = 0;
+    for (auto& item : per_loop) {
+        total += item.second;
+    }
+    EXPECT_EQ(total, 16);
+}
+
+TEST(EventLoopGroupTest, AcceptorRoundRobin) {
+    std::map<EpollEventLoop*, int> per_loop;
+    run_group_echo_test(EventLoopGroup::AcceptMode::ACCEPTOR, 8, per_loop);
+    
+    // 轮询分发：两个循环各分到一半连接
+    ASSERT_EQ(per_loop.size(), 2u);
+    for (auto& item : per_loop) {
+        EXPECT_EQ(item.second, 4);
+    }
+}
+
+// 跨线程投递测试：多个线程投递的任务都在循环线程上按投递者顺序执行
+TEST_F(EpollEventLoopTest, QueueInLoopFromManyThreads) {
+    const int producers = 4;
+    const int per_producer = 5000;
+    
+    std::thread::id loop_id;
+    std::thread loop_thread([this, &loop_id]() {
+        loop_id = std::this_thread::get_id();
+        loop->run();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(loop->is_in_loop_thread());
+    
+    // 只在循环线程上访问，不需要原子变量
+    int executed = 0;
+    std::vector<int> last_seen(producers, -1);
+    bool in_order = true;
+    bool on_loop_thread = true;
+    std::atomic<bool> done{false};
+    
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < per_producer; ++i) {
+                loop->queue_in_loop([&, p, i]() {
+                    on_loop_thread = on_loop_thread && loop->is_in_loop_thread();
+                    in_order = in_order && last_seen[p] == i - 1;
+                    last_seen[p] = i;
+                    if (++executed == producers * per_producer) {
+                        done = true;
+                    }
+                });
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    for (int i = 0; i < 200 && !done; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    
+    // run_in_loop 在循环线程上同步执行
+    std::atomic<bool> nested_ran{false};
+    loop->run_in_loop([&]() {
+        loop->run_in_loop([&]() { nested_ran = true; });
+        EXPECT_TRUE(nested_ran);
+    });
+    for (int i = 0; i < 100 && !nested_ran; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    
+    loop->stop();
+    loop_thread.join();
+    
+    EXPECT_TRUE(done);
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(on_loop_thread);
+    EXPECT_TRUE(nested_ran);
+}
+
+namespace {
+
+uint64_t wakeup_count(const EpollEventLoop& loop) {
+    std::string stats = loop.get_stats();
+    auto pos = stats.find("Wakeups: ");
+    return pos == std::string::npos ? 0 : std::stoull(stats.substr(pos + 9));
+}
+
+} // namespace
+
+// 唤醒合并测试：循环线程忙于执行任务时，同一批投递只写一次eventfd
+TEST(EpollEventLoopWakeupTest, BurstWhileLoopBusyCostsOneWakeup) {
+    // epoll_wait超时设为10秒：循环能及时响应只可能是eventfd唤醒的结果
+    EpollEventLoop loop(1024, 10000);
+    std::thread loop_thread([&loop]() {
+        loop.run();
+    });
+    while (!loop.is_running()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    
+    std::atomic<bool> blocked{false};
+    std::atomic<bool> release{false};
+    loop.queue_in_loop([&]() {
+        blocked = true;
+        while (!release) {
+            std::this_thread::yield();
+        }
+    });
+    while (!blocked) {
+        std::this_thread::yield();
+    }
+    
+    // 循环线程阻塞在上一个任务中，这一批投递只有第一次需要写eventfd
+    const int burst = 1000;
+    std::atomic<int> executed{0};
+    uint64_t before = wakeup_count(loop);
+    for (int i = 0; i < burst; ++i) {
+        loop.queue_in_loop([&executed]() { executed++; });
+    }
+    EXPECT_EQ(wakeup_count(loop) - before, 1u);
+    
+    release = true;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (executed < burst && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(executed, burst);
+    EXPECT_EQ(wakeup_count(loop) - before, 1u);
+    
+    // stop() 同样通过eventfd唤醒，远早于10秒的epoll_wait超时返回
+    auto stop_start = std::chrono::steady_clock::now();
+    loop.stop();
+    loop_thread.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - stop_start, std::chrono::seconds(5));
+}
+
+// 时间轮测试：使用虚拟时间点驱动，结果与真实时钟无关
+TEST(TimingWheelTest, ExpiresInOrderAcrossLevels) {
+    TimingWheel wheel(std::chrono::microseconds(1));
+    auto base = std::chrono::steady_clock::now();
+    
+    std::vector<std::chrono::microseconds> delays = {
+        std::chrono::microseconds(3),
+        std::chrono::microseconds(70),          // 第1层
+        std::chrono::microseconds(5000),        // 第2层
+        std::chrono::milliseconds(300),         // 第3层
+        std::chrono::seconds(30),               // 第4层
+        std::chrono::hours(48)                  // 超出时间轮范围，进入溢出堆
+    };
+    std::vector<uint64_t> ids;
+    for (auto delay : delays) {
+        ids.push_back(wheel.add(base + delay, make_simple_timer([] {})));
+    }
+    EXPECT_EQ(wheel.size(), delays.size());
+    
+    std::vector<TimingWheel::Expired> expired;
+    for (size_t i = 0; i < delays.size(); ++i) {
+        // 到期前一微秒不应触发
+        wheel.advance(base + delays[i] - std::chrono::microseconds(1), expired);
+        EXPECT_TRUE(expired.empty()) << "timer " << i << " fired early";
+        
+        wheel.advance(base + delays[i] + std::chrono::microseconds(1), expired);
+        ASSERT_EQ(expired.size(), 1u) << "timer " << i;
+        EXPECT_EQ(expired[0].id, ids[i]);
+        expired.clear();
+    }
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(wheel.next_expiry(), std::chrono::steady_clock::time_point::max());
+}
+
+TEST(TimingWheelTest, CancelAndReschedule) {
+    TimingWheel wheel;
+    auto base = std::chrono::steady_clock::now();
+    
+    uint64_t a = wheel.add(base + std::chrono::milliseconds(10), make_simple_timer([] {}));
+    uint64_t b = wheel.add(base + std::chrono::milliseconds(20), make_simple_timer([] {}));
+    uint64_t c = wheel.add(base + std::chrono::hours(100), make_simple_timer([] {}));
+    
+    EXPECT_TRUE(wheel.cancel(a));
+    EXPECT_FALSE(wheel.cancel(a));
+    EXPECT_TRUE(wheel.cancel(c));
+    EXPECT_TRUE(wheel.reschedule(b, base + std::chrono::milliseconds(50)));
+    EXPECT_EQ(wheel.size(), 1u);
+    
+    std::vector<TimingWheel::Expired> expired;
+    wheel.advance(base + std::chrono::milliseconds(30), expired);
+    EXPECT_TRUE(expired.empty());
+    
+    // 到期时间向上取整到tick，推进到到期时间之后一个tick
+    wheel.advance(base + std::chrono::milliseconds(50) + std::chrono::microseconds(1), expired);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0].id, b);
+    
+    // 节点复用后旧ID失效
+    uint64_t d = wheel.add(base + std::chrono::milliseconds(60), make_simple_timer([] {}));
+    EXPECT_NE(d, a);
+    EXPECT_FALSE(wheel.cancel(a));
+    EXPECT_TRUE(wheel.cancel(d));
+}
+
+// 已到期但尚未执行回调的定时器仍可取消，release_fired() 后失效
+TEST(TimingWheelTest, CancelFiredBeforeRelease) {
+    TimingWheel wheel;
+    auto base = std::chrono::steady_clock::now();
+    
+    uint64_t a = wheel.add(base + std::chrono::milliseconds(10), make_simple_timer([] {}));
+    uint64_t b = wheel.add(base + std::chrono::milliseconds(10), make_simple_timer([] {}));
+    
+    std::vector<TimingWheel::Expired> expired;
+    wheel.advance(base + std::chrono::milliseconds(20), expired);
+    ASSERT_EQ(expired.size(), 2u);
+    EXPECT_EQ(wheel.size(), 0u);
+    
+    EXPECT_TRUE(wheel.alive(a));
+    EXPECT_FALSE(wheel.reschedule(b, base + std::chrono::milliseconds(50)));
+    EXPECT_TRUE(wheel.cancel(b));
+    EXPECT_FALSE(wheel.alive(b));
+    EXPECT_FALSE(wheel.cancel(b));
+    EXPECT_EQ(wheel.size(), 0u);
+    
+    wheel.release_fired();
+    EXPECT_FALSE(wheel.alive(a));
+    EXPECT_FALSE(wheel.cancel(a));
+}
+
+TEST(TimingWheelTest, PeriodicTimer) {
+    TimingWheel wheel;
+    auto base = std::chrono::steady_clock::now();
+    
+    uint64_t id = wheel.add(base + std::chrono::milliseconds(1), make_simple_timer([] {}),
+                            std::chrono::milliseconds(1));
+    
+    std::vector<TimingWheel::Expired> expired;
+    for (int i = 1; i <= 10; ++i) {
+        wheel.advance(base + std::chrono::milliseconds(i) + std::chrono::microseconds(1), expired);
+    }
+    EXPECT_EQ(expired.size(), 10u);
+    EXPECT_EQ(wheel.size(), 1u);
+    
+    EXPECT_TRUE(wheel.cancel(id));
+    expired.clear();
+    wheel.advance(base + std::chrono::milliseconds(20), expired);
+    EXPECT_TRUE(expired.empty());
+}
+
+TEST(TimingWheelTest, ManyTimers) {
+    TimingWheel wheel;
+    auto base = std::chrono::steady_clock::now();
+    const int count = 200000;
+    
+    std::vector<uint64_t> ids;
+    ids.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        ids.push_back(wheel.add(base + std::chrono::milliseconds(1000 + i % 5000), make_simple_timer([] {})));
+    }
+    // 模拟连接活跃：推迟一半的空闲超时
+    for (int i = 0; i < count; i += 2) {
+        EXPECT_TRUE(wheel.reschedule(ids[i], base + std::chrono::seconds(60)));
+    }
+    
+    std::vector<TimingWheel::Expired> expired;
+    wheel.advance(base + std::chrono::seconds(10), expired);
+    EXPECT_EQ(expired.size(), static_cast<size_t>(count / 2));
+    EXPECT_EQ(wheel.size(), static_cast<size_t>(count / 2));
+}
+
+// 周期定时器与重新调度测试
+TEST_F(EpollEventLoopTest, PeriodicAndRescheduledTimers) {
+    std::atomic<int> ticks{0};
+    std::atomic<int> idle_fired{0};
+    
+    std::thread loop_thread([this]() {
+        loop->run();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    
+    uint64_t periodic_id = loop->add_timer(std::chrono::microseconds(500),
+                                           make_simple_timer([&ticks]() { ticks++; }),
+                                           std::chrono::microseconds(500));
+    uint64_t idle_id = loop->add_timer(std::chrono::milliseconds(50),
+                                       make_simple_timer([&idle_fired]() { idle_fired++; }));
+    
+    // 持续推迟空闲定时器，期间不应触发
+    for (int i = 0; i < 5; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_TRUE(loop->reschedule_timer(idle_id, std::chrono::milliseconds(50)));
+    }
+    EXPECT_EQ(idle_fired, 0);
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_EQ(idle_fired, 1);
+    EXPECT_FALSE(loop->reschedule_timer(idle_id, std::chrono::milliseconds(50)));
+    
+    loop->cancel_timer(periodic_id);
+    int after_cancel = ticks;
+    EXPECT_GT(after_cancel, 10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_LE(ticks, after_cancel + 1);
+    
+    loop->stop();
+    loop_thread.join();
+}
+
+// 环形缓冲区测试：回绕、扩容与两段iovec
+TEST(RingBufferTest, WrapAroundAndGrowth) {
+    RingBuffer buffer(16);
+    EXPECT_EQ(buffer.capacity(), 16u);
+    
+    buffer.append(std::string("0123456789"));
+    EXPECT_EQ(buffer.retrieve_as_string(8), "01234567");
+    
+    // 写位置在10，追加12字节回绕到缓冲区开头
+    buffer.append(std::string("abcdefghijkl"));
+    EXPECT_EQ(buffer.capacity(), 16u);
+    EXPECT_EQ(buffer.readable_bytes(), 14u);
+    
+    struct iovec vec[2] = {};
+    ASSERT_EQ(buffer.readable_segments(vec), 2);
+    EXPECT_EQ(vec[0].iov_len + vec[1].iov_len, 14u);
+    EXPECT_EQ(std::string(buffer.linearize(), buffer.readable_bytes()), "89abcdefghijkl");
+    
+    // 空间不足时扩容，数据保持连续且顺序不变
+    std::string large(40, 'x');
+    buffer.append(large);
+    EXPECT_EQ(buffer.capacity(), 64u);
+    EXPECT_EQ(buffer.readable_segments(vec), 1);
+    EXPECT_EQ(buffer.retrieve_all_as_string(), "89abcdefghijkl" + large);
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST(RingBufferTest, ReadFdSpillsLargeReads) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int size = 1 << 20;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    
+    std::string payload(50000, '\0');
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>('a' + i % 26);
+    }
+    ASSERT_EQ(write(fds[0], payload.data(), payload.size()), static_cast<ssize_t>(payload.size()));
+    
+    // 空闲空间只有16字节，其余数据经栈上溢出区一次读入
+    RingBuffer buffer(16);
+    int saved_errno = 0;
+    EXPECT_EQ(buffer.read_fd(fds[1], &saved_errno), static_cast<ssize_t>(payload.size()));
+    EXPECT_EQ(buffer.readable_bytes(), payload.size());
+    EXPECT_GE(buffer.capacity(), payload.size());
+    EXPECT_EQ(buffer.retrieve_all_as_string(), payload);
+    
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// TcpConnection测试：连接一端交给事件循环，另一端在测试线程上阻塞读写
+class TcpConnectionTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        loop_thread = std::thread([this]() {
+            loop.run();
+        });
+        while (!loop.is_running()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    
+    void TearDown() override {
+        loop.stop();
+        loop_thread.join();
+        close(fds[1]);
+    }
+    
+    /**
+     * @brief 在循环线程上执行并等待结果
+     */
+    template <typename F>
+    auto in_loop(F f) -> decltype(f()) {
+        std::promise<decltype(f())> result;
+        loop.queue_in_loop([&]() {
+            result.set_value(f());
+        });
+        return result.get_future().get();
+    }
+    
+    std::string read_exactly(size_t len) {
+        std::string data(len, '\0');
+        size_t got = 0;
+        while (got < len) {
+            ssize_t n = read(fds[1], &data[got], len - got);
+            if (n <= 0) {
+                break;
+            }
+            got += static_cast<size_t>(n);
+        }
+        data.resize(got);
+        return data;
+    }
+    
+    EpollEventLoop loop;
+    std::thread loop_thread;
+    int fds[2];
+};
+
+TEST_F(TcpConnectionTest, SendsInOneBatchCoalesce) {
+    auto conn = TcpConnection::create(loop, fds[0]);
+    
+    // 收到请求后分100次回复，本批结束时合并为一次写出
+    conn->set_message_callback([](const TcpConnection::Ptr& c, RingBuffer& input) {
+        std::string request = input.retrieve_all_as_string();
+        for (int i = 0; i < 100; ++i) {
+            c->send(request);
+        }
+    });
+    conn->start();
+    
+    ASSERT_EQ(write(fds[1], "ping", 4), 4);
+    std::string expected;
+    for (int i = 0; i < 100; ++i) {
+        expected += "ping";
+    }
+    EXPECT_EQ(read_exactly(expected.size()), expected);
+    EXPECT_EQ(in_loop([&]() { return conn->write_calls(); }), 1u);
+    
+    // 对端关闭后连接自动关闭并从循环中移除
+    std::promise<void> closed;
+    in_loop([&]() {
+        conn->set_close_callback([&closed](const TcpConnection::Ptr&) { closed.set_value(); });
+        return 0;
+    });
+    shutdown(fds[1], SHUT_WR);
+    closed.get_future().get();
+    EXPECT_FALSE(in_loop([&]() { return conn->connected(); }));
+}
+
+TEST_F(TcpConnectionTest, SendBeforeStartIsFlushedAfterRegistration) {
+    auto conn = TcpConnection::create(loop, fds[0]);
+    conn->send(std::string("hello"));
+    conn->start();
+    conn->send(std::string(" world"));
+    
+    EXPECT_EQ(read_exactly(11), "hello world");
+    conn->force_close();
+}
+
+TEST_F(TcpConnectionTest, PartialWritesAndWaterMarks) {
+    int sndbuf = 64 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    
+    const size_t total = 4 * 1024 * 1024;
+    const size_t high_mark = 1024 * 1024;
+    const size_t low_mark = 256 * 1024;
+    
+    // 水位回调都在循环线程上执行
+    std::vector<size_t> high_calls;
+    std::vector<size_t> low_calls;
+    std::promise<void> completed;
+    
+    auto conn = TcpConnection::create(loop, fds[0]);
+    conn->set_high_water_mark_callback([&](const TcpConnection::Ptr&, size_t pending) {
+        high_calls.push_back(pending);
+    }, high_mark);
+    conn->set_low_water_mark_callback([&](const TcpConnection::Ptr&, size_t pending) {
+        low_calls.push_back(pending);
+    }, low_mark);
+    conn->set_write_complete_callback([&](const TcpConnection::Ptr& c) {
+        if (c->pending_output_bytes() == 0 && !high_calls.empty()) {
+            completed.set_value();
+        }
+    });
+    conn->start();
+    
+    // 对端不读：一次写不完，剩余数据留在输出缓冲区并注册EPOLLOUT
+    std::string payload(total, 'p');
+    bool writing = in_loop([&]() {
+        conn->send(payload);
+        return conn->writing();
+    });
+    EXPECT_FALSE(writing); // 写出延迟到本批结束
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(in_loop([&]() { return conn->writing(); }));
+    size_t pending = in_loop([&]() { return conn->pending_output_bytes(); });
+    EXPECT_GT(pending, low_mark);
+    EXPECT_LT(pending, total);
+    EXPECT_EQ(in_loop([&]() { return high_calls.size(); }), 1u);
+    EXPECT_TRUE(in_loop([&]() { return low_calls.empty(); }));
+    
+    // 对端开始读取：降到低水位时回调一次，写完后注销EPOLLOUT
+    std::string received = read_exactly(total);
+    EXPECT_EQ(received.size(), total);
+    completed.get_future().get();
+    
+    EXPECT_FALSE(in_loop([&]() { return conn->writing(); }));
+    EXPECT_EQ(in_loop([&]() { return high_calls[0]; }), total);
+    ASSERT_EQ(in_loop([&]() { return low_calls.size(); }), 1u);
+    EXPECT_LE(in_loop([&]() { return low_calls[0]; }), low_mark);
+    EXPECT_GT(in_loop([&]() { return conn->write_calls(); }), 1u);
+    conn->force_close();
+}
+
+TEST_F(TcpConnectionTest, SendFileKeepsOrderWithBufferedOutput) {
+    // 临时文件：内容为可校验的字节序列
+    char path[] = "/tmp/tcp_connection_send_file_XXXXXX";
+    int file_fd = mkstemp(path);
+    ASSERT_NE(file_fd, -1);
+    unlink(path);
+    std::string content(3 * 1024 * 1024, '\0');
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>('a' + i % 26);
+    }
+    ASSERT_EQ(write(file_fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+    
+    const off_t offset = 100;
+    const size_t len = 2 * 1024 * 1024;
+    std::promise<bool> done;
+    
+    auto conn = TcpConnection::create(loop, fds[0]);
+    conn->start();
+    in_loop([&]() {
+        conn->send(std::string("HEAD"));
+        conn->send_file(file_fd, offset, len, [&done](const TcpConnection::Ptr&, bool success) {
+            done.set_value(success);
+        });
+        conn->send(std::string("TAIL"));
+        return 0;
+    });
+    
+    // 对端读到的顺序与调用顺序一致，文件部分超出socket缓冲区，需要在EPOLLOUT上继续
+    std::string received = read_exactly(4 + len + 4);
+    ASSERT_EQ(received.size(), 4 + len + 4);
+    EXPECT_EQ(received.substr(0, 4), "HEAD");
+    EXPECT_TRUE(received.compare(4, len, content, static_cast<size_t>(offset), len) == 0);
+    EXPECT_EQ(received.substr(4 + len), "TAIL");
+    EXPECT_TRUE(done.get_future().get());
+    
+    EXPECT_GT(in_loop([&]() { return conn->sendfile_calls(); }), 1u);
+    EXPECT_EQ(in_loop([&]() { return conn->pending_file_bytes(); }), 0u);
+    EXPECT_FALSE(in_loop([&]() { return conn->writing(); }));
+    
+    // 文件读取位置不受影响
+    EXPECT_EQ(lseek(file_fd, 0, SEEK_CUR), static_cast<off_t>(content.size()));
+    conn->force_close();
+    close(file_fd);
+}
+
+TEST_F(TcpConnectionTest, SendFileShortFileClosesConnection) {
+    char path[] = "/tmp/tcp_connection_send_file_XXXXXX";
+    int file_fd = mkstemp(path);
+    ASSERT_NE(file_fd, -1);
+    unlink(path);
+    ASSERT_EQ(write(file_fd, "0123456789", 10), 10);
+    
+    std::promise<bool> done;
+    std::promise<void> closed;
+    auto conn = TcpConnection::create(loop, fds[0]);
+    conn->set_close_callback([&closed](const TcpConnection::Ptr&) {
+        closed.set_value();
+    });
+    conn->start();
+    
+    // 请求的长度超过文件大小：已发出的部分送达，随后连接关闭并回调失败
+    conn->send_file(file_fd, 0, 100, [&done](const TcpConnection::Ptr&, bool success) {
+        done.set_value(success);
+    });
+    EXPECT_FALSE(done.get_future().get());
+    closed.get_future().get();
+    
+    EXPECT_EQ(read_exactly(100), "0123456789");
+    close(file_fd);
+}
+
+TEST_F(TcpConnectionTest, SendFilePeerResetDoesNotRaiseSigpipe) {
+    int sndbuf = 64 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    
+    char path[] = "/tmp/tcp_connection_send_file_XXXXXX";
+    int file_fd = mkstemp(path);
+    ASSERT_NE(file_fd, -1);
+    unlink(path);
+    std::string content(4 * 1024 * 1024, 'f');
+    ASSERT_EQ(write(file_fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+    
+    std::promise<bool> done;
+    std::promise<void> closed;
+    auto conn = TcpConnection::create(loop, fds[0]);
+    conn->set_close_callback([&closed](const TcpConnection::Ptr&) {
+        closed.set_value();
+    });
+    conn->start();
+    conn->send_file(file_fd, 0, content.size(), [&done](const TcpConnection::Ptr&, bool success) {
+        done.set_value(success);
+    });
+    
+    // 对端读到一部分后关闭，文件剩余部分还在等待EPOLLOUT
+    EXPECT_EQ(read_exactly(4096).size(), 4096u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_GT(in_loop([&]() { return conn->pending_file_bytes(); }), 0u);
+    
+    // 直接投递可写事件，确保sendfile在对端关闭之后执行而不是先收到挂断事件
+    in_loop([&]() {
+        shutdown(fds[1], SHUT_RDWR);
+        conn->handle_event(fds[0], EPOLLOUT);
+        return 0;
+    });
+    
+    // 进程没有被SIGPIPE终止，连接关闭并回调失败
+    EXPECT_FALSE(done.get_future().get());
+    closed.get_future().get();
+    EXPECT_FALSE(in_loop([&]() { return conn->connected(); }));
+    close(file_fd);
+}
+
+// IoUringEventLoop测试：同一组用例分别在io_uring和epoll后端上运行
+class IoUringEventLoopTest : public ::testing::TestWithParam<IoUringEventLoop::Backend> {
+protected:
+    void SetUp() override {
+        if (GetParam() == IoUringEventLoop::Backend::IO_URING && !IoUringEventLoop::is_supported()) {
+            GTEST_SKIP() << "io_uring not supported";
+        }
+        loop = std::make_unique<IoUringEventLoop>(1024, 100, GetParam());
+    }
+    
+    void start() {
+        loop_thread = std::thread([this]() {
+            loop->run();
+        });
+        while (!loop->is_running()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    
+    void TearDown() override {
+        if (loop_thread.joinable()) {
+            loop->stop();
+            loop_thread.join();
+        }
+        loop.reset();
+    }
+    
+    std::unique_ptr<IoUringEventLoop> loop;
+    std::thread loop_thread;
+};
+
+TEST_P(IoUringEventLoopTest, LevelTriggeredPollRearms) {
+    int pipe_fds[2];
+    ASSERT_EQ(pipe(pipe_fds), 0);
+    
+    // 每次事件只读一个字节，水平触发下剩余数据必须继续产生事件
+    std::atomic<int> events{0};
+    loop->add_fd(pipe_fds[0], EPOLLIN, make_simple_handler(
+        [&events](int fd) {
+            char c;
+            if (read(fd, &c, 1) == 1) {
+                events++;
+            }
+        },
+        [](int, const std::string&) {}
+    ));
+    start();
+    
+    ASSERT_EQ(write(pipe_fds[1], "abc", 3), 3);
+    for (int i = 0; i < 200 && events < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(events, 3);
+    
+    // 移除之后不再分发，同一fd可以重新注册
+    loop->remove_fd(pipe_fds[0]);
+    ASSERT_EQ(write(pipe_fds[1], "d", 1), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(events, 3);
+    
+    std::promise<void> readded;
+    loop->add_fd(pipe_fds[0], EPOLLIN, make_simple_handler(
+        [&readded](int fd) {
+            char c;
+            if (read(fd, &c, 1) == 1) {
+                readded.set_value();
+            }
+        },
+        [](int, const std::string&) {}
+    ));
+    EXPECT_EQ(readded.get_future().wait_for(std::chrono::seconds(2)), std::future_status::ready);
+    
+    loop->remove_fd(pipe_fds[0]);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+}
+
+TEST_P(IoUringEventLoopTest, TimersAndQueuedFunctorsRunOnLoopThread) {
+    start();
+    
+    std::promise<std::thread::id> timer_thread;
+    loop->add_timer(std::chrono::milliseconds(20), make_simple_timer([&timer_thread]() {
+        timer_thread.set_value(std::this_thread::get_id());
+    }));
+    
+    std::promise<std::thread::id> functor_thread;
+    loop->queue_in_loop([&functor_thread]() {
+        functor_thread.set_value(std::this_thread::get_id());
+    });
+    
+    auto functor_future = functor_thread.get_future();
+    auto timer_future = timer_thread.get_future();
+    ASSERT_EQ(functor_future.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+    ASSERT_EQ(timer_future.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+    EXPECT_EQ(functor_future.get(), loop_thread.get_id());
+    EXPECT_EQ(timer_future.get(), loop_thread.get_id());
+    
+    std::string stats = loop->get_stats();
+    bool io_uring = GetParam() == IoUringEventLoop::Backend::IO_URING;
+    EXPECT_EQ(loop->using_io_uring(), io_uring);
+    EXPECT_NE(stats.find(io_uring ? "Backend: io_uring" : "Backend: epoll"), std::string::npos);
+}
+
+TEST_P(IoUringEventLoopTest, MultishotAcceptAndRecvEcho) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    ASSERT_NE(listen_fd, -1);
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(listen(listen_fd, 16), 0);
+    socklen_t addr_len = sizeof(addr);
+    ASSERT_EQ(getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len), 0);
+    
+    // 服务端：每个新连接注册multishot recv并原样回写，对端关闭时关闭连接
+    std::atomic<int> accepted{0};
+    std::atomic<int> closed{0};
+    loop->accept_multishot(listen_fd, [&](int, int conn_fd) {
+        accepted++;
+        loop->recv_multishot(conn_fd, [&closed](int fd, const char* data, ssize_t len) {
+            if (len > 0) {
+                send(fd, data, static_cast<size_t>(len), MSG_NOSIGNAL);
+            } else {
+                close(fd);
+                closed++;
+            }
+        });
+    });
+    start();
+    
+    const int clients = 3;
+    for (int i = 0; i < clients; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_NE(fd, -1);
+        ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        
+        std::string message = "message " + std::to_string(i);
+        for (int round = 0; round < 2; ++round) {
+            ASSERT_EQ(send(fd, message.data(), message.size(), 0), static_cast<ssize_t>(message.size()));
+            std::string echo(message.size(), '\0');
+            size_t got = 0;
+            while (got < echo.size()) {
+                ssize_t n = recv(fd, &echo[got], echo.size() - got, 0);
+                ASSERT_GT(n, 0);
+                got += static_cast<size_t>(n);
+            }
+            EXPECT_EQ(echo, message);
+        }
+        close(fd);
+    }
+    
+    for (int i = 0; i < 200 && closed < clients; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(accepted, clients);
+    EXPECT_EQ(closed, clients);
+    
+    loop->remove_fd(listen_fd);
+    close(listen_fd);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, IoUringEventLoopTest,
+                         ::testing::Values(IoUringEventLoop::Backend::IO_URING,
+                                           IoUringEventLoop::Backend::EPOLL));
+
+// UdpEndpoint测试：两个端点在同一事件循环上通过回环地址收发
+class UdpEndpointTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        loop_thread = std::thread([this]() {
+            loop.run();
+        });
+        while (!loop.is_running()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    
+    void TearDown() override {
+        loop.stop();
+        loop_thread.join();
+    }
+    
+    template <typename F>
+    auto in_loop(F f) -> decltype(f()) {
+        std::promise<decltype(f())> result;
+        loop.queue_in_loop([&]() {
+            result.set_value(f());
+        });
+        return result.get_future().get();
+    }
+    
+    UdpEndpoint::Ptr open_endpoint() {
+        int fd = UdpEndpoint::bind_socket("127.0.0.1", 0);
+        auto endpoint = UdpEndpoint::create(loop, fd, 32);
+        return endpoint;
+    }
+    
+    EpollEventLoop loop;
+    std::thread loop_thread;
+};
+
+TEST_F(UdpEndpointTest, BatchedEchoRoundTrip) {
+    auto server = open_endpoint();
+    auto client = open_endpoint();
+    sockaddr_in server_addr = UdpEndpoint::make_address("127.0.0.1", EpollEventLoop::get_local_port(server->fd()));
+    
+    // 服务端整批回写，回复在本批结束时一次sendmmsg发出
+    server->set_batch_callback([](const UdpEndpoint::Ptr& ep, const Datagram* dgrams, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            ep->send_to(dgrams[i].peer, dgrams[i].data, dgrams[i].len);
+        }
+    });
+    
+    const int total = 256;
+    std::atomic<int> replies{0};
+    std::atomic<bool> in_order{true};
+    client->set_batch_callback([&](const UdpEndpoint::Ptr&, const Datagram* dgrams, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            std::string expected = "datagram " + std::to_string(replies.load());
+            if (std::string(dgrams[i].data, dgrams[i].len) != expected) {
+                in_order = false;
+            }
+            replies++;
+        }
+    });
+    server->start();
+    client->start();
+    
+    in_loop([&]() {
+        for (int i = 0; i < total; ++i) {
+            client->send_to(server_addr, "datagram " + std::to_string(i));
+        }
+        return 0;
+    });
+    
+    for (int i = 0; i < 400 && replies < total; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(replies, total);
+    EXPECT_TRUE(in_order);
+    
+    // 256个数据报一次sendmmsg发出，接收按32个一批
+    EXPECT_EQ(in_loop([&]() { return client->send_calls(); }), 1u);
+    EXPECT_EQ(in_loop([&]() { return client->datagrams_sent(); }), static_cast<uint64_t>(total));
+    EXPECT_LT(in_loop([&]() { return server->recv_calls(); }), static_cast<uint64_t>(total));
+    EXPECT_EQ(in_loop([&]() { return server->datagrams_received(); }), static_cast<uint64_t>(total));
+    
+    server->close();
+    client->close();
+}
+
+TEST_F(UdpEndpointTest, GsoCoalescesEqualSizedDatagrams) {
+    auto sender = open_endpoint();
+    auto receiver = open_endpoint();
+    if (!sender->enable_gso(100)) {
+        GTEST_SKIP() << "UDP GSO not supported";
+    }
+    sockaddr_in receiver_addr = UdpEndpoint::make_address("127.0.0.1",
+                                                         EpollEventLoop::get_local_port(receiver->fd()));
+    
+    std::mutex mutex;
+    std::vector<std::string> received;
+    receiver->set_batch_callback([&](const UdpEndpoint::Ptr&, const Datagram* dgrams, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i) {
+            received.emplace_back(dgrams[i].data, dgrams[i].len);
+        }
+    });
+    receiver->start();
+    sender->start();
+    
+    // 10个满分段 + 1个短分段合并为一个消息，另一个大于分段大小的数据报单独发送
+    in_loop([&]() {
+        for (int i = 0; i < 10; ++i) {
+            sender->send_to(receiver_addr, std::string(100, static_cast<char>('a' + i)));
+        }
+        sender->send_to(receiver_addr, std::string(40, 'z'));
+        sender->send_to(receiver_addr, std::string(300, 'L'));
+        return 0;
+    });
+    
+    for (int i = 0; i < 400; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (received.size() >= 12) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ASSERT_EQ(received.size(), 12u);
+        for (int i = 0; i < 10; ++i) {
+            EXPECT_EQ(received[i], std::string(100, static_cast<char>('a' + i)));
+        }
+        EXPECT_EQ(received[10], std::string(40, 'z'));
+        EXPECT_EQ(received[11], std::string(300, 'L'));
+    }
+    EXPECT_EQ(in_loop([&]() { return sender->send_calls(); }), 1u);
+    EXPECT_EQ(in_loop([&]() { return sender->datagrams_sent(); }), 12u);
+    
+    sender->close();
+    receiver->close();
+}
+
+// 运行时指标测试：慢处理器回调、按类型的执行时间、定时器延迟
+TEST_F(EpollEventLoopTest, MetricsAndSlowHandlerHook) {
+    int pipe_fds[2];
+    ASSERT_EQ(pipe(pipe_fds), 0);
+    
+    std::mutex mutex;
+    std::vector<SlowHandlerInfo> slow;
+    loop->set_slow_handler_callback(std::chrono::milliseconds(10), [&](const SlowHandlerInfo& info) {
+        std::lock_guard<std::mutex> lock(mutex);
+        slow.push_back(info);
+    });
+    
+    // 阻塞循环20ms的处理器
+    loop->add_fd(pipe_fds[0], EPOLLIN, make_simple_handler(
+        [](int fd) {
+            char buffer[16];
+            read(fd, buffer, sizeof(buffer));
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        },
+        [](int, const std::string&) {}
+    ));
+    
+    std::promise<void> timer_fired;
+    loop->add_timer(std::chrono::milliseconds(5), make_simple_timer([&timer_fired]() {
+        timer_fired.set_value();
+    }));
+    
+    std::thread loop_thread([this]() {
+        loop->run();
+    });
+    timer_fired.get_future().get();
+    ASSERT_EQ(write(pipe_fds[1], "x", 1), 1);
+    
+    for (int i = 0; i < 200; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!slow.empty()) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ASSERT_EQ(slow.size(), 1u);
+        EXPECT_EQ(slow[0].fd, pipe_fds[0]);
+        EXPECT_NE(std::string(slow[0].kind).find("SimpleEventHandler"), std::string::npos);
+        EXPECT_GE(slow[0].elapsed, std::chrono::milliseconds(20));
+    }
+    
+    LoopMetrics metrics = loop->get_metrics();
+    EXPECT_GE(metrics.iterations, 2u);
+    EXPECT_EQ(metrics.events_per_wakeup.count, metrics.iterations);
+    EXPECT_EQ(metrics.timer_lateness_ns.count, 1u);
+    EXPECT_EQ(metrics.slow_calls, 1u);
+    
+    bool found = false;
+    for (const auto& handler : metrics.handler_time_ns) {
+        if (handler.type.find("SimpleEventHandler") != std::string::npos) {
+            found = true;
+            EXPECT_EQ(handler.time_ns.count, 1u);
+            EXPECT_GE(handler.time_ns.max, 20000000u);
+            EXPECT_GE(handler.time_ns.percentile(50), 16000000u);
+        }
+    }
+    EXPECT_TRUE(found);
+    EXPECT_NE(loop->get_stats().find("Slow Calls: 1"), std::string::npos);
+    
+    loop->stop();
+    loop_thread.join();
+    loop->remove_fd(pipe_fds[0]);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+}
+
+TEST(Log2HistogramTest, PercentilesFollowBuckets) {
+    Log2Histogram histogram;
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        histogram.record(v);
+    }
+    Log2Histogram::Snapshot snap = histogram.snapshot();
+    EXPECT_EQ(snap.count, 1000u);
+    EXPECT_EQ(snap.max, 1000u);
+    EXPECT_EQ(snap.sum, 500500u);
+    // 第500个值落在 [256, 512) 桶，返回桶上界；p100不超过最大值
+    EXPECT_EQ(snap.percentile(50), 511u);
+    EXPECT_EQ(snap.percentile(100), 1000u);
+    EXPECT_EQ(Log2Histogram().snapshot().percentile(99), 0u);
+}
+
+// Connector测试：异步连接的成功、拒绝、超时和取消
+class ConnectorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        loop_thread = std::thread([this]() {
+            loop.run();
+        });
+        while (!loop.is_running()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    
+    void TearDown() override {
+        loop.stop();
+        loop_thread.join();
+    }
+    
+    /**
+     * @brief 连接结果：成功时为连接fd，失败时为负的errno
+     */
+    std::future<int> connect(int port, std::chrono::milliseconds timeout, Connector::Ptr* connector = nullptr) {
+        auto result = std::make_shared<std::promise<int>>();
+        auto c = Connector::connect(loop, "127.0.0.1", port, timeout,
+            [this, result](int fd) {
+                EXPECT_TRUE(loop.is_in_loop_thread());
+                result->set_value(fd);
+            },
+            [this, result](int error) {
+                EXPECT_TRUE(loop.is_in_loop_thread());
+                result->set_value(-error);
+            });
+        if (connector) {
+            *connector = c;
+        }
+        return result->get_future();
+    }
+    
+    EpollEventLoop loop;
+    std::thread loop_thread;
+};
+
+TEST_F(ConnectorTest, ManyParallelConnectsSucceed) {
+    int listen_fd = EpollEventLoop::create_listen_socket(0, 256, false);
+    int port = EpollEventLoop::get_local_port(listen_fd);
+    
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; ++i) {
+        results.push_back(connect(port, std::chrono::seconds(5)));
+    }
+    for (auto& result : results) {
+        int fd = result.get();
+        ASSERT_GE(fd, 0);
+        EXPECT_NE(EpollEventLoop::get_local_port(fd), port);
+        sockaddr_in peer;
+        socklen_t len = sizeof(peer);
+        ASSERT_EQ(getpeername(fd, reinterpret_cast<sockaddr*>(&peer), &len), 0);
+        EXPECT_EQ(ntohs(peer.sin_port), port);
+        close(fd);
+    }
+    close(listen_fd);
+}
+
+TEST_F(ConnectorTest, RefusedConnectionFails) {
+    // 绑定后立即关闭，得到一个没有监听者的端口
+    int fd = EpollEventLoop::create_listen_socket(0, 1, false);
+    int port = EpollEventLoop::get_local_port(fd);
+    close(fd);
+    
+    EXPECT_EQ(connect(port, std::chrono::seconds(5)).get(), -ECONNREFUSED);
+}
+
+TEST_F(ConnectorTest, DeadlineExpiresWhenHandshakeStalls) {
+    // 监听队列长度为0：第一个连接占满接受队列，之后的SYN被丢弃，握手一直不完成
+    int listen_fd = EpollEventLoop::create_listen_socket(0, 0, false);
+    int port = EpollEventLoop::get_local_port(listen_fd);
+    int first = connect(port, std::chrono::seconds(5)).get();
+    ASSERT_GE(first, 0);
+    
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(connect(port, std::chrono::milliseconds(100)).get(), -ETIMEDOUT);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(100));
+    EXPECT_LT(elapsed, std::chrono::seconds(2));
+    
+    // 取消同样只回调一次
+    Connector::Ptr connector;
+    auto result = connect(port, std::chrono::seconds(10), &connector);
+    connector->cancel();
+    EXPECT_EQ(result.get(), -ECANCELED);
+    close(first);
+    close(listen_fd);
+}
+
+TEST_F(ConnectorTest, CancelOnLoopThreadFailsAsynchronously) {
+    int listen_fd = EpollEventLoop::create_listen_socket(0, 16, false);
+    int port = EpollEventLoop::get_local_port(listen_fd);
+    
+    // 在循环线程上发起并立即取消：cancel()返回时失败回调尚未执行，随后以ECANCELED回调一次
+    std::promise<std::future<int>> started;
+    std::promise<bool> reported_inline;
+    loop.queue_in_loop([&]() {
+        Connector::Ptr connector;
+        auto result = connect(port, std::chrono::seconds(5), &connector);
+        connector->cancel();
+        reported_inline.set_value(result.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+        started.set_value(std::move(result));
+    });
+    EXPECT_FALSE(reported_inline.get_future().get());
+    EXPECT_EQ(started.get_future().get().get(), -ECANCELED);
+    close(listen_fd);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -0,0 +1,151 @@
+#include "rpc_buffer.hpp"
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace rpc {
+
+namespace detail {
+
+/**
+ * @brief 池的共享状态
+ *
+ * 引用计数为1（池本身）加上尚未归还的块数，池析构且所有块归还后才释放，
+ * 因此缓冲区可以比池活得更久。
+ */
+struct BufferPoolCore {
+    struct SizeClass {
+        std::mutex mutex;
+        std::vector<BufferBlock*> free;
+        size_t max_cached = 0;
+    };
+
+    SizeClass classes[BufferPool::size_class_count];
+    std::atomic<size_t> refs{1};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    bool closed = false;    // 由各级的mutex保护
+};
+
+namespace {
+
+uint32_t size_class_for(size_t size) {
+    if (size <= BufferPool::min_block_size) {
+        return 0;
+    }
+    // 向上取整到2的幂，64B为第0级
+    return static_cast<uint32_t>(64 - __builtin_clzll(size - 1) - 6);
+}
+
+BufferBlock* new_block(BufferPoolCore* core, uint32_t size_class, size_t capacity) {
+    void* memory = ::operator new(sizeof(BufferBlock) + capacity);
+    BufferBlock* block = new (memory) BufferBlock;
+    block->size_class = size_class;
+    block->capacity = capacity;
+    block->core = core;
+    return block;
+}
+
+void delete_block(BufferBlock* block) {
+    block->~BufferBlock();
+    ::operator delete(block);
+}
+
+void unref_core(BufferPoolCore* core) {
+    if (core->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete core;
+    }
+}
+
+} // namespace
+
+void release_block(BufferBlock* block) noexcept {
+    BufferPoolCore* core = block->core;
+    bool cached = false;
+    if (block->size_class != BufferBlock::unpooled_class) {
+        BufferPoolCore::SizeClass& size_class = core->classes[block->size_class];
+        std::lock_guard<std::mutex> lock(size_class.mutex);
+        if (!core->closed && size_class.free.size() < size_class.max_cached) {
+            size_class.free.push_back(block);
+            cached = true;
+        }
+    }
+    if (!cached) {
+        delete_block(block);
+    }
+    unref_core(core);
+}
+
+} // namespace detail
+
+BufferPool::BufferPool(size_t max_cached_bytes_per_class)
+    : core_(new detail::BufferPoolCore) {
+    for (size_t i = 0; i < size_class_count; ++i) {
+        size_t block_size = min_block_size << i;
+        core_->classes[i].max_cached = std::max<size_t>(1, max_cached_bytes_per_class / block_size);
+    }
+}
+
+BufferPool::~BufferPool() {
+    for (auto& size_class : core_->classes) {
+        std::lock_guard<std::mutex> lock(size_class.mutex);
+        core_->closed = true;
+        for (detail::BufferBlock* block : size_class.free) {
+            detail::delete_block(block);
+        }
+        size_class.free.clear();
+    }
+    detail::unref_core(core_);
+}
+
+PayloadBuffer BufferPool::allocate(size_t size) {
+    if (size == 0) {
+        return PayloadBuffer();
+    }
+
+    detail::BufferBlock* block = nullptr;
+    if (size > max_pooled_size) {
+        block = detail::new_block(core_, detail::BufferBlock::unpooled_class, size);
+        core_->misses.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        uint32_t index = detail::size_class_for(size);
+        auto& size_class = core_->classes[index];
+        {
+            std::lock_guard<std::mutex> lock(size_class.mutex);
+            if (!size_class.free.empty()) {
+                block = size_class.free.back();
+                size_class.free.pop_back();
+            }
+        }
+        if (block) {
+            core_->hits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            block = detail::new_block(core_, index, min_block_size << index);
+            core_->misses.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    block->refs.store(1, std::memory_order_relaxed);
+    core_->refs.fetch_add(1, std::memory_order_relaxed);
+    return PayloadBuffer(block, size);
+}
+
+size_t BufferPool::cached_blocks() const {
+    size_t count = 0;
+    for (auto& size_class : core_->classes) {
+        std::lock_guard<std::mutex> lock(size_class.mutex);
+        count += size_class.free.size();
+    }
+    return count;
+}
+
+uint64_t BufferPool::pool_hits() const {
+    return core_->hits.load(std::memory_order_relaxed);
+}
+
+uint64_t BufferPool::pool_misses() const {
+    return core_->misses.load(std::memory_order_relaxed);
+}
+
+} // namespace rpc
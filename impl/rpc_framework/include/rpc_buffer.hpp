@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace rpc {
+
+namespace detail {
+
+struct BufferPoolCore;
+
+/**
+ * @brief 缓冲区内存块的头部，数据紧跟在头部之后
+ */
+struct BufferBlock {
+    std::atomic<uint32_t> refs;
+    uint32_t size_class;        // 不入池的大块为unpooled_class
+    size_t capacity;
+    BufferPoolCore* core;
+
+    static constexpr uint32_t unpooled_class = UINT32_MAX;
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+/**
+ * @brief 最后一个引用释放时调用：块回到所属池的空闲链表，或直接释放
+ */
+void release_block(BufferBlock* block) noexcept;
+
+} // namespace detail
+
+/**
+ * @brief 引用计数的负载缓冲区
+ *
+ * 复制只增加引用计数，最后一个引用释放时内存块回到分配它的BufferPool。
+ * 内容不做初始化，由分配者写入；空缓冲区不占用内存块。
+ * slice()返回共享同一内存块的子区间，批量帧中的各个请求据此引用各自的负载而不复制。
+ */
+class PayloadBuffer {
+public:
+    PayloadBuffer() noexcept : block_(nullptr), data_(nullptr), size_(0) {}
+    PayloadBuffer(const PayloadBuffer& other) noexcept
+        : block_(other.block_), data_(other.data_), size_(other.size_) {
+        if (block_) {
+            block_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    PayloadBuffer(PayloadBuffer&& other) noexcept
+        : block_(std::exchange(other.block_, nullptr))
+        , data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0)) {}
+    PayloadBuffer& operator=(PayloadBuffer other) noexcept {
+        std::swap(block_, other.block_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+    ~PayloadBuffer() { reset(); }
+
+    void reset() noexcept {
+        if (block_ && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            detail::release_block(block_);
+        }
+        block_ = nullptr;
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    /**
+     * @brief 共享同一内存块的子区间[offset, offset + length)，调用者保证不越界
+     */
+    PayloadBuffer slice(size_t offset, size_t length) const noexcept {
+        if (length == 0) {
+            return PayloadBuffer();
+        }
+        PayloadBuffer result(*this);
+        result.data_ += offset;
+        result.size_ = length;
+        return result;
+    }
+
+    char* data() noexcept { return data_; }
+    const char* data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+    size_t capacity() const noexcept { return block_ ? block_->capacity : 0; }
+    bool empty() const noexcept { return size_ == 0; }
+    std::string_view view() const noexcept { return std::string_view(data_, size_); }
+    uint32_t use_count() const noexcept { return block_ ? block_->refs.load(std::memory_order_relaxed) : 0; }
+
+private:
+    friend class BufferPool;
+    PayloadBuffer(detail::BufferBlock* block, size_t size) noexcept
+        : block_(block), data_(block->data()), size_(size) {}
+
+    detail::BufferBlock* block_;
+    char* data_;
+    size_t size_;
+};
+
+/**
+ * @brief 按大小分级的负载缓冲区池
+ *
+ * 大小分级为64B到1MB之间的2的幂，每级一个加锁的空闲栈，每级缓存的字节数有上限；
+ * 超过1MB的缓冲区直接分配和释放。分配只取空闲块、不清零，释放可以发生在任意线程。
+ * 池析构后仍在使用的缓冲区照常有效，最后一个引用释放时直接归还给系统。
+ */
+class BufferPool {
+public:
+    static constexpr size_t min_block_size = 64;
+    static constexpr size_t max_pooled_size = size_t(1) << 20;
+    static constexpr size_t size_class_count = 15;   // 64B << 0..14
+
+    explicit BufferPool(size_t max_cached_bytes_per_class = size_t(4) << 20);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @brief 分配size字节的缓冲区，内容未初始化
+     */
+    PayloadBuffer allocate(size_t size);
+
+    /**
+     * @brief 空闲栈中缓存的块数
+     */
+    size_t cached_blocks() const;
+
+    /**
+     * @brief 由空闲块满足的分配次数
+     */
+    uint64_t pool_hits() const;
+
+    /**
+     * @brief 需要向系统申请内存的分配次数
+     */
+    uint64_t pool_misses() const;
+
+private:
+    detail::BufferPoolCore* core_;
+};
+
+} // namespace rpc
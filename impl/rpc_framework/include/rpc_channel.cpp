@@ -0,0 +1,190 @@
+#include "rpc_framework.hpp"
+#include <algorithm>
+
+namespace rpc {
+
+namespace {
+
+std::string backend_key(const std::string& address, uint16_t port) {
+    return address + ":" + std::to_string(port);
+}
+
+} // namespace
+
+RpcChannel::Lease::Lease(LoadBalancer& balancer, std::string address, uint16_t port)
+    : balancer_(balancer)
+    , address_(std::move(address))
+    , port_(port) {
+    balancer_.update_connections(address_, port_, 1);
+}
+
+RpcChannel::Lease::~Lease() {
+    balancer_.update_connections(address_, port_, -1);
+}
+
+RpcChannel::RpcChannel(LoadBalancer::Strategy strategy, ChannelOptions options)
+    : options_(options)
+    , balancer_(strategy) {
+    options_.connections_per_backend = std::max<size_t>(1, options_.connections_per_backend);
+}
+
+RpcChannel::~RpcChannel() {
+    // 先关闭所有连接：未完成的调用在这里回调失败，此时balancer_仍然有效
+    std::map<std::string, std::shared_ptr<Backend>> backends;
+    {
+        std::lock_guard<std::mutex> lock(backends_mutex_);
+        backends.swap(backends_);
+    }
+    backends.clear();
+}
+
+void RpcChannel::add_backend(const std::string& address, uint16_t port) {
+    std::lock_guard<std::mutex> lock(backends_mutex_);
+    std::string key = backend_key(address, port);
+    if (backends_.count(key)) {
+        return;
+    }
+
+    auto backend = std::make_shared<Backend>();
+    backend->address = address;
+    backend->port = port;
+    for (size_t i = 0; i < options_.connections_per_backend; ++i) {
+        backend->connections.push_back(std::make_unique<Connection>());
+    }
+    backends_.emplace(key, std::move(backend));
+    balancer_.add_server(address, port);
+}
+
+void RpcChannel::remove_backend(const std::string& address, uint16_t port) {
+    // 进行中的调用持有连接的引用，移除后照常完成
+    std::shared_ptr<Backend> removed;
+    {
+        std::lock_guard<std::mutex> lock(backends_mutex_);
+        auto it = backends_.find(backend_key(address, port));
+        if (it == backends_.end()) {
+            return;
+        }
+        removed = std::move(it->second);
+        backends_.erase(it);
+        balancer_.remove_server(address, port);
+    }
+}
+
+size_t RpcChannel::backend_count() const {
+    std::lock_guard<std::mutex> lock(backends_mutex_);
+    return backends_.size();
+}
+
+size_t RpcChannel::connected_count() const {
+    // 连接锁不在backends_mutex_下获取
+    std::vector<std::shared_ptr<Backend>> backends;
+    {
+        std::lock_guard<std::mutex> lock(backends_mutex_);
+        for (const auto& entry : backends_) {
+            backends.push_back(entry.second);
+        }
+    }
+
+    size_t count = 0;
+    for (const auto& backend : backends) {
+        for (const auto& connection : backend->connections) {
+            std::lock_guard<std::mutex> connection_lock(connection->mutex);
+            if (connection->client && connection->client->is_connected()) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+std::shared_ptr<RpcClient> RpcChannel::acquire(std::shared_ptr<Lease>& lease) {
+    std::shared_ptr<Backend> selected;
+    std::vector<std::shared_ptr<Backend>> all;
+    {
+        std::lock_guard<std::mutex> lock(backends_mutex_);
+        if (backends_.empty()) {
+            throw rpc_exception("No backends configured");
+        }
+        auto server = balancer_.select_server();
+        auto it = backends_.find(backend_key(server.first, server.second));
+        if (it != backends_.end()) {
+            selected = it->second;
+        }
+        for (const auto& entry : backends_) {
+            all.push_back(entry.second);
+        }
+    }
+
+    // 先用负载均衡选中的后端；它没有可用连接时（断开且在退避中，或重连失败）依次尝试其他后端
+    if (selected) {
+        if (auto client = pick_connection(*selected)) {
+            lease = std::make_shared<Lease>(balancer_, selected->address, selected->port);
+            return client;
+        }
+    }
+    for (const auto& backend : all) {
+        if (backend == selected) {
+            continue;
+        }
+        if (auto client = pick_connection(*backend)) {
+            lease = std::make_shared<Lease>(balancer_, backend->address, backend->port);
+            return client;
+        }
+    }
+    throw rpc_exception("No backend available");
+}
+
+std::shared_ptr<RpcClient> RpcChannel::pick_connection(Backend& backend) {
+    const size_t count = backend.connections.size();
+    size_t start = backend.next.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        Connection& connection = *backend.connections[(start + i) % count];
+        if (auto client = get_connected(backend, connection)) {
+            return client;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<RpcClient> RpcChannel::get_connected(Backend& backend, Connection& connection) {
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        if (connection.client && connection.client->is_connected()) {
+            return connection.client;
+        }
+        // 其他调用正在重连，或仍在退避中：跳过这个连接，不等待
+        if (connection.connecting || std::chrono::steady_clock::now() < connection.next_attempt) {
+            return nullptr;
+        }
+        connection.connecting = true;
+    }
+
+    // 在锁外重连，最多等待connect_timeout；期间其他调用照常使用别的连接
+    std::shared_ptr<RpcClient> client;
+    try {
+        client = std::make_shared<RpcClient>(backend.address, backend.port, options_.max_outstanding_calls);
+        if (options_.compression_threshold > 0) {
+            client->enable_compression(options_.compression_threshold);
+        }
+        client->connect(options_.connect_timeout);
+    } catch (const rpc_exception&) {
+        client = nullptr;
+    }
+
+    // 断开的连接换成新的客户端：旧客户端上的调用已经回调失败，在锁外随最后一个引用释放
+    std::shared_ptr<RpcClient> replaced;
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    connection.connecting = false;
+    if (!client) {
+        connection.backoff = connection.backoff.count() == 0 ?
+            options_.initial_backoff : std::min(connection.backoff * 2, options_.max_backoff);
+        connection.next_attempt = std::chrono::steady_clock::now() + connection.backoff;
+        return nullptr;
+    }
+    replaced = std::move(connection.client);
+    connection.client = client;
+    connection.backoff = std::chrono::milliseconds(0);
+    return client;
+}
+
+} // namespace rpc
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "rpc_framework.hpp"
+
+namespace rpc {
+
+template<typename Ret, typename... Args>
+Ret RpcChannel::call(uint32_t service_id, uint32_t method_id, const Args&... args) {
+    std::shared_ptr<Lease> lease;
+    std::shared_ptr<RpcClient> client = acquire(lease);
+    return client->template call<Ret>(service_id, method_id, args...);
+}
+
+template<typename Ret, typename... Args>
+std::future<Ret> RpcChannel::async_call(uint32_t service_id, uint32_t method_id, const Args&... args) {
+    std::shared_ptr<Lease> lease;
+    std::shared_ptr<RpcClient> client = acquire(lease);
+
+    auto result_promise = std::make_shared<std::promise<Ret>>();
+    auto result_future = result_promise->get_future();
+
+    // 回调持有lease，调用完成（或发送失败、连接断开）时随回调一起释放
+    client->template async_call_with_callback<Ret>(service_id, method_id,
+        [result_promise, lease](Ret result, const std::string& error) {
+            if (error.empty()) {
+                result_promise->set_value(std::move(result));
+            } else {
+                result_promise->set_exception(std::make_exception_ptr(rpc_exception("RPC error: " + error)));
+            }
+        },
+        args...);
+    return result_future;
+}
+
+} // namespace rpc
@@ -1,4 +1,11 @@
 #include "rpc_framework.hpp"
+#include "rpc_codec.hpp"
+#include "rpc_compress.hpp"
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <algorithm>
+#include <cerrno>
 #include <iostream>
 #include <sstream>
 #include <chrono>
@@ -6,66 +13,242 @@
 
 namespace rpc {
 
-RpcClient::RpcClient(const std::string& server_ip, uint16_t server_port)
+namespace {
+
+// 超过该长度的压缩/解压缓冲区用完即释放，不长期占用内存
+constexpr size_t max_retained_buffer = 4 * 1024 * 1024;
+
+void read_exact(int fd, char* data, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t n = recv(fd, data + received, size - received, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw rpc_exception("Failed to receive handshake response");
+        }
+        received += static_cast<size_t>(n);
+    }
+}
+
+uint32_t slot_bits_for(size_t capacity) {
+    // 至少2个槽位，最多2^24个，保留至少8位代数
+    uint32_t bits = 1;
+    while (bits < 24 && (size_t(1) << bits) < capacity) {
+        ++bits;
+    }
+    return bits;
+}
+
+/**
+ * @brief 非阻塞地发起连接并最多等待timeout，成功后恢复为阻塞模式
+ * @return 成功时返回0，否则返回errno（超时为ETIMEDOUT）
+ */
+int connect_with_timeout(int fd, const sockaddr_in& addr, std::chrono::milliseconds timeout) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        return errno;
+    }
+
+    int error = 0;
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+        error = errno;
+    }
+    if (error == EINPROGRESS) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        pollfd pfd{fd, POLLOUT, 0};
+        while (true) {
+            // 向上取整，不会在到期之前返回超时
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            int n = poll(&pfd, 1, static_cast<int>(std::max<int64_t>(remaining.count(), 0)));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                return errno;
+            }
+            if (n == 0) {
+                return ETIMEDOUT;
+            }
+            break;
+        }
+        socklen_t len = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0) {
+            error = errno;
+        }
+    }
+    if (error != 0) {
+        return error;
+    }
+
+    // 接收线程和发送路径都使用阻塞读写
+    if (fcntl(fd, F_SETFL, flags) < 0) {
+        return errno;
+    }
+    return 0;
+}
+
+} // namespace
+
+RpcClient::RpcClient(const std::string& server_ip, uint16_t server_port, size_t max_outstanding_calls)
     : server_ip_(server_ip)
     , server_port_(server_port)
     , socket_fd_(-1)
     , connected_(false)
-    , running_(false)
-    , next_message_id_(1) {
+    , slot_bits_(slot_bits_for(max_outstanding_calls))
+    , slots_(new PendingSlot[size_t(1) << slot_bits_])
+    , free_next_(new std::atomic<uint32_t>[size_t(1) << slot_bits_])
+    , free_head_(0)
+    , outstanding_(0)
+    , heartbeat_running_(false)
+    , batching_(false)
+    , batch_window_(0)
+    , batch_max_bytes_(0)
+    , batch_count_(0)
+    , frames_sent_(0)
+    , compression_threshold_(0)
+    , compress_(false) {
+    // 初始空闲链表按下标顺序串起所有槽位
+    const uint32_t count = uint32_t(1) << slot_bits_;
+    for (uint32_t i = 0; i < count; ++i) {
+        free_next_[i].store(i + 1 < count ? i + 1 : no_slot, std::memory_order_relaxed);
+    }
 }
 
 RpcClient::~RpcClient() {
     stop_heartbeat();
+    disable_batching();
     disconnect();
 }
 
-void RpcClient::connect() {
+void RpcClient::connect(std::chrono::milliseconds timeout) {
     if (connected_) {
         return;
     }
-    
+
+    // 上一个连接的接收线程在连接断开后自行退出，这里回收它；
+    // 接收线程退出前还要回调上一个连接的调用，不能在它自己的完成回调中重新连接
+    if (receive_thread_.joinable()) {
+        if (receive_thread_.get_id() == std::this_thread::get_id()) {
+            throw rpc_exception("Cannot reconnect from a completion callback");
+        }
+        receive_thread_.join();
+    }
+    if (socket_fd_ >= 0) {
+        close(socket_fd_);
+        socket_fd_ = -1;
+    }
+
     // 创建socket
-    socket_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd_ < 0) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
         throw rpc_exception("Failed to create socket");
     }
-    
+
     // 设置服务器地址
     struct sockaddr_in server_addr;
     server_addr.sin_family = AF_INET;
     server_addr.sin_port = htons(server_port_);
-    
+
     if (inet_pton(AF_INET, server_ip_.c_str(), &server_addr.sin_addr) <= 0) {
-        close(socket_fd_);
+        close(fd);
         throw rpc_exception("Invalid server address");
     }
-    
-    // 连接服务器
-    if (::connect(socket_fd_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        close(socket_fd_);
-        throw rpc_exception("Failed to connect to server");
+
+    // 连接服务器，对端不响应时最多等待timeout
+    int error = connect_with_timeout(fd, server_addr, timeout);
+    if (error != 0) {
+        close(fd);
+        throw rpc_exception(error == ETIMEDOUT ? "Connection to server timed out" : "Failed to connect to server");
+    }
+
+    // 多个小请求连续发送时不等待合并
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // 接收线程启动前同步完成能力协商
+    compress_ = false;
+    if (compression_threshold_ > 0) {
+        try {
+            compress_ = negotiate(fd, timeout);
+        } catch (const std::exception&) {
+            close(fd);
+            throw;
+        }
     }
-    
+
+    socket_fd_ = fd;
     connected_ = true;
-    
-    // 启动响应处理线程
-    running_ = true;
-    std::thread response_thread(&RpcClient::handle_responses, this);
-    response_thread.detach();
+
+    // 启动响应处理线程，fd按值传入，disconnect关闭fd时不与接收线程竞争
+    receive_thread_ = std::thread(&RpcClient::handle_responses, this, fd);
 }
 
-void RpcClient::disconnect() {
-    if (!connected_) {
-        return;
+bool RpcClient::negotiate(int fd, std::chrono::milliseconds timeout) {
+    Message hello = create_hello_message(0, capability_compression);
+    write_message(fd, hello.header, hello.payload);
+
+    timeval receive_timeout{static_cast<time_t>(timeout.count() / 1000),
+                            static_cast<suseconds_t>(timeout.count() % 1000 * 1000)};
+    if (receive_timeout.tv_sec == 0 && receive_timeout.tv_usec == 0) {
+        receive_timeout.tv_usec = 1000; // 全0表示不超时
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+    char header_buffer[message_header_size];
+    read_exact(fd, header_buffer, message_header_size);
+    MessageHeader header = decode_header(header_buffer);
+    if (!validate_header(header) || header.payload_size > 4096) {
+        throw rpc_exception("Invalid handshake response");
+    }
+    std::string payload(header.payload_size, '\0');
+    read_exact(fd, &payload[0], payload.size());
+    timeval no_timeout{0, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &no_timeout, sizeof(no_timeout));
+
+    if (header.message_type == static_cast<uint32_t>(MessageType::HELLO)) {
+        return (decode_value<uint32_t>(payload) & capability_compression) != 0;
+    }
+    if (header.message_type == static_cast<uint32_t>(MessageType::ERROR)) {
+        return false;   // 不认识HELLO的服务器回复错误：不使用任何扩展能力
     }
-    
-    running_ = false;
+    throw rpc_exception("Unexpected handshake response");
+}
+
+void RpcClient::enable_compression(size_t threshold) {
+    compression_threshold_ = std::max<size_t>(1, threshold);
+}
+
+void RpcClient::disconnect() {
     connected_ = false;
-    
-    if (socket_fd_ >= 0) {
-        close(socket_fd_);
-        socket_fd_ = -1;
+
+    // shutdown使阻塞在recv上的接收线程返回，由它回调所有未完成的调用
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        if (socket_fd_ >= 0) {
+            shutdown(socket_fd_, SHUT_RDWR);
+        }
+        // 未写出的请求随连接一起放弃，由接收线程回调失败
+        batch_frames_.clear();
+        batch_count_ = 0;
+    }
+
+    if (receive_thread_.joinable()) {
+        if (receive_thread_.get_id() == std::this_thread::get_id()) {
+            // 在完成回调中断开连接：回调返回后接收线程读到shutdown，回调剩余的调用后退出；
+            // fd仍由它使用，留给下一次connect()或析构函数在回收线程后关闭
+            return;
+        }
+        receive_thread_.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        if (socket_fd_ >= 0) {
+            close(socket_fd_);
+            socket_fd_ = -1;
+        }
     }
 }
 
@@ -73,146 +256,382 @@ bool RpcClient::is_connected() const {
     return connected_;
 }
 
-void RpcClient::send_message(const Message& message) {
-    std::lock_guard<std::mutex> lock(socket_mutex_);
-    
+uint32_t RpcClient::acquire_slot() {
+    uint64_t head = free_head_.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t index = static_cast<uint32_t>(head);
+        if (index == no_slot) {
+            return no_slot;
+        }
+        // 读到的next可能因其他线程先取走该槽位而过时，此时标签已变，CAS失败后重试
+        uint32_t next = free_next_[index].load(std::memory_order_relaxed);
+        uint64_t desired = ((head >> 32) + 1) << 32 | next;
+        if (free_head_.compare_exchange_weak(head, desired, std::memory_order_acquire, std::memory_order_acquire)) {
+            return index;
+        }
+    }
+}
+
+void RpcClient::release_slot(uint32_t index) {
+    uint64_t head = free_head_.load(std::memory_order_relaxed);
+    while (true) {
+        free_next_[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        uint64_t desired = ((head >> 32) + 1) << 32 | index;
+        if (free_head_.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+bool RpcClient::take_slot(uint32_t message_id, ResponseCallback& callback) {
+    // 代数为0的ID（如心跳）从不分配给调用
+    if ((message_id >> slot_bits_) == 0) {
+        return false;
+    }
+
+    uint32_t index = message_id & ((uint32_t(1) << slot_bits_) - 1);
+    PendingSlot& slot = slots_[index];
+    uint32_t expected = message_id;
+    if (!slot.message_id.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+        return false; // 已完成、已取消，或是槽位上一代的迟到响应
+    }
+
+    callback = std::move(slot.callback);
+    slot.callback = nullptr;
+    release_slot(index);
+    outstanding_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+uint32_t RpcClient::send_request(uint32_t service_id, uint32_t method_id, std::string_view payload,
+                                 ResponseCallback callback) {
     if (!connected_) {
         throw rpc_exception("Not connected to server");
     }
-    
-    // 序列化消息
-    std::string serialized_message = serialize_message(message);
-    
-    // 发送消息
-    ssize_t bytes_sent = send(socket_fd_, serialized_message.c_str(), serialized_message.size(), 0);
-    if (bytes_sent < 0) {
-        throw rpc_exception("Failed to send message");
+
+    uint32_t index = acquire_slot();
+    if (index == no_slot) {
+        throw rpc_exception("Too many outstanding calls");
     }
-    
-    if (static_cast<size_t>(bytes_sent) != serialized_message.size()) {
-        throw rpc_exception("Failed to send complete message");
+
+    // 代数在高位回绕时跳过0，保证message_id非0
+    PendingSlot& slot = slots_[index];
+    uint32_t generation_mask = UINT32_MAX >> slot_bits_;
+    slot.generation = (slot.generation + 1) & generation_mask;
+    if (slot.generation == 0) {
+        slot.generation = 1;
     }
-}
+    uint32_t message_id = slot.generation << slot_bits_ | index;
+    slot.callback = std::move(callback);
+    outstanding_.fetch_add(1, std::memory_order_relaxed);
+    slot.message_id.store(message_id);
 
-Message RpcClient::receive_message() {
-    std::lock_guard<std::mutex> lock(socket_mutex_);
-    
+    // 与接收线程的“先置connected_为false再清理所有槽位”配对：
+    // 两边都是顺序一致的操作，至少有一方能看到对方，槽位不会被遗漏
     if (!connected_) {
+        ResponseCallback dropped;
+        take_slot(message_id, dropped);
         throw rpc_exception("Not connected to server");
     }
-    
-    // 读取消息头
-    char header_buffer[28];
-    ssize_t bytes_received = recv(socket_fd_, header_buffer, 28, MSG_WAITALL);
-    
-    if (bytes_received < 0) {
-        throw rpc_exception("Failed to receive message header");
-    }
-    
-    if (bytes_received == 0) {
-        connected_ = false;
-        throw rpc_exception("Connection closed by server");
-    }
-    
-    if (bytes_received != 28) {
-        throw rpc_exception("Incomplete message header received");
-    }
-    
-    // 反序列化消息头
-    std::string header_data(header_buffer, 28);
-    MessageHeader header = deserialize_header(header_data);
-    
-    if (!validate_header(header)) {
-        throw rpc_exception("Invalid message header");
-    }
-    
-    // 读取消息负载
-    std::string payload;
-    if (header.payload_size > 0) {
-        payload.resize(header.payload_size);
-        bytes_received = recv(socket_fd_, &payload[0], header.payload_size, MSG_WAITALL);
-        
-        if (bytes_received < 0) {
-            throw rpc_exception("Failed to receive message payload");
-        }
-        
-        if (static_cast<size_t>(bytes_received) != header.payload_size) {
-            throw rpc_exception("Incomplete message payload received");
-        }
-    }
-    
-    // 构造消息
-    Message message;
-    message.header = header;
-    message.payload = payload;
-    
-    return message;
-}
-
-void RpcClient::handle_responses() {
-    while (running_) {
-        try {
-            Message response = receive_message();
-            
-            // 处理响应
-            if (response.header.message_type == static_cast<uint32_t>(MessageType::RESPONSE) ||
-                response.header.message_type == static_cast<uint32_t>(MessageType::ERROR)) {
-                
-                std::lock_guard<std::mutex> lock(pending_mutex_);
-                auto it = pending_calls_.find(response.header.message_id);
-                if (it != pending_calls_.end()) {
-                    if (response.header.message_type == static_cast<uint32_t>(MessageType::ERROR)) {
-                        it->second.set_value("ERR:" + response.payload);
-                    } else {
-                        it->second.set_value(response.payload);
-                    }
-                    pending_calls_.erase(it);
-                }
+
+    try {
+        MessageHeader header;
+        header.magic_number = 0x52504346; // "RPCF"
+        header.message_id = message_id;
+        header.message_type = static_cast<uint32_t>(MessageType::REQUEST);
+        header.service_id = service_id;
+        header.method_id = method_id;
+        header.payload_size = static_cast<uint32_t>(payload.size());
+        header.sequence_id = 0;
+        send_message(header, payload);
+    } catch (const std::exception& e) {
+        ResponseCallback dropped;
+        take_slot(message_id, dropped);
+        throw rpc_exception("Failed to send request: " + std::string(e.what()));
+    }
+    return message_id;
+}
+
+bool RpcClient::cancel(uint32_t message_id) {
+    ResponseCallback dropped;
+    return take_slot(message_id, dropped);
+}
+
+void RpcClient::fail_all(const std::string& error) {
+    const uint32_t count = uint32_t(1) << slot_bits_;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t message_id = slots_[i].message_id.load();
+        ResponseCallback callback;
+        if (message_id != 0 && take_slot(message_id, callback) && callback) {
+            callback(std::string_view(), error);
+        }
+    }
+}
+
+void RpcClient::send_message(const MessageHeader& header, std::string_view payload) {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+
+    if (!connected_ || socket_fd_ < 0) {
+        throw rpc_exception("Not connected to server");
+    }
+
+    // 需要压缩的大请求不参与合并，单独压缩发送
+    bool compress = compress_ && payload.size() >= compression_threshold_;
+    if (batching_ && !compress && header.message_type == static_cast<uint32_t>(MessageType::REQUEST)) {
+        append_message(batch_frames_, header, payload);
+        ++batch_count_;
+        if (batch_frames_.size() >= batch_max_bytes_) {
+            flush_batch();
+        } else if (batch_count_ == 1) {
+            batch_cv_.notify_one();
+        }
+        return;
+    }
+
+    // 已合并的请求先于本条消息写出
+    flush_batch();
+
+    if (compress && write_compressed(header, payload)) {
+        frames_sent_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // 头部和负载一次sendmsg写出，负载不再复制到拼接缓冲区
+    write_message(socket_fd_, header, payload);
+    frames_sent_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool RpcClient::write_compressed(MessageHeader header, std::string_view payload) {
+    if (payload.size() > RpcServer::max_payload_size) {
+        return false;
+    }
+    size_t bound = compressed_payload_bound(payload.size());
+    if (compress_buffer_.size() < bound) {
+        compress_buffer_.resize(bound);
+    }
+    size_t size = compress_payload(payload, &compress_buffer_[0], compress_buffer_.size());
+    if (size > 0) {
+        header.message_type |= message_flag_compressed;
+        header.payload_size = static_cast<uint32_t>(size);
+        write_message(socket_fd_, header, std::string_view(compress_buffer_.data(), size));
+    }
+    if (compress_buffer_.size() > max_retained_buffer) {
+        std::string().swap(compress_buffer_);
+    }
+    return size > 0;
+}
+
+void RpcClient::flush_batch() {
+    if (batch_count_ == 0) {
+        return;
+    }
+
+    try {
+        if (batch_count_ == 1) {
+            write_frames(socket_fd_, batch_frames_);
+        } else {
+            Message batch = create_batch_message(std::string(), batch_count_);
+            batch.header.payload_size = static_cast<uint32_t>(batch_frames_.size());
+            bool compressed = compress_ && batch_frames_.size() >= compression_threshold_ &&
+                              write_compressed(batch.header, batch_frames_);
+            if (!compressed) {
+                write_message(socket_fd_, batch.header, batch_frames_);
             }
-            
+        }
+    } catch (const std::exception&) {
+        // 已合并的调用无法单独撤回：关闭连接，由接收线程回调所有未完成的调用
+        batch_frames_.clear();
+        batch_count_ = 0;
+        shutdown(socket_fd_, SHUT_RDWR);
+        throw;
+    }
+    frames_sent_.fetch_add(1, std::memory_order_relaxed);
+    batch_frames_.clear();
+    batch_count_ = 0;
+}
+
+void RpcClient::enable_batching(std::chrono::microseconds window, size_t max_batch_bytes) {
+    disable_batching();
+
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    batching_ = true;
+    batch_window_ = window;
+    batch_max_bytes_ = max_batch_bytes;
+    batch_frames_.reserve(max_batch_bytes);
+    batch_thread_ = std::thread(&RpcClient::batch_loop, this);
+}
+
+void RpcClient::disable_batching() {
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        if (!batching_) {
+            return;
+        }
+        batching_ = false;
+    }
+    batch_cv_.notify_all();
+    batch_thread_.join();
+}
+
+void RpcClient::batch_loop() {
+    std::unique_lock<std::mutex> lock(send_mutex_);
+    while (batching_) {
+        batch_cv_.wait(lock, [this]() { return !batching_ || batch_count_ > 0; });
+
+        // 从第一个请求入队起等待一个窗口，期间到达的请求一起写出
+        batch_cv_.wait_for(lock, batch_window_, [this]() { return !batching_; });
+        if (socket_fd_ < 0) {
+            batch_frames_.clear();
+            batch_count_ = 0;
+            continue;
+        }
+        try {
+            flush_batch();
         } catch (const std::exception& e) {
-            std::cerr << "Error handling response: " << e.what() << std::endl;
-            connected_ = false;
+            std::cerr << "Failed to send batched requests: " << e.what() << std::endl;
+        }
+    }
+}
+
+void RpcClient::handle_responses(int fd) {
+    // 一次recv可能读到多条响应或半条响应，不完整的部分留在缓冲区开头
+    std::string buffer;
+    size_t filled = 0;
+    std::string error = "Connection closed by server";
+
+    while (true) {
+        if (buffer.size() - filled < 64 * 1024) {
+            buffer.resize(filled + 64 * 1024);
+        }
+        ssize_t n = recv(fd, &buffer[filled], buffer.size() - filled, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n < 0) {
+                error = "Failed to receive response";
+            }
             break;
         }
+        filled += static_cast<size_t>(n);
+
+        // 负载以视图形式直接交给回调，不再为每条响应复制头部和负载
+        size_t pos = 0;
+        bool invalid = false;
+        try {
+            MessageView message;
+            while (parse_message(buffer.data() + pos, filled - pos, message)) {
+                complete(message);
+                pos += message_header_size + message.payload.size();
+            }
+        } catch (const rpc_exception&) {
+            invalid = true;
+        }
+        if (invalid) {
+            error = "Invalid message header";
+            break;
+        }
+        buffer.erase(0, pos);
+        filled -= pos;
+    }
+
+    if (connected_.exchange(false)) {
+        std::cerr << "Error handling response: " << error << std::endl;
+    }
+    fail_all(error);
+}
+
+void RpcClient::complete(const MessageView& message) {
+    const MessageHeader& header = message.header;
+    if (header.message_type & message_flag_compressed) {
+        // 解压到接收线程复用的缓冲区，再按原始消息处理
+        uint32_t original = compressed_payload_size(message.payload);
+        if (original > RpcServer::max_payload_size) {
+            throw rpc_exception("Decompressed payload too large");
+        }
+        if (decompress_buffer_.size() < original) {
+            decompress_buffer_.resize(original);
+        }
+        decompress_payload(message.payload, &decompress_buffer_[0]);
+        MessageView plain;
+        plain.header = header;
+        plain.header.message_type &= ~message_flag_compressed;
+        plain.header.payload_size = original;
+        plain.payload = std::string_view(decompress_buffer_.data(), original);
+        complete(plain);
+        if (decompress_buffer_.size() > max_retained_buffer) {
+            std::string().swap(decompress_buffer_);
+        }
+        return;
+    }
+    if (header.message_type == static_cast<uint32_t>(MessageType::BATCH)) {
+        // 批量响应逐条完成；格式错误时抛出，由接收线程按无效帧关闭连接
+        if (!validate_batch(message.payload, header.sequence_id)) {
+            throw rpc_exception("Invalid batch frame");
+        }
+        size_t pos = 0;
+        MessageView entry;
+        while (pos < message.payload.size() &&
+               parse_message(message.payload.data() + pos, message.payload.size() - pos, entry)) {
+            complete(entry);
+            pos += message_header_size + entry.payload.size();
+        }
+        return;
+    }
+
+    bool is_error = header.message_type == static_cast<uint32_t>(MessageType::ERROR);
+    if (!is_error && header.message_type != static_cast<uint32_t>(MessageType::RESPONSE)) {
+        return;
+    }
+
+    ResponseCallback callback;
+    if (!take_slot(header.message_id, callback) || !callback) {
+        return;
+    }
+    if (is_error) {
+        callback(std::string_view(), message.payload.empty() ? "Unknown error" : std::string(message.payload));
+    } else {
+        callback(message.payload, "");
     }
 }
 
 void RpcClient::start_heartbeat() {
-    if (running_) {
+    if (heartbeat_running_.exchange(true)) {
         return;
     }
-    
-    running_ = true;
+
     heartbeat_thread_ = std::thread(&RpcClient::heartbeat_loop, this);
 }
 
 void RpcClient::stop_heartbeat() {
-    if (!running_) {
-        return;
+    {
+        std::lock_guard<std::mutex> lock(heartbeat_mutex_);
+        if (!heartbeat_running_.exchange(false)) {
+            return;
+        }
     }
-    
-    running_ = false;
+    heartbeat_cv_.notify_all();
     if (heartbeat_thread_.joinable()) {
         heartbeat_thread_.join();
     }
 }
 
 void RpcClient::heartbeat_loop() {
-    while (running_ && connected_) {
+    std::unique_lock<std::mutex> lock(heartbeat_mutex_);
+    while (heartbeat_running_ && connected_) {
         try {
-            // 发送心跳消息
-            Message heartbeat = create_heartbeat_message(next_message_id_++);
-            send_message(heartbeat);
-            
-            // 等待5秒
-            std::this_thread::sleep_for(std::chrono::seconds(5));
-            
+            // 心跳使用ID 0，服务端的回应不会与任何调用匹配
+            lock.unlock();
+            Message heartbeat = create_heartbeat_message(0);
+            send_message(heartbeat.header, heartbeat.payload);
+            lock.lock();
         } catch (const std::exception& e) {
             std::cerr << "Heartbeat failed: " << e.what() << std::endl;
-            connected_ = false;
             break;
         }
+
+        // 每5秒一次，stop_heartbeat可以随时唤醒
+        heartbeat_cv_.wait_for(lock, std::chrono::seconds(5), [this]() { return !heartbeat_running_; });
     }
 }
 
@@ -221,4 +640,4 @@ std::shared_ptr<RpcClient> create_rpc_client(const std::string& server_ip, uint1
     return std::make_shared<RpcClient>(server_ip, server_port);
 }
 
-} // namespace rpc
\ No newline at end of file
+} // namespace rpc
@@ -0,0 +1,347 @@
+#pragma once
+
+#include "rpc_exception.hpp"
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace rpc {
+
+/**
+ * @brief 二进制编码写入器
+ *
+ * 编码直接追加到内部的std::string，不经过iostream。clear()只重置长度、保留容量，
+ * 同一个写入器可以反复用于编码，稳定后不再分配内存。
+ */
+class ByteWriter {
+public:
+    ByteWriter() = default;
+    explicit ByteWriter(size_t reserve) { buffer_.reserve(reserve); }
+
+    void clear() { buffer_.clear(); }
+    size_t size() const { return buffer_.size(); }
+    const std::string& buffer() const { return buffer_; }
+    std::string& buffer() { return buffer_; }
+
+    /**
+     * @brief 无符号LEB128变长整数：每字节7位，最高位表示后面还有字节
+     */
+    void write_varint(uint64_t value) {
+        char bytes[10];
+        size_t n = 0;
+        while (value >= 0x80) {
+            bytes[n++] = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        bytes[n++] = static_cast<char>(value);
+        buffer_.append(bytes, n);
+    }
+
+    /**
+     * @brief 有符号整数先做ZigZag映射（0,-1,1,-2 -> 0,1,2,3），小绝对值的负数也只占1字节
+     */
+    void write_signed_varint(int64_t value) {
+        write_varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void write_fixed32(uint32_t value) {
+        char bytes[4];
+        for (int i = 0; i < 4; ++i) {
+            bytes[i] = static_cast<char>(value >> (8 * i));
+        }
+        buffer_.append(bytes, 4);
+    }
+
+    void write_fixed64(uint64_t value) {
+        char bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<char>(value >> (8 * i));
+        }
+        buffer_.append(bytes, 8);
+    }
+
+    void write_byte(uint8_t value) {
+        buffer_.push_back(static_cast<char>(value));
+    }
+
+    /**
+     * @brief 长度前缀（varint）加原始字节
+     */
+    void write_bytes(const void* data, size_t len) {
+        write_varint(len);
+        buffer_.append(static_cast<const char*>(data), len);
+    }
+
+private:
+    std::string buffer_;
+};
+
+/**
+ * @brief 二进制编码读取器，只引用外部数据不复制；数据不足时抛出rpc_exception
+ */
+class ByteReader {
+public:
+    ByteReader(const char* data, size_t size) : data_(data), size_(size), pos_(0) {}
+    explicit ByteReader(const std::string& data) : ByteReader(data.data(), data.size()) {}
+    explicit ByteReader(std::string_view data) : ByteReader(data.data(), data.size()) {}
+
+    size_t remaining() const { return size_ - pos_; }
+
+    uint64_t read_varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = read_byte();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw rpc_exception("Malformed varint");
+    }
+
+    int64_t read_signed_varint() {
+        uint64_t value = read_varint();
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    uint32_t read_fixed32() {
+        const char* p = take(4);
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    uint64_t read_fixed64() {
+        const char* p = take(8);
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    uint8_t read_byte() {
+        return static_cast<uint8_t>(*take(1));
+    }
+
+    /**
+     * @brief 读取长度前缀的字节串，返回指向原数据的指针
+     */
+    const char* read_bytes(size_t& len) {
+        uint64_t n = read_varint();
+        if (n > remaining()) {
+            throw rpc_exception("Truncated byte string");
+        }
+        len = static_cast<size_t>(n);
+        return take(len);
+    }
+
+private:
+    const char* take(size_t n) {
+        if (n > remaining()) {
+            throw rpc_exception("Truncated RPC data");
+        }
+        const char* p = data_ + pos_;
+        pos_ += n;
+        return p;
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t pos_;
+};
+
+/**
+ * @brief 按类型选择的编解码器，在编译期为每种参数类型生成编码代码
+ *
+ * 编码格式：
+ * - bool：1字节
+ * - 无符号整数：LEB128变长；有符号整数：ZigZag后LEB128变长；枚举按底层类型
+ * - float/double：IEEE 754位模式，小端定长4/8字节
+ * - 字符串：varint长度 + 原始字节（可以包含'\0'）
+ * - vector/map：varint元素数 + 依次编码的元素（map为键、值交替）
+ */
+template<typename T, typename Enable = void>
+struct Codec {
+    static_assert(sizeof(T) == 0, "No RPC codec for this type");
+};
+
+template<>
+struct Codec<bool> {
+    static void encode(ByteWriter& writer, bool value) { writer.write_byte(value ? 1 : 0); }
+    static bool decode(ByteReader& reader) { return reader.read_byte() != 0; }
+};
+
+template<typename T>
+struct Codec<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+    static void encode(ByteWriter& writer, T value) {
+        if constexpr (std::is_signed_v<T>) {
+            writer.write_signed_varint(static_cast<int64_t>(value));
+        } else {
+            writer.write_varint(static_cast<uint64_t>(value));
+        }
+    }
+    static T decode(ByteReader& reader) {
+        if constexpr (std::is_signed_v<T>) {
+            return static_cast<T>(reader.read_signed_varint());
+        } else {
+            return static_cast<T>(reader.read_varint());
+        }
+    }
+};
+
+template<typename T>
+struct Codec<T, std::enable_if_t<std::is_enum_v<T>>> {
+    using Underlying = std::underlying_type_t<T>;
+    static void encode(ByteWriter& writer, T value) {
+        Codec<Underlying>::encode(writer, static_cast<Underlying>(value));
+    }
+    static T decode(ByteReader& reader) { return static_cast<T>(Codec<Underlying>::decode(reader)); }
+};
+
+template<>
+struct Codec<float> {
+    static void encode(ByteWriter& writer, float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writer.write_fixed32(bits);
+    }
+    static float decode(ByteReader& reader) {
+        uint32_t bits = reader.read_fixed32();
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+template<>
+struct Codec<double> {
+    static void encode(ByteWriter& writer, double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writer.write_fixed64(bits);
+    }
+    static double decode(ByteReader& reader) {
+        uint64_t bits = reader.read_fixed64();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+template<>
+struct Codec<std::string> {
+    static void encode(ByteWriter& writer, const std::string& value) {
+        writer.write_bytes(value.data(), value.size());
+    }
+    static std::string decode(ByteReader& reader) {
+        size_t len;
+        const char* data = reader.read_bytes(len);
+        return std::string(data, len);
+    }
+};
+
+// 字符串字面量和C字符串只能编码，按std::string解码
+template<>
+struct Codec<const char*> {
+    static void encode(ByteWriter& writer, const char* value) {
+        writer.write_bytes(value, std::strlen(value));
+    }
+};
+
+template<>
+struct Codec<char*> : Codec<const char*> {};
+
+template<typename T>
+struct Codec<std::vector<T>> {
+    static void encode(ByteWriter& writer, const std::vector<T>& value) {
+        writer.write_varint(value.size());
+        for (const auto& item : value) {
+            Codec<T>::encode(writer, item);
+        }
+    }
+    static std::vector<T> decode(ByteReader& reader) {
+        uint64_t count = reader.read_varint();
+        // 每个元素至少1字节，元素数不可能超过剩余字节数，避免恶意长度导致巨量分配
+        if (count > reader.remaining()) {
+            throw rpc_exception("Truncated vector");
+        }
+        std::vector<T> result;
+        result.reserve(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count; ++i) {
+            result.push_back(Codec<T>::decode(reader));
+        }
+        return result;
+    }
+};
+
+template<typename K, typename V>
+struct Codec<std::map<K, V>> {
+    static void encode(ByteWriter& writer, const std::map<K, V>& value) {
+        writer.write_varint(value.size());
+        for (const auto& [key, item] : value) {
+            Codec<K>::encode(writer, key);
+            Codec<V>::encode(writer, item);
+        }
+    }
+    static std::map<K, V> decode(ByteReader& reader) {
+        uint64_t count = reader.read_varint();
+        if (count > reader.remaining()) {
+            throw rpc_exception("Truncated map");
+        }
+        std::map<K, V> result;
+        for (uint64_t i = 0; i < count; ++i) {
+            K key = Codec<K>::decode(reader);
+            result.emplace(std::move(key), Codec<V>::decode(reader));
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief 依次编码所有参数（参数个数由两端的类型决定，不写入数据）
+ */
+template<typename... Args>
+void encode_args(ByteWriter& writer, const Args&... args) {
+    (Codec<std::decay_t<Args>>::encode(writer, args), ...);
+}
+
+/**
+ * @brief 按类型依次解码参数
+ */
+template<typename... Args>
+std::tuple<Args...> decode_args(ByteReader& reader) {
+    // 花括号初始化保证从左到右求值
+    return std::tuple<Args...>{Codec<Args>::decode(reader)...};
+}
+
+/**
+ * @brief 编码单个值为字符串
+ */
+template<typename T>
+std::string encode_value(const T& value) {
+    ByteWriter writer;
+    Codec<std::decay_t<T>>::encode(writer, value);
+    return std::move(writer.buffer());
+}
+
+/**
+ * @brief 从字符串解码单个值，要求数据恰好用完
+ */
+template<typename T>
+T decode_value(std::string_view data) {
+    ByteReader reader(data);
+    T value = Codec<T>::decode(reader);
+    if (reader.remaining() != 0) {
+        throw rpc_exception("Trailing bytes after RPC value");
+    }
+    return value;
+}
+
+} // namespace rpc
@@ -0,0 +1,233 @@
+#include "rpc_compress.hpp"
+#include "rpc_framework.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace rpc {
+
+namespace {
+
+constexpr size_t min_match = 4;
+constexpr size_t last_literals = 5;     // 最后5个字节必须是字面量
+constexpr size_t match_start_limit = 12; // 最后一个匹配必须在结尾12字节之前开始
+constexpr size_t max_offset = 65535;
+constexpr int hash_bits = 12;
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t hash_sequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - hash_bits);
+}
+
+inline void write_length(uint8_t*& op, size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+}
+
+// 一个序列最多需要的字节数：token、两段长度扩展、字面量和偏移
+inline size_t sequence_bound(size_t literal_length, size_t match_length) {
+    return 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1;
+}
+
+} // namespace
+
+size_t compress_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t compress_block(const char* src, size_t size, char* dst, size_t capacity) {
+    const uint8_t* const base = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* const end = base + size;
+    const uint8_t* ip = base;
+    const uint8_t* anchor = base;
+    uint8_t* op = reinterpret_cast<uint8_t*>(dst);
+    uint8_t* const op_end = op + capacity;
+
+    if (size > match_start_limit) {
+        // 表项是相对base的位置，使用前检查位置在ip之前并比较实际内容，因此清零只是为了确定性
+        uint32_t table[1 << hash_bits];
+        std::memset(table, 0, sizeof(table));
+        const uint8_t* const match_limit = end - match_start_limit;
+        const uint8_t* const literal_limit = end - last_literals;
+
+        while (ip < match_limit) {
+            uint32_t sequence = read32(ip);
+            uint32_t& entry = table[hash_sequence(sequence)];
+            const uint8_t* ref = base + entry;
+            entry = static_cast<uint32_t>(ip - base);
+
+            if (ref >= ip || static_cast<size_t>(ip - ref) > max_offset || read32(ref) != sequence) {
+                // 连续未命中时每64字节加大一次步长
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            // 向前扩展匹配，再向后扩展到最后5个字节之前
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+            const uint8_t* match_end = ip + min_match;
+            const uint8_t* ref_end = ref + min_match;
+            while (match_end < literal_limit && *match_end == *ref_end) {
+                ++match_end;
+                ++ref_end;
+            }
+
+            size_t literal_length = static_cast<size_t>(ip - anchor);
+            size_t match_length = static_cast<size_t>(match_end - ip) - min_match;
+            if (static_cast<size_t>(op_end - op) < sequence_bound(literal_length, match_length)) {
+                return 0;
+            }
+
+            uint8_t* token = op++;
+            *token = static_cast<uint8_t>((std::min<size_t>(literal_length, 15) << 4) |
+                                          std::min<size_t>(match_length, 15));
+            if (literal_length >= 15) {
+                write_length(op, literal_length - 15);
+            }
+            std::memcpy(op, anchor, literal_length);
+            op += literal_length;
+
+            size_t offset = static_cast<size_t>(ip - ref);
+            *op++ = static_cast<uint8_t>(offset);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+            if (match_length >= 15) {
+                write_length(op, match_length - 15);
+            }
+
+            ip = match_end;
+            anchor = ip;
+        }
+    }
+
+    // 剩余字节作为最后一个只有字面量的序列
+    size_t literal_length = static_cast<size_t>(end - anchor);
+    if (static_cast<size_t>(op_end - op) < 1 + literal_length / 255 + 1 + literal_length) {
+        return 0;
+    }
+    *op++ = static_cast<uint8_t>(std::min<size_t>(literal_length, 15) << 4);
+    if (literal_length >= 15) {
+        write_length(op, literal_length - 15);
+    }
+    std::memcpy(op, anchor, literal_length);
+    op += literal_length;
+
+    return static_cast<size_t>(op - reinterpret_cast<uint8_t*>(dst));
+}
+
+bool decompress_block(const char* src, size_t size, char* dst, size_t original_size) {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* const ip_end = ip + size;
+    uint8_t* op = reinterpret_cast<uint8_t*>(dst);
+    uint8_t* const base = op;
+    uint8_t* const op_end = op + original_size;
+
+    // 读取长度扩展，每一步都检查输入边界
+    auto read_length = [&](size_t& length) {
+        uint8_t byte;
+        do {
+            if (ip >= ip_end) {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (true) {
+        if (ip >= ip_end) {
+            return false;
+        }
+        uint8_t token = *ip++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !read_length(literal_length)) {
+            return false;
+        }
+        if (literal_length > static_cast<size_t>(ip_end - ip) || literal_length > static_cast<size_t>(op_end - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        if (ip == ip_end) {
+            break;  // 最后一个序列没有匹配
+        }
+
+        if (ip_end - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - base)) {
+            return false;
+        }
+
+        size_t match_length = token & 15;
+        if (match_length == 15 && !read_length(match_length)) {
+            return false;
+        }
+        match_length += min_match;
+        if (match_length > static_cast<size_t>(op_end - op)) {
+            return false;
+        }
+
+        // 偏移小于匹配长度时源与目标重叠：每次复制已经写出的部分，复制长度逐次翻倍
+        const uint8_t* match = op - offset;
+        while (match_length > 0) {
+            size_t chunk = std::min(match_length, static_cast<size_t>(op - match));
+            std::memcpy(op, match, chunk);
+            op += chunk;
+            match_length -= chunk;
+        }
+    }
+
+    return op == op_end;
+}
+
+size_t compress_payload(std::string_view payload, char* out, size_t capacity) {
+    // 结果必须比原始数据短才值得压缩，超出即放弃，不可压缩的数据不会完整走一遍输出
+    size_t limit = std::min(capacity, payload.size());
+    if (limit <= 5 || payload.size() > UINT32_MAX) {
+        return 0;
+    }
+    size_t compressed = compress_block(payload.data(), payload.size(), out + 4, limit - 5);
+    if (compressed == 0) {
+        return 0;
+    }
+    uint32_t original = static_cast<uint32_t>(payload.size());
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>(original >> (8 * i));
+    }
+    return 4 + compressed;
+}
+
+uint32_t compressed_payload_size(std::string_view compressed) {
+    if (compressed.size() < 4) {
+        throw rpc_exception("Truncated compressed payload");
+    }
+    uint32_t original = 0;
+    for (int i = 0; i < 4; ++i) {
+        original |= static_cast<uint32_t>(static_cast<uint8_t>(compressed[i])) << (8 * i);
+    }
+    return original;
+}
+
+void decompress_payload(std::string_view compressed, char* out) {
+    uint32_t original = compressed_payload_size(compressed);
+    if (!decompress_block(compressed.data() + 4, compressed.size() - 4, out, original)) {
+        throw rpc_exception("Corrupted compressed payload");
+    }
+}
+
+} // namespace rpc
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace rpc {
+
+/**
+ * @brief LZ4块格式的压缩器（不含帧格式），无外部依赖
+ *
+ * 每个序列为：token（高4位字面量长度、低4位匹配长度-4）、字面量长度扩展、字面量、
+ * 2字节小端偏移、匹配长度扩展；长度达到15时用后续字节累加（每字节最多255）。
+ * 最后一个序列只有字面量，最后5个字节总是字面量。压缩用4096项的哈希表查找4字节匹配，
+ * 连续未命中时加大步长，不可压缩的数据很快跳过。
+ */
+
+/**
+ * @brief 压缩size字节可能需要的最大输出长度
+ */
+size_t compress_bound(size_t size);
+
+/**
+ * @brief 压缩一个数据块
+ * @return 输出长度；输出超过capacity时返回0
+ */
+size_t compress_block(const char* src, size_t size, char* dst, size_t capacity);
+
+/**
+ * @brief 解压一个数据块，输出必须恰好为original_size字节
+ * @return 数据损坏（越界的长度或偏移、长度不符）时返回false
+ */
+bool decompress_block(const char* src, size_t size, char* dst, size_t original_size);
+
+/**
+ * @brief 压缩负载的最大长度：4字节小端原始长度前缀加压缩块
+ */
+inline size_t compressed_payload_bound(size_t size) {
+    return 4 + compress_bound(size);
+}
+
+/**
+ * @brief 压缩负载到out
+ * @return 压缩后的长度；不小于原始长度（不值得压缩）或超过capacity时返回0
+ */
+size_t compress_payload(std::string_view payload, char* out, size_t capacity);
+
+/**
+ * @brief 读取压缩负载的原始长度
+ * @throws rpc_exception 数据不足4字节
+ */
+uint32_t compressed_payload_size(std::string_view compressed);
+
+/**
+ * @brief 解压负载到out，out至少有compressed_payload_size()字节
+ * @throws rpc_exception 数据损坏
+ */
+void decompress_payload(std::string_view compressed, char* out);
+
+} // namespace rpc
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+namespace rpc {
+
+/**
+ * @brief RPC框架异常类
+ */
+class rpc_exception : public std::runtime_error {
+public:
+    explicit rpc_exception(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+} // namespace rpc
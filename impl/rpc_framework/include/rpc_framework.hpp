@@ -10,22 +10,25 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 #include <stdexcept>
 #include <cstdint>
+#include <string_view>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include "rpc_buffer.hpp"
+#include "rpc_exception.hpp"
 
-namespace rpc {
+namespace impl {
+class EpollEventLoop;
+class TcpConnection;
+class RingBuffer;
+class thread_pool;
+} // namespace impl
 
-/**
- * @brief RPC框架异常类
- */
-class rpc_exception : public std::runtime_error {
-public:
-    explicit rpc_exception(const std::string& msg) : std::runtime_error(msg) {}
-};
+namespace rpc {
 
 /**
  * @brief 序列化接口
@@ -45,9 +48,36 @@ enum class MessageType {
     REQUEST = 1,
     RESPONSE = 2,
     ERROR = 3,
-    HEARTBEAT = 4
+    HEARTBEAT = 4,
+    BATCH = 5,      // 负载为若干条完整的请求帧或响应帧，sequence_id为条数
+    HELLO = 6       // 连接建立后协商能力，负载为按Codec编码的能力位（uint32）
 };
 
+/**
+ * @brief message_type的低16位是消息类型，高位是标志
+ */
+constexpr uint32_t message_type_mask = 0xFFFF;
+
+/**
+ * @brief 负载经过压缩：前4字节（小端）为原始长度，其后为压缩块（rpc_compress.hpp）
+ */
+constexpr uint32_t message_flag_compressed = uint32_t(1) << 16;
+
+/**
+ * @brief HELLO中的能力位：支持压缩负载
+ */
+constexpr uint32_t capability_compression = 1;
+
+/**
+ * @brief 默认压缩阈值，负载达到该长度才尝试压缩
+ */
+constexpr size_t default_compression_threshold = 4096;
+
+/**
+ * @brief 默认连接超时，包括TCP握手和能力协商
+ */
+constexpr std::chrono::milliseconds default_connect_timeout{5000};
+
 /**
  * @brief RPC消息头
  */
@@ -58,9 +88,14 @@ struct MessageHeader {
     uint32_t service_id;     // 服务ID
     uint32_t method_id;      // 方法ID
     uint32_t payload_size;   // 负载大小
-    uint32_t sequence_id;    // 序列号
+    uint32_t sequence_id;    // 序列号（批量帧中为条数）
 };
 
+/**
+ * @brief 消息头在线路上的长度（7个网络字节序的uint32）
+ */
+constexpr size_t message_header_size = 28;
+
 /**
  * @brief RPC消息
  */
@@ -69,6 +104,14 @@ struct Message {
     std::string payload;
 };
 
+/**
+ * @brief 不拥有数据的消息视图，负载直接指向接收缓冲区，缓冲区被修改前有效
+ */
+struct MessageView {
+    MessageHeader header;
+    std::string_view payload;
+};
+
 /**
  * @brief RPC服务接口
  */
@@ -76,16 +119,97 @@ class Service {
 public:
     virtual ~Service() = default;
     virtual std::string call_method(uint32_t method_id, const std::string& args) = 0;
+    
+    /**
+     * @brief 服务器调用的入口，参数是池化的引用计数缓冲区
+     *
+     * 需要在调用返回后继续使用参数的服务可以重写此函数并保留缓冲区的副本；
+     * 默认复制为std::string后调用call_method。
+     */
+    virtual std::string handle_call(uint32_t method_id, const PayloadBuffer& args) {
+        return call_method(method_id, std::string(args.view()));
+    }
+    
     virtual uint32_t get_service_id() const = 0;
     virtual std::string get_service_name() const = 0;
 };
 
+/**
+ * @brief 类型化方法的调用入口：解码参数、调用实现对象的成员函数、编码结果
+ * @param instance 实现对象
+ * @param args 按Codec编码的参数，直接在接收缓冲区上解码
+ * @return 按Codec编码的结果（void方法返回空字符串）
+ */
+using MethodInvoker = std::string (*)(void* instance, const PayloadBuffer& args);
+
+/**
+ * @brief 类型化服务定义
+ *
+ * 用 bind<&Impl::method>(method_id) 绑定成员函数，参数解码、调用和结果编码的代码在编译期生成，
+ * 实现类不需要继承Service、也不需要手写按method_id分派的switch：
+ * @code
+ * TypedService<Calculator> calc(1, "Calculator", std::make_shared<Calculator>());
+ * calc.bind<&Calculator::add>(1).bind<&Calculator::concat>(2);
+ * server.register_service(calc);
+ * @endcode
+ */
+template<typename Impl>
+class TypedService {
+public:
+    TypedService(uint32_t service_id, std::string service_name, std::shared_ptr<Impl> impl);
+    
+    /**
+     * @brief 把成员函数绑定到method_id
+     * @throws rpc_exception method_id已绑定或超出分派表范围
+     */
+    template<auto Method>
+    TypedService& bind(uint32_t method_id);
+    
+    uint32_t get_service_id() const { return service_id_; }
+    const std::string& get_service_name() const { return service_name_; }
+    const std::shared_ptr<Impl>& impl() const { return impl_; }
+    const std::vector<std::pair<uint32_t, MethodInvoker>>& methods() const { return methods_; }
+    
+private:
+    uint32_t service_id_;
+    std::string service_name_;
+    std::shared_ptr<Impl> impl_;
+    std::vector<std::pair<uint32_t, MethodInvoker>> methods_;
+};
+
 /**
  * @brief RPC客户端
+ *
+ * 多路复用的异步实现：
+ * - 所有调用共享一个连接，请求按message_id与响应匹配，不要求服务端按顺序响应
+ * - 待完成调用保存在固定容量的无锁槽位数组中，message_id的低位是槽位下标、高位是槽位的代数，
+ *   迟到的旧响应因代数不符而被丢弃
+ * - 发送由发送锁串行化，接收线程独占读取，二者互不阻塞
+ * - 开启请求合并后，短时间内发出的请求合并为一个批量帧一次写出
+ * - 完成时在接收线程上回调，或通过future返回结果
  */
 class RpcClient {
 public:
-    RpcClient(const std::string& server_ip, uint16_t server_port);
+    /**
+     * @brief 调用完成回调，在接收线程上执行，不应阻塞
+     * @param payload 响应负载，直接指向接收缓冲区，只在回调期间有效；失败时为空
+     * @param error 错误信息，成功时为空
+     */
+    using ResponseCallback = std::function<void(std::string_view payload, const std::string& error)>;
+    
+    /**
+     * @brief 默认最大并发调用数
+     */
+    static constexpr size_t default_max_outstanding_calls = size_t(1) << 17;
+    
+    /**
+     * @brief 构造函数
+     * @param server_ip 服务器地址
+     * @param server_port 服务器端口
+     * @param max_outstanding_calls 最大并发调用数（向上取整为2的幂，每个槽位约40字节）
+     */
+    RpcClient(const std::string& server_ip, uint16_t server_port,
+              size_t max_outstanding_calls = default_max_outstanding_calls);
     ~RpcClient();
     
     // 禁用拷贝
@@ -93,7 +217,19 @@ public:
     RpcClient& operator=(const RpcClient&) = delete;
     
     // 连接管理
-    void connect();
+    /**
+     * @brief 连接服务器，先回收上一个连接的接收线程
+     * @param timeout TCP握手和能力协商各自最多等待的时间
+     * @throws rpc_exception 连接失败或超时，或在完成回调中调用
+     */
+    void connect(std::chrono::milliseconds timeout = default_connect_timeout);
+    
+    /**
+     * @brief 断开连接，未完成的调用以错误回调
+     *
+     * 可以在完成回调中调用：此时不等待接收线程，由下一次connect()或析构函数回收。
+     * 不能在完成回调中销毁客户端。
+     */
     void disconnect();
     bool is_connected() const;
     
@@ -101,47 +237,168 @@ public:
     template<typename Ret, typename... Args>
     Ret call(uint32_t service_id, uint32_t method_id, const Args&... args);
     
-    // 异步RPC调用
+    // 异步RPC调用，不占用额外线程
     template<typename Ret, typename... Args>
     std::future<Ret> async_call(uint32_t service_id, uint32_t method_id, const Args&... args);
     
+    /**
+     * @brief 异步RPC调用，完成时在接收线程上回调（失败时result为默认值）
+     */
+    template<typename Ret, typename... Args>
+    void async_call_with_callback(uint32_t service_id, uint32_t method_id,
+                                  std::function<void(Ret result, const std::string& error)> callback,
+                                  const Args&... args);
+    
+    /**
+     * @brief 发送已序列化的请求
+     * @return 本次调用的message_id，可用于cancel
+     * @throws rpc_exception 未连接、并发调用数已满或发送失败
+     */
+    uint32_t send_request(uint32_t service_id, uint32_t method_id, std::string_view payload,
+                          ResponseCallback callback);
+    
+    /**
+     * @brief 放弃一个尚未完成的调用，之后到达的响应被丢弃，回调不会执行
+     * @return 调用仍未完成并被取消时返回true
+     */
+    bool cancel(uint32_t message_id);
+    
+    /**
+     * @brief 尚未完成的调用数
+     */
+    size_t outstanding_calls() const { return outstanding_.load(std::memory_order_relaxed); }
+    
     // 心跳检测
     void start_heartbeat();
     void stop_heartbeat();
     
+    /**
+     * @brief 开启请求合并
+     *
+     * 第一个请求入队后最多等待window，期间发出的请求与它合并为一个批量帧，用一次写出发送；
+     * 已合并的字节数达到max_batch_bytes时由发送方立即写出。只有一个请求时按普通帧发送。
+     */
+    void enable_batching(std::chrono::microseconds window, size_t max_batch_bytes = 64 * 1024);
+    
+    /**
+     * @brief 写出已合并的请求并停止合并，之后每个请求立即发送
+     */
+    void disable_batching();
+    
+    /**
+     * @brief 已写出的帧数，一个批量帧计为一帧
+     */
+    uint64_t frames_sent() const { return frames_sent_.load(std::memory_order_relaxed); }
+    
+    /**
+     * @brief 请求压缩，在下一次connect()时与服务器协商
+     *
+     * 双方都支持时，长度达到threshold的请求（或合并后的批量帧）压缩后发送，服务器也会压缩较大的响应；
+     * 服务器不支持时照常以不压缩的方式通信。
+     */
+    void enable_compression(size_t threshold = default_compression_threshold);
+    
+    /**
+     * @brief 当前连接是否协商了压缩
+     */
+    bool compression_negotiated() const { return compress_.load(); }
+    
 private:
+    /**
+     * @brief 待完成调用的槽位
+     *
+     * message_id为0表示空闲。callback和generation只由持有槽位的线程访问：
+     * 槽位从空闲链表取出后由发送方写入，响应方通过CAS把message_id置0取得所有权后读出。
+     */
+    struct PendingSlot {
+        std::atomic<uint32_t> message_id{0};
+        uint32_t generation = 0;
+        ResponseCallback callback;
+    };
+    
+    static constexpr uint32_t no_slot = UINT32_MAX;
+    
     std::string server_ip_;
     uint16_t server_port_;
     int socket_fd_;
     std::atomic<bool> connected_;
-    std::atomic<bool> running_;
+    std::thread receive_thread_;
+    std::mutex send_mutex_;                 // 串行化发送，接收不需要加锁
+    
+    // 无锁槽位数组与空闲链表（Treiber栈，头部为“标签<<32 | 下标”，标签防止ABA）
+    uint32_t slot_bits_;
+    std::unique_ptr<PendingSlot[]> slots_;
+    std::unique_ptr<std::atomic<uint32_t>[]> free_next_;
+    std::atomic<uint64_t> free_head_;
+    std::atomic<size_t> outstanding_;
+    
+    // 心跳
+    std::atomic<bool> heartbeat_running_;
     std::thread heartbeat_thread_;
-    std::mutex socket_mutex_;
-    std::map<uint32_t, std::promise<std::string>> pending_calls_;
-    std::mutex pending_mutex_;
-    std::condition_variable pending_cv_;
-    std::atomic<uint32_t> next_message_id_;
+    std::mutex heartbeat_mutex_;
+    std::condition_variable heartbeat_cv_;
+    
+    // 请求合并，除frames_sent_外都由send_mutex_保护
+    bool batching_;
+    std::chrono::microseconds batch_window_;
+    size_t batch_max_bytes_;
+    std::string batch_frames_;              // 已编码、等待写出的请求帧
+    uint32_t batch_count_;
+    std::atomic<uint64_t> frames_sent_;
+    std::thread batch_thread_;
+    std::condition_variable batch_cv_;
+    
+    // 压缩：阈值为0表示不请求压缩；压缩缓冲区由send_mutex_保护，解压缓冲区只由接收线程使用
+    size_t compression_threshold_;
+    std::atomic<bool> compress_;
+    std::string compress_buffer_;
+    std::string decompress_buffer_;
+    
+    // 槽位管理
+    uint32_t acquire_slot();
+    void release_slot(uint32_t index);
+    bool take_slot(uint32_t message_id, ResponseCallback& callback);
+    void fail_all(const std::string& error);
     
     // 网络操作
-    void send_message(const Message& message);
-    Message receive_message();
-    void handle_responses();
+    void send_message(const MessageHeader& header, std::string_view payload);
+    void handle_responses(int fd);
+    void complete(const MessageView& message);
     void heartbeat_loop();
+    void batch_loop();
+    void flush_batch();                     // 调用者持有send_mutex_
+    bool write_compressed(MessageHeader header, std::string_view payload);  // 调用者持有send_mutex_，不值得压缩时返回false
+    bool negotiate(int fd, std::chrono::milliseconds timeout);
     
-    // 序列化
+    // 序列化：编码到本线程复用的缓冲区并返回其引用，下一次编码前有效
     template<typename... Args>
-    std::string serialize_args(const Args&... args);
+    static const std::string& serialize_args(const Args&... args);
     
     template<typename Ret>
-    Ret deserialize_result(const std::string& data);
+    Ret deserialize_result(std::string_view data);
 };
 
 /**
  * @brief RPC服务器
+ *
+ * 基于EpollEventLoop的事件驱动实现：
+ * - 一个循环线程负责接受连接和非阻塞读写，从输入缓冲区中增量地切分出完整消息
+ * - 请求交给有界的 impl::thread_pool 执行，响应投递回循环线程写出
+ * - 同一连接上的请求并发执行，响应按完成顺序写出、由message_id匹配；
+ *   每个连接同时执行的请求数有上限，积压过多时暂停读取该连接
+ * - 线程数固定，与连接数无关，空闲连接只占用一个fd槽位和连接缓冲区
  */
 class RpcServer {
 public:
-    RpcServer(uint16_t port);
+    /**
+     * @brief 构造函数
+     * @param port 监听端口，0表示由内核分配（启动后通过port()获取）
+     * @param worker_threads 执行请求的线程数（0表示使用硬件并发数）
+     * @param max_queue_size 线程池任务队列上限，队列满时直接返回错误响应（0表示无限制）
+     * @param max_in_flight_per_connection 单个连接同时交给线程池的请求数上限（至少为1，1表示按到达顺序逐个处理）
+     */
+    RpcServer(uint16_t port, size_t worker_threads = 0, size_t max_queue_size = 4096,
+              size_t max_in_flight_per_connection = default_max_in_flight_per_connection);
     ~RpcServer();
     
     // 禁用拷贝
@@ -152,32 +409,126 @@ public:
     void register_service(std::shared_ptr<Service> service);
     void unregister_service(uint32_t service_id);
     
+    /**
+     * @brief 注册类型化服务，方法直接进入分派表
+     */
+    template<typename Impl>
+    void register_service(const TypedService<Impl>& service);
+    
     // 服务器控制
     void start();
     void stop();
     bool is_running() const;
     
+    /**
+     * @brief 分派表支持的最大服务ID和方法ID
+     */
+    static constexpr uint32_t max_service_id = 0xFFFF;
+    static constexpr uint32_t max_method_id = 0xFFFF;
+    
+    /**
+     * @brief 实际监听的端口
+     */
+    uint16_t port() const { return port_; }
+    
+    /**
+     * @brief 当前连接数
+     */
+    size_t connection_count() const { return active_connections_.load(); }
+    
     // 获取统计信息
     std::string get_stats() const;
     
+    /**
+     * @brief 允许压缩：客户端在HELLO中请求压缩时，长度达到threshold的响应压缩后发送
+     *
+     * 压缩的请求总是可以解压；只有协商过压缩的连接才会收到压缩的响应。须在start()之前调用。
+     */
+    void enable_compression(size_t threshold = default_compression_threshold);
+    
+    /**
+     * @brief 请求负载的缓冲区池
+     */
+    const BufferPool& buffer_pool() const { return buffer_pool_; }
+    
+    /**
+     * @brief 单个请求负载的上限，超过时关闭连接
+     */
+    static constexpr uint32_t max_payload_size = 64 * 1024 * 1024;
+    
+    /**
+     * @brief 单个连接允许积压（已接收、尚未交给线程池）的请求数，达到时暂停读取该连接
+     */
+    static constexpr size_t max_pending_requests = 64;
+    
+    /**
+     * @brief 默认的单连接并发执行上限
+     */
+    static constexpr size_t default_max_in_flight_per_connection = 32;
+    
 private:
+    class Acceptor;
+    struct ConnectionContext;
+    using ConnectionPtr = std::shared_ptr<impl::TcpConnection>;
+    
+    /**
+     * @brief 服务器收到的请求，负载来自buffer_pool_，处理完毕后归还
+     */
+    struct Request {
+        MessageHeader header;
+        PayloadBuffer payload;
+    };
+    
+    /**
+     * @brief 一个已注册的服务：类型化服务按method_id索引调用入口，Service接口的服务走虚函数
+     */
+    struct ServiceEntry {
+        std::string name;
+        std::shared_ptr<void> instance;
+        std::vector<MethodInvoker> methods;     // 下标为method_id，未绑定为nullptr
+        std::shared_ptr<Service> service;
+    };
+    
+    /**
+     * @brief 分派表：下标为service_id。发布后不再修改，注册变化时整体替换
+     */
+    struct DispatchTable {
+        std::vector<std::shared_ptr<const ServiceEntry>> services;
+    };
+    
     uint16_t port_;
     int server_fd_;
     std::atomic<bool> running_;
-    std::map<uint32_t, std::shared_ptr<Service>> services_;
+    
+    // 注册表只在注册/注销时加锁修改；请求路径原子加载当前分派表的引用，按下标查表，
+    // 旧表在最后一个正在使用它的请求结束时释放
+    std::map<uint32_t, std::shared_ptr<const ServiceEntry>> services_;
     std::mutex services_mutex_;
-    std::vector<std::thread> worker_threads_;
+    std::shared_ptr<const DispatchTable> dispatch_table_;  // 只通过std::atomic_load/atomic_store访问
+    size_t worker_thread_count_;
+    size_t max_queue_size_;
+    size_t max_in_flight_;
+    size_t compression_threshold_;          // 0表示不压缩响应
+    std::unique_ptr<impl::EpollEventLoop> loop_;
+    std::thread loop_thread_;
+    std::unique_ptr<impl::thread_pool> workers_;
     std::atomic<uint64_t> total_calls_;
     std::atomic<uint64_t> failed_calls_;
+    std::atomic<size_t> active_connections_;
+    BufferPool buffer_pool_;
     
-    // 网络操作
-    void accept_connections();
-    void handle_client(int client_fd);
-    Message receive_message(int client_fd);
-    void send_message(int client_fd, const Message& message);
+    // 网络操作（循环线程）
+    void on_connection(int client_fd);
+    void on_message(const ConnectionPtr& conn, impl::RingBuffer& input);
+    void dispatch_next(const ConnectionPtr& conn);
     
     // RPC处理
-    Message process_request(const Message& request);
+    void add_service(uint32_t service_id, std::shared_ptr<const ServiceEntry> entry);
+    void publish_dispatch_table();
+    Message process_request(const Request& request);
+    Message process_batch(const Request& batch);
+    Message reject_request(const Request& request, const std::string& reason);
+    PayloadBuffer compress_message(MessageHeader& header, std::string_view payload);
 };
 
 /**
@@ -231,7 +582,7 @@ public:
     // 选择服务器
     std::pair<std::string, uint16_t> select_server();
     
-    // 更新连接数
+    // 更新连接数，已移除的服务器忽略
     void update_connections(const std::string& address, uint16_t port, int delta);
     
 private:
@@ -246,6 +597,100 @@ private:
     std::pair<std::string, uint16_t> select_least_connections();
 };
 
+/**
+ * @brief RpcChannel的配置
+ */
+struct ChannelOptions {
+    size_t connections_per_backend = 2;                 // 每个后端的连接数，连接按轮转分担调用
+    size_t max_outstanding_calls = 4096;                // 每个连接的最大并发调用数
+    std::chrono::milliseconds initial_backoff{100};     // 连接失败后首次重试的间隔
+    std::chrono::milliseconds max_backoff{10000};       // 重试间隔每次翻倍，不超过该上限
+    size_t compression_threshold = 0;                   // 大于0时在连接上协商压缩
+    std::chrono::milliseconds connect_timeout{1000};    // 重连时TCP握手和能力协商各自的超时
+};
+
+/**
+ * @brief 负载均衡的RPC通道
+ *
+ * - 每个后端保持一个连接池，连接是多路复用的RpcClient，按需建立
+ * - 每次调用先由LoadBalancer选择后端，再在该后端的连接池中轮转选择已连接的连接
+ * - 调用开始和结束时通过update_connections报告后端上进行中的调用数，
+ *   连接是多路复用的，LEAST_CONNECTIONS据此选择负担最轻的后端
+ * - 断开的连接在下一次被选中时重连，最多等待connect_timeout，失败后按指数退避推迟重试；
+ *   正在被其他调用重连的连接直接跳过；选中的后端没有可用连接时依次尝试其他后端
+ */
+class RpcChannel {
+public:
+    explicit RpcChannel(LoadBalancer::Strategy strategy = LoadBalancer::Strategy::ROUND_ROBIN,
+                        ChannelOptions options = ChannelOptions());
+    ~RpcChannel();
+    
+    // 禁用拷贝
+    RpcChannel(const RpcChannel&) = delete;
+    RpcChannel& operator=(const RpcChannel&) = delete;
+    
+    // 后端管理
+    void add_backend(const std::string& address, uint16_t port);
+    void remove_backend(const std::string& address, uint16_t port);
+    size_t backend_count() const;
+    
+    /**
+     * @brief 所有后端上当前已连接的连接数
+     */
+    size_t connected_count() const;
+    
+    /**
+     * @throws rpc_exception 没有可用的后端，或调用失败
+     */
+    template<typename Ret, typename... Args>
+    Ret call(uint32_t service_id, uint32_t method_id, const Args&... args);
+    
+    template<typename Ret, typename... Args>
+    std::future<Ret> async_call(uint32_t service_id, uint32_t method_id, const Args&... args);
+    
+private:
+    struct Connection {
+        std::mutex mutex;                               // 保护以下成员，不在重连期间持有
+        bool connecting = false;                        // 某个调用正在重连，其他调用跳过
+        std::shared_ptr<RpcClient> client;
+        std::chrono::steady_clock::time_point next_attempt;
+        std::chrono::milliseconds backoff{0};
+    };
+    
+    struct Backend {
+        std::string address;
+        uint16_t port;
+        std::vector<std::unique_ptr<Connection>> connections;
+        std::atomic<size_t> next{0};
+    };
+    
+    /**
+     * @brief 一次调用占用的后端，构造时报告+1，析构时报告-1
+     */
+    class Lease {
+    public:
+        Lease(LoadBalancer& balancer, std::string address, uint16_t port);
+        ~Lease();
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        
+    private:
+        LoadBalancer& balancer_;
+        std::string address_;
+        uint16_t port_;
+    };
+    
+    // balancer_在backends_之前声明、之后析构：关闭连接时失败回调仍会报告调用结束
+    ChannelOptions options_;
+    LoadBalancer balancer_;
+    std::map<std::string, std::shared_ptr<Backend>> backends_;
+    mutable std::mutex backends_mutex_;
+    
+    std::shared_ptr<RpcClient> acquire(std::shared_ptr<Lease>& lease);
+    std::shared_ptr<RpcClient> pick_connection(Backend& backend);
+    std::shared_ptr<RpcClient> get_connected(Backend& backend, Connection& connection);
+};
+
 /**
  * @brief 工厂函数：创建RPC客户端
  */
@@ -261,13 +706,55 @@ std::string serialize_header(const MessageHeader& header);
 MessageHeader deserialize_header(const std::string& data);
 std::string serialize_message(const Message& message);
 Message deserialize_message(const std::string& data);
+
+/**
+ * @brief 把消息头编码到调用者提供的 message_header_size 字节缓冲区（通常在栈上）
+ */
+void encode_header(const MessageHeader& header, char* out);
+
+/**
+ * @brief 从至少 message_header_size 字节的数据解码消息头
+ */
+MessageHeader decode_header(const char* data);
+
+/**
+ * @brief 从缓冲区开头解析一条消息，负载以视图形式返回，不复制
+ * @return 数据不足一条完整消息时返回false
+ * @throws rpc_exception 魔数错误
+ */
+bool parse_message(const char* data, size_t size, MessageView& message);
+
+/**
+ * @brief 用一次sendmsg（gather写）发送栈上的消息头和原地的负载，处理部分写出
+ * @throws rpc_exception 发送失败
+ */
+void write_message(int fd, const MessageHeader& header, std::string_view payload);
+
+/**
+ * @brief 发送已经编码好的一条或多条完整消息，处理部分写出
+ * @throws rpc_exception 发送失败
+ */
+void write_frames(int fd, std::string_view frames);
+
+/**
+ * @brief 把一条消息编码后追加到out，用于拼装批量帧的负载
+ */
+void append_message(std::string& out, const MessageHeader& header, std::string_view payload);
+
+/**
+ * @brief 检查批量帧的负载恰好由count条完整的非批量消息组成
+ */
+bool validate_batch(std::string_view frames, uint32_t count);
+
 Message create_request_message(uint32_t service_id, uint32_t method_id, 
-                             uint32_t message_id, const std::string& payload);
+                             uint32_t message_id, std::string payload);
 Message create_response_message(uint32_t service_id, uint32_t method_id,
-                              uint32_t message_id, const std::string& payload);
+                              uint32_t message_id, std::string payload);
 Message create_error_message(uint32_t service_id, uint32_t method_id,
-                           uint32_t message_id, const std::string& error_msg);
+                           uint32_t message_id, std::string error_msg);
 Message create_heartbeat_message(uint32_t message_id);
+Message create_batch_message(std::string frames, uint32_t count);
+Message create_hello_message(uint32_t message_id, uint32_t capabilities);
 uint32_t generate_message_id();
 bool validate_header(const MessageHeader& header);
 std::string get_message_type_string(MessageType type);
@@ -276,4 +763,6 @@ std::string get_message_type_string(MessageType type);
 
 // 模板实现
 #include "rpc_client.tpp"
-#include "rpc_serializer.tpp"
\ No newline at end of file
+#include "rpc_serializer.tpp"
+#include "rpc_service.tpp"
+#include "rpc_channel.tpp"
\ No newline at end of file
@@ -1,95 +1,187 @@
 #include "rpc_framework.hpp"
+#include "rpc_codec.hpp"
 #include <cstring>
 #include <iostream>
 #include <chrono>
 #include <random>
 #include <fcntl.h>
+#include <sys/uio.h>
 
 namespace rpc {
 
-// 序列化消息头
-std::string serialize_header(const MessageHeader& header) {
-    std::string result(28, '\0'); // 7 * 4 bytes
-    
+// 编码消息头到调用者提供的缓冲区
+void encode_header(const MessageHeader& header, char* out) {
     // 转换为网络字节序
-    uint32_t magic = htonl(header.magic_number);
-    uint32_t msg_id = htonl(header.message_id);
-    uint32_t msg_type = htonl(header.message_type);
-    uint32_t svc_id = htonl(header.service_id);
-    uint32_t method_id = htonl(header.method_id);
-    uint32_t payload_size = htonl(header.payload_size);
-    uint32_t seq_id = htonl(header.sequence_id);
-    
-    memcpy(&result[0], &magic, 4);
-    memcpy(&result[4], &msg_id, 4);
-    memcpy(&result[8], &msg_type, 4);
-    memcpy(&result[12], &svc_id, 4);
-    memcpy(&result[16], &method_id, 4);
-    memcpy(&result[20], &payload_size, 4);
-    memcpy(&result[24], &seq_id, 4);
+    const uint32_t fields[7] = {
+        htonl(header.magic_number),
+        htonl(header.message_id),
+        htonl(header.message_type),
+        htonl(header.service_id),
+        htonl(header.method_id),
+        htonl(header.payload_size),
+        htonl(header.sequence_id)
+    };
+    memcpy(out, fields, message_header_size);
+}
+
+// 从原始字节解码消息头
+MessageHeader decode_header(const char* data) {
+    uint32_t fields[7];
+    memcpy(fields, data, message_header_size);
     
+    MessageHeader header;
+    header.magic_number = ntohl(fields[0]);
+    header.message_id = ntohl(fields[1]);
+    header.message_type = ntohl(fields[2]);
+    header.service_id = ntohl(fields[3]);
+    header.method_id = ntohl(fields[4]);
+    header.payload_size = ntohl(fields[5]);
+    header.sequence_id = ntohl(fields[6]);
+    return header;
+}
+
+// 序列化消息头
+std::string serialize_header(const MessageHeader& header) {
+    std::string result(message_header_size, '\0');
+    encode_header(header, &result[0]);
     return result;
 }
 
 // 反序列化消息头
 MessageHeader deserialize_header(const std::string& data) {
-    if (data.size() < 28) {
+    if (data.size() < message_header_size) {
         throw rpc_exception("Invalid header data size");
     }
-    
-    MessageHeader header;
-    
-    uint32_t magic, msg_id, msg_type, svc_id, method_id, payload_size, seq_id;
-    
-    memcpy(&magic, &data[0], 4);
-    memcpy(&msg_id, &data[4], 4);
-    memcpy(&msg_type, &data[8], 4);
-    memcpy(&svc_id, &data[12], 4);
-    memcpy(&method_id, &data[16], 4);
-    memcpy(&payload_size, &data[20], 4);
-    memcpy(&seq_id, &data[24], 4);
-    
-    header.magic_number = ntohl(magic);
-    header.message_id = ntohl(msg_id);
-    header.message_type = ntohl(msg_type);
-    header.service_id = ntohl(svc_id);
-    header.method_id = ntohl(method_id);
-    header.payload_size = ntohl(payload_size);
-    header.sequence_id = ntohl(seq_id);
-    
-    return header;
+    return decode_header(data.data());
 }
 
-// 序列化完整消息
+// 序列化完整消息：一次分配，头部和负载直接写入结果
 std::string serialize_message(const Message& message) {
-    std::string header_data = serialize_header(message.header);
-    return header_data + message.payload;
+    std::string result(message_header_size + message.payload.size(), '\0');
+    encode_header(message.header, &result[0]);
+    memcpy(&result[message_header_size], message.payload.data(), message.payload.size());
+    return result;
+}
+
+// 从缓冲区开头解析一条消息，不复制负载
+bool parse_message(const char* data, size_t size, MessageView& message) {
+    if (size < message_header_size) {
+        return false;
+    }
+    message.header = decode_header(data);
+    if (!validate_header(message.header)) {
+        throw rpc_exception("Invalid message header");
+    }
+    if (size - message_header_size < message.header.payload_size) {
+        return false;
+    }
+    message.payload = std::string_view(data + message_header_size, message.header.payload_size);
+    return true;
 }
 
 // 反序列化完整消息
 Message deserialize_message(const std::string& data) {
-    if (data.size() < 28) {
+    if (data.size() < message_header_size) {
         throw rpc_exception("Invalid message data size");
     }
     
+    MessageView view;
+    if (!parse_message(data.data(), data.size(), view)) {
+        throw rpc_exception("Invalid payload size");
+    }
+    
     Message message;
-    message.header = deserialize_header(data.substr(0, 28));
+    message.header = view.header;
+    message.payload.assign(view.payload.data(), view.payload.size());
+    return message;
+}
+
+namespace {
+
+// 写出iovec数组，阻塞socket也可能部分写出：跳过已写出的部分后继续
+void write_iov(int fd, struct iovec* vec, size_t count) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = vec;
+    msg.msg_iovlen = count;
     
-    if (!validate_header(message.header)) {
-        throw rpc_exception("Invalid message header");
+    while (msg.msg_iovlen > 0) {
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw rpc_exception("Failed to send message");
+        }
+        size_t remaining = static_cast<size_t>(sent);
+        while (msg.msg_iovlen > 0 && remaining >= msg.msg_iov[0].iov_len) {
+            remaining -= msg.msg_iov[0].iov_len;
+            ++msg.msg_iov;
+            --msg.msg_iovlen;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov[0].iov_base = static_cast<char*>(msg.msg_iov[0].iov_base) + remaining;
+            msg.msg_iov[0].iov_len -= remaining;
+        }
     }
+}
+
+} // namespace
+
+// gather写出消息头和负载
+void write_message(int fd, const MessageHeader& header, std::string_view payload) {
+    char header_buffer[message_header_size];
+    encode_header(header, header_buffer);
     
-    if (data.size() < 28 + message.header.payload_size) {
-        throw rpc_exception("Invalid payload size");
+    struct iovec vec[2];
+    vec[0].iov_base = header_buffer;
+    vec[0].iov_len = message_header_size;
+    vec[1].iov_base = const_cast<char*>(payload.data());
+    vec[1].iov_len = payload.size();
+    write_iov(fd, vec, payload.empty() ? 1 : 2);
+}
+
+// 写出已编码的消息
+void write_frames(int fd, std::string_view frames) {
+    struct iovec vec;
+    vec.iov_base = const_cast<char*>(frames.data());
+    vec.iov_len = frames.size();
+    write_iov(fd, &vec, 1);
+}
+
+// 追加一条编码后的消息
+void append_message(std::string& out, const MessageHeader& header, std::string_view payload) {
+    size_t offset = out.size();
+    out.resize(offset + message_header_size);
+    encode_header(header, &out[offset]);
+    out.append(payload.data(), payload.size());
+}
+
+// 检查批量帧负载
+bool validate_batch(std::string_view frames, uint32_t count) {
+    size_t pos = 0;
+    uint32_t entries = 0;
+    MessageView entry;
+    try {
+        while (pos < frames.size()) {
+            // 条目不能是批量帧，也不能单独压缩（压缩只作用于整个帧）
+            if (!parse_message(frames.data() + pos, frames.size() - pos, entry) ||
+                entry.header.message_type == static_cast<uint32_t>(MessageType::BATCH) ||
+                (entry.header.message_type & ~message_type_mask) != 0) {
+                return false;
+            }
+            pos += message_header_size + entry.payload.size();
+            ++entries;
+        }
+    } catch (const rpc_exception&) {
+        return false;
     }
-    
-    message.payload = data.substr(28, message.header.payload_size);
-    return message;
+    return entries == count;
 }
 
 // 创建请求消息
 Message create_request_message(uint32_t service_id, uint32_t method_id, 
-                             uint32_t message_id, const std::string& payload) {
+                             uint32_t message_id, std::string payload) {
     Message message;
     message.header.magic_number = 0x52504346; // "RPCF"
     message.header.message_id = message_id;
@@ -98,14 +190,14 @@ Message create_request_message(uint32_t service_id, uint32_t method_id,
     message.header.method_id = method_id;
     message.header.payload_size = payload.size();
     message.header.sequence_id = 0;
-    message.payload = payload;
+    message.payload = std::move(payload);
     
     return message;
 }
 
 // 创建响应消息
 Message create_response_message(uint32_t service_id, uint32_t method_id,
-                              uint32_t message_id, const std::string& payload) {
+                              uint32_t message_id, std::string payload) {
     Message message;
     message.header.magic_number = 0x52504346; // "RPCF"
     message.header.message_id = message_id;
@@ -114,14 +206,14 @@ Message create_response_message(uint32_t service_id, uint32_t method_id,
     message.header.method_id = method_id;
     message.header.payload_size = payload.size();
     message.header.sequence_id = 0;
-    message.payload = payload;
+    message.payload = std::move(payload);
     
     return message;
 }
 
 // 创建错误消息
 Message create_error_message(uint32_t service_id, uint32_t method_id,
-                           uint32_t message_id, const std::string& error_msg) {
+                           uint32_t message_id, std::string error_msg) {
     Message message;
     message.header.magic_number = 0x52504346; // "RPCF"
     message.header.message_id = message_id;
@@ -130,7 +222,7 @@ Message create_error_message(uint32_t service_id, uint32_t method_id,
     message.header.method_id = method_id;
     message.header.payload_size = error_msg.size();
     message.header.sequence_id = 0;
-    message.payload = error_msg;
+    message.payload = std::move(error_msg);
     
     return message;
 }
@@ -150,6 +242,36 @@ Message create_heartbeat_message(uint32_t message_id) {
     return message;
 }
 
+// 创建能力协商消息
+Message create_hello_message(uint32_t message_id, uint32_t capabilities) {
+    Message message;
+    message.header.magic_number = 0x52504346; // "RPCF"
+    message.header.message_id = message_id;
+    message.header.message_type = static_cast<uint32_t>(MessageType::HELLO);
+    message.header.service_id = 0;
+    message.header.method_id = 0;
+    message.payload = encode_value(capabilities);
+    message.header.payload_size = message.payload.size();
+    message.header.sequence_id = 0;
+    
+    return message;
+}
+
+// 创建批量消息
+Message create_batch_message(std::string frames, uint32_t count) {
+    Message message;
+    message.header.magic_number = 0x52504346; // "RPCF"
+    message.header.message_id = 0;
+    message.header.message_type = static_cast<uint32_t>(MessageType::BATCH);
+    message.header.service_id = 0;
+    message.header.method_id = 0;
+    message.header.payload_size = frames.size();
+    message.header.sequence_id = count;
+    message.payload = std::move(frames);
+    
+    return message;
+}
+
 // 生成消息ID
 uint32_t generate_message_id() {
     static std::atomic<uint32_t> next_id(1);
@@ -168,6 +290,8 @@ std::string get_message_type_string(MessageType type) {
         case MessageType::RESPONSE: return "RESPONSE";
         case MessageType::ERROR: return "ERROR";
         case MessageType::HEARTBEAT: return "HEARTBEAT";
+        case MessageType::BATCH: return "BATCH";
+        case MessageType::HELLO: return "HELLO";
         default: return "UNKNOWN";
     }
 }
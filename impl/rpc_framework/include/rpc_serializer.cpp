@@ -210,12 +210,12 @@ std::pair<std::string, uint16_t> LoadBalancer::select_server() {
 void LoadBalancer::update_connections(const std::string& address, uint16_t port, int delta) {
     std::lock_guard<std::mutex> lock(balancer_mutex_);
     
-    std::string key = address + ":" + std::to_string(port);
-    connections_[key] += delta;
-    
-    if (connections_[key] < 0) {
-        connections_[key] = 0;
+    // 服务器移除后仍在进行的调用结束时也会报告，不能因此重新插入计数
+    auto it = connections_.find(address + ":" + std::to_string(port));
+    if (it == connections_.end()) {
+        return;
     }
+    it->second = std::max(it->second + delta, 0);
 }
 
 std::pair<std::string, uint16_t> LoadBalancer::select_round_robin() {
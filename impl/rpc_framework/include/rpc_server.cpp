@@ -1,24 +1,105 @@
 #include "rpc_framework.hpp"
+#include "rpc_codec.hpp"
+#include "rpc_compress.hpp"
+#include "epoll_event_loop.hpp"
+#include "tcp_connection.hpp"
+#include "thread_pool.hpp"
+#include <netinet/tcp.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
 #include <iostream>
 #include <sstream>
 #include <thread>
-#include <vector>
-#include <algorithm>
 
 namespace rpc {
 
 // 声明network_utils命名空间
 namespace network_utils {
-    void set_socket_reuseaddr(int socket_fd);
     void close_socket(int socket_fd);
 }
 
-RpcServer::RpcServer(uint16_t port)
+namespace {
+
+/**
+ * @brief 在循环线程上写出一条消息：头部编码到栈上，负载直接追加到连接的输出缓冲区
+ *
+ * 两次send只是追加，本批事件结束时合并为一次writev，不再先拼接成完整的消息字符串。
+ */
+void send_message_to(const std::shared_ptr<impl::TcpConnection>& conn, const MessageHeader& header,
+                     std::string_view payload) {
+    char header_buffer[message_header_size];
+    encode_header(header, header_buffer);
+    conn->send(header_buffer, message_header_size);
+    conn->send(payload.data(), payload.size());
+}
+
+void send_message_to(const std::shared_ptr<impl::TcpConnection>& conn, const Message& message) {
+    send_message_to(conn, message.header, message.payload);
+}
+
+} // namespace
+
+/**
+ * @brief 同一连接上等待处理的请求
+ *
+ * 只在循环线程上访问。in_flight为已交给线程池、尚未写回响应的请求数；
+ * compress表示HELLO协商后响应可以压缩。
+ */
+struct RpcServer::ConnectionContext {
+    std::deque<Request> pending;
+    size_t in_flight = 0;
+    bool paused = false;
+    bool compress = false;
+};
+
+/**
+ * @brief 监听socket的事件处理器，每次可读时接受全部排队的连接
+ */
+class RpcServer::Acceptor : public impl::EventHandler {
+public:
+    explicit Acceptor(RpcServer& server) : server_(server) {}
+    
+    void handle_event(int fd, uint32_t events) override {
+        (void)events;
+        while (true) {
+            int client_fd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client_fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    std::cerr << "Failed to accept client connection: " << strerror(errno) << std::endl;
+                }
+                return;
+            }
+            server_.on_connection(client_fd);
+        }
+    }
+    
+    void handle_error(int fd, const std::string& error) override {
+        std::cerr << "Listen socket " << fd << " error: " << error << std::endl;
+    }
+    
+private:
+    RpcServer& server_;
+};
+
+RpcServer::RpcServer(uint16_t port, size_t worker_threads, size_t max_queue_size,
+                     size_t max_in_flight_per_connection)
     : port_(port)
     , server_fd_(-1)
     , running_(false)
+    , worker_thread_count_(worker_threads)
+    , max_queue_size_(max_queue_size)
+    , max_in_flight_(std::max<size_t>(1, max_in_flight_per_connection))
+    , compression_threshold_(0)
     , total_calls_(0)
-    , failed_calls_(0) {
+    , failed_calls_(0)
+    , active_connections_(0) {
+    std::lock_guard<std::mutex> lock(services_mutex_);
+    publish_dispatch_table();
 }
 
 RpcServer::~RpcServer() {
@@ -30,16 +111,25 @@ void RpcServer::register_service(std::shared_ptr<Service> service) {
         throw rpc_exception("Invalid service pointer");
     }
     
-    std::lock_guard<std::mutex> lock(services_mutex_);
-    uint32_t service_id = service->get_service_id();
+    auto entry = std::make_shared<ServiceEntry>();
+    entry->name = service->get_service_name();
+    entry->service = service;
+    add_service(service->get_service_id(), std::move(entry));
+}
+
+void RpcServer::add_service(uint32_t service_id, std::shared_ptr<const ServiceEntry> entry) {
+    if (service_id > max_service_id) {
+        throw rpc_exception("Service ID out of range: " + std::to_string(service_id));
+    }
     
+    std::lock_guard<std::mutex> lock(services_mutex_);
     if (services_.find(service_id) != services_.end()) {
         throw rpc_exception("Service ID already registered: " + std::to_string(service_id));
     }
     
-    services_[service_id] = service;
-    std::cout << "Service registered: " << service->get_service_name() 
-              << " (ID: " << service_id << ")" << std::endl;
+    std::cout << "Service registered: " << entry->name << " (ID: " << service_id << ")" << std::endl;
+    services_[service_id] = std::move(entry);
+    publish_dispatch_table();
 }
 
 void RpcServer::unregister_service(uint32_t service_id) {
@@ -47,10 +137,24 @@ void RpcServer::unregister_service(uint32_t service_id) {
     
     auto it = services_.find(service_id);
     if (it != services_.end()) {
-        std::cout << "Service unregistered: " << it->second->get_service_name() 
+        std::cout << "Service unregistered: " << it->second->name 
                   << " (ID: " << service_id << ")" << std::endl;
         services_.erase(it);
+        publish_dispatch_table();
+    }
+}
+
+void RpcServer::publish_dispatch_table() {
+    // 调用者持有services_mutex_。新表构建完成后整体发布，
+    // 正在执行的请求持有旧表的引用，旧表（及其中已注销的服务）随最后一个引用释放
+    auto table = std::make_shared<DispatchTable>();
+    if (!services_.empty()) {
+        table->services.resize(services_.rbegin()->first + 1);
+        for (const auto& [service_id, entry] : services_) {
+            table->services[service_id] = entry;
+        }
     }
+    std::atomic_store(&dispatch_table_, std::shared_ptr<const DispatchTable>(std::move(table)));
 }
 
 void RpcServer::start() {
@@ -58,38 +162,24 @@ void RpcServer::start() {
         return;
     }
     
-    // 创建服务器socket
-    server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd_ < 0) {
-        throw rpc_exception("Failed to create server socket");
-    }
-    
-    // 设置socket选项
-    network_utils::set_socket_reuseaddr(server_fd_);
-    
-    // 绑定地址
-    struct sockaddr_in server_addr;
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(port_);
-    
-    if (bind(server_fd_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        close(server_fd_);
-        throw rpc_exception("Failed to bind server socket");
+    // 创建非阻塞监听socket，端口为0时取内核分配的端口
+    try {
+        server_fd_ = impl::EpollEventLoop::create_listen_socket(port_, 4096, false);
+        port_ = static_cast<uint16_t>(impl::EpollEventLoop::get_local_port(server_fd_));
+    } catch (const std::exception& e) {
+        server_fd_ = -1;
+        throw rpc_exception(std::string("Failed to listen on server socket: ") + e.what());
     }
     
-    // 开始监听
-    if (listen(server_fd_, 128) < 0) {
-        close(server_fd_);
-        throw rpc_exception("Failed to listen on server socket");
-    }
+    loop_.reset(new impl::EpollEventLoop());
+    workers_.reset(new impl::thread_pool(worker_thread_count_, max_queue_size_));
+    loop_->add_fd(server_fd_, EPOLLIN, std::make_shared<Acceptor>(*this));
     
     running_ = true;
+    loop_thread_ = std::thread([this]() {
+        loop_->run();
+    });
     std::cout << "RPC Server started on port " << port_ << std::endl;
-    
-    // 启动接受连接线程
-    std::thread accept_thread(&RpcServer::accept_connections, this);
-    accept_thread.detach();
 }
 
 void RpcServer::stop() {
@@ -99,19 +189,23 @@ void RpcServer::stop() {
     
     running_ = false;
     
-    // 关闭服务器socket
-    if (server_fd_ >= 0) {
-        close(server_fd_);
-        server_fd_ = -1;
+    // 先等线程池执行完已接收的请求，它们的响应仍需要循环线程写出
+    workers_->shutdown(true);
+    
+    loop_->stop();
+    if (loop_thread_.joinable()) {
+        loop_thread_.join();
     }
     
-    // 等待工作线程结束
-    for (auto& thread : worker_threads_) {
-        if (thread.joinable()) {
-            thread.join();
-        }
+    // 事件循环析构时释放所有连接，连接析构时关闭各自的fd
+    loop_.reset();
+    workers_.reset();
+    active_connections_ = 0;
+    
+    if (server_fd_ >= 0) {
+        network_utils::close_socket(server_fd_);
+        server_fd_ = -1;
     }
-    worker_threads_.clear();
     
     std::cout << "RPC Server stopped" << std::endl;
 }
@@ -120,123 +214,211 @@ bool RpcServer::is_running() const {
     return running_;
 }
 
-void RpcServer::accept_connections() {
-    while (running_) {
-        try {
-            struct sockaddr_in client_addr;
-            socklen_t client_len = sizeof(client_addr);
-            
-            int client_fd = accept(server_fd_, (struct sockaddr*)&client_addr, &client_len);
-            if (client_fd < 0) {
-                if (running_) {
-                    std::cerr << "Failed to accept client connection" << std::endl;
+void RpcServer::on_connection(int client_fd) {
+    int one = 1;
+    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    
+    auto conn = impl::TcpConnection::create(*loop_, client_fd);
+    conn->set_context(std::make_shared<ConnectionContext>());
+    conn->set_message_callback([this](const ConnectionPtr& c, impl::RingBuffer& input) {
+        on_message(c, input);
+    });
+    conn->set_close_callback([this](const ConnectionPtr& c) {
+        c->context<ConnectionContext>()->pending.clear();
+        active_connections_--;
+    });
+    active_connections_++;
+    conn->start();
+}
+
+void RpcServer::on_message(const ConnectionPtr& conn, impl::RingBuffer& input) {
+    auto context = conn->context<ConnectionContext>();
+    
+    // 输入缓冲区中可能有多条完整消息，也可能只有半条，不完整的部分留到下次可读
+    while (input.readable_bytes() >= message_header_size) {
+        // 头部在栈上解码；负载从环形缓冲区复制一次到池化缓冲区，不经过malloc也不清零
+        char header_buffer[message_header_size];
+        input.copy_out(header_buffer, message_header_size);
+        MessageHeader header = decode_header(header_buffer);
+        
+        if (!validate_header(header) || header.payload_size > max_payload_size) {
+            std::cerr << "Invalid message header from fd " << conn->fd() << ", closing connection" << std::endl;
+            conn->force_close();
+            return;
+        }
+        if (input.readable_bytes() < message_header_size + header.payload_size) {
+            break;
+        }
+        
+        input.retrieve(message_header_size);
+        Request request;
+        request.header = header;
+        request.payload = buffer_pool_.allocate(header.payload_size);
+        if (header.payload_size > 0) {
+            input.copy_out(request.payload.data(), header.payload_size);
+            input.retrieve(header.payload_size);
+        }
+        
+        // 压缩的负载解压到另一个池化缓冲区，之后的处理只看到原始负载
+        if (header.message_type & message_flag_compressed) {
+            try {
+                uint32_t original = compressed_payload_size(request.payload.view());
+                if (original > max_payload_size) {
+                    throw rpc_exception("Decompressed payload too large");
                 }
-                continue;
+                PayloadBuffer decompressed = buffer_pool_.allocate(original);
+                decompress_payload(request.payload.view(), decompressed.data());
+                request.payload = std::move(decompressed);
+                request.header.message_type &= ~message_flag_compressed;
+                request.header.payload_size = original;
+            } catch (const rpc_exception& e) {
+                std::cerr << "Invalid compressed payload from fd " << conn->fd() << ": " << e.what()
+                          << ", closing connection" << std::endl;
+                conn->force_close();
+                return;
             }
-            
-            // 启动客户端处理线程
-            worker_threads_.emplace_back(&RpcServer::handle_client, this, client_fd);
-            
-            // 分离线程，让它独立运行
-            worker_threads_.back().detach();
-            
-            // 清理已完成的线程
-            worker_threads_.erase(
-                std::remove_if(worker_threads_.begin(), worker_threads_.end(),
-                    [](const std::thread& t) { return !t.joinable(); }),
-                worker_threads_.end()
-            );
-            
-        } catch (const std::exception& e) {
-            std::cerr << "Error accepting connection: " << e.what() << std::endl;
         }
-    }
-}
-
-void RpcServer::handle_client(int client_fd) {
-    try {
-        while (running_) {
-            // 接收消息
-            Message request = receive_message(client_fd);
-            
-            // 处理请求
-            Message response = process_request(request);
-            
-            // 发送响应
-            send_message(client_fd, response);
+        
+        // 能力协商在循环线程上直接回复：回复双方都支持的能力
+        if (request.header.message_type == static_cast<uint32_t>(MessageType::HELLO)) {
+            uint32_t requested = 0;
+            try {
+                requested = decode_value<uint32_t>(request.payload.view());
+            } catch (const rpc_exception&) {
+            }
+            uint32_t supported = compression_threshold_ > 0 ? capability_compression : 0;
+            uint32_t accepted = requested & supported;
+            context->compress = (accepted & capability_compression) != 0;
+            send_message_to(conn, create_hello_message(request.header.message_id, accepted));
+            continue;
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Error handling client: " << e.what() << std::endl;
+        
+        // 批量帧整体作为一个请求排队，条目在入队前检查完整，工作线程上无需再处理格式错误
+        if (request.header.message_type == static_cast<uint32_t>(MessageType::BATCH) &&
+            !validate_batch(request.payload.view(), request.header.sequence_id)) {
+            std::cerr << "Invalid batch frame from fd " << conn->fd() << ", closing connection" << std::endl;
+            conn->force_close();
+            return;
+        }
+        context->pending.push_back(std::move(request));
     }
     
-    // 关闭客户端连接
-    close(client_fd);
+    if (context->pending.size() >= max_pending_requests && !context->paused) {
+        context->paused = true;
+        conn->pause_reading();
+    }
+    dispatch_next(conn);
 }
 
-Message RpcServer::receive_message(int client_fd) {
-    // 读取消息头
-    char header_buffer[28];
-    ssize_t bytes_received = recv(client_fd, header_buffer, 28, MSG_WAITALL);
+void RpcServer::dispatch_next(const ConnectionPtr& conn) {
+    auto context = conn->context<ConnectionContext>();
     
-    if (bytes_received < 0) {
-        throw rpc_exception("Failed to receive message header");
+    // 积压的请求在并发上限内全部交给线程池，慢请求不阻塞同一连接上后面的请求
+    while (context->in_flight < max_in_flight_ && !context->pending.empty() && conn->connected()) {
+        Request request = std::move(context->pending.front());
+        context->pending.pop_front();
+        if (context->paused && context->pending.size() < max_pending_requests / 2) {
+            context->paused = false;
+            conn->resume_reading();
+        }
+        
+        context->in_flight++;
+        try {
+            // 按值捕获只增加负载的引用计数，提交失败时仍可用request回复错误
+            bool compress = context->compress;
+            workers_->execute([this, conn, request, compress]() mutable {
+                Message response = request.header.message_type == static_cast<uint32_t>(MessageType::BATCH) ?
+                    process_batch(request) : process_request(request);
+                // 负载缓冲区立即回到池中（服务保留了副本时由最后一个引用归还）
+                request.payload.reset();
+                
+                // 压缩在工作线程上进行，结果写入池化缓冲区
+                PayloadBuffer compressed;
+                if (compress) {
+                    compressed = compress_message(response.header, response.payload);
+                }
+                
+                // 在循环线程上按完成顺序写出响应，客户端按message_id匹配，腾出的名额交给下一个请求
+                loop_->queue_in_loop([this, conn, response = std::move(response), compressed = std::move(compressed)]() {
+                    send_message_to(conn, response.header,
+                                    compressed.empty() ? std::string_view(response.payload) : compressed.view());
+                    conn->context<ConnectionContext>()->in_flight--;
+                    dispatch_next(conn);
+                });
+            });
+        } catch (const impl::thread_pool_exception& e) {
+            // 线程池队列已满或已停止：直接返回错误，不阻塞循环线程，剩余的请求留到下一轮
+            context->in_flight--;
+            send_message_to(conn, reject_request(request, std::string("Server busy: ") + e.what()));
+            loop_->queue_in_loop([this, conn]() {
+                dispatch_next(conn);
+            });
+            return;
+        }
     }
-    
-    if (bytes_received == 0) {
-        throw rpc_exception("Client disconnected");
+}
+
+PayloadBuffer RpcServer::compress_message(MessageHeader& header, std::string_view payload) {
+    if (payload.size() < compression_threshold_) {
+        return PayloadBuffer();
     }
-    
-    if (bytes_received != 28) {
-        throw rpc_exception("Incomplete message header received");
+    PayloadBuffer compressed = buffer_pool_.allocate(compressed_payload_bound(payload.size()));
+    size_t size = compress_payload(payload, compressed.data(), compressed.size());
+    if (size == 0) {
+        return PayloadBuffer();
     }
-    
-    // 反序列化消息头
-    std::string header_data(header_buffer, 28);
-    MessageHeader header = deserialize_header(header_data);
-    
-    if (!validate_header(header)) {
-        throw rpc_exception("Invalid message header");
+    header.message_type |= message_flag_compressed;
+    header.payload_size = static_cast<uint32_t>(size);
+    return compressed.slice(0, size);
+}
+
+void RpcServer::enable_compression(size_t threshold) {
+    if (running_) {
+        throw rpc_exception("Compression must be enabled before the server starts");
     }
-    
-    // 读取消息负载
-    std::string payload;
-    if (header.payload_size > 0) {
-        payload.resize(header.payload_size);
-        bytes_received = recv(client_fd, &payload[0], header.payload_size, MSG_WAITALL);
-        
-        if (bytes_received < 0) {
-            throw rpc_exception("Failed to receive message payload");
-        }
-        
-        if (static_cast<size_t>(bytes_received) != header.payload_size) {
-            throw rpc_exception("Incomplete message payload received");
-        }
+    compression_threshold_ = std::max<size_t>(1, threshold);
+}
+
+Message RpcServer::process_batch(const Request& batch) {
+    // 条目依次处理，响应按请求顺序拼成一个批量帧；条目的负载是批量缓冲区的切片，不复制
+    std::string_view frames = batch.payload.view();
+    std::string responses;
+    size_t pos = 0;
+    MessageView entry;
+    while (pos < frames.size() && parse_message(frames.data() + pos, frames.size() - pos, entry)) {
+        Request request;
+        request.header = entry.header;
+        request.payload = batch.payload.slice(pos + message_header_size, entry.payload.size());
+        Message response = process_request(request);
+        append_message(responses, response.header, response.payload);
+        pos += message_header_size + entry.payload.size();
     }
-    
-    // 构造消息
-    Message message;
-    message.header = header;
-    message.payload = payload;
-    
-    return message;
+    return create_batch_message(std::move(responses), batch.header.sequence_id);
 }
 
-void RpcServer::send_message(int client_fd, const Message& message) {
-    // 序列化消息
-    std::string serialized_message = serialize_message(message);
-    
-    // 发送消息
-    ssize_t bytes_sent = send(client_fd, serialized_message.c_str(), serialized_message.size(), 0);
-    if (bytes_sent < 0) {
-        throw rpc_exception("Failed to send message");
+Message RpcServer::reject_request(const Request& request, const std::string& reason) {
+    if (request.header.message_type != static_cast<uint32_t>(MessageType::BATCH)) {
+        failed_calls_++;
+        return create_error_message(request.header.service_id, request.header.method_id,
+                                    request.header.message_id, reason);
     }
     
-    if (static_cast<size_t>(bytes_sent) != serialized_message.size()) {
-        throw rpc_exception("Failed to send complete message");
+    // 批量帧的每个条目各自回复错误，客户端的每个调用都能结束
+    std::string_view frames = request.payload.view();
+    std::string responses;
+    size_t pos = 0;
+    MessageView entry;
+    while (pos < frames.size() && parse_message(frames.data() + pos, frames.size() - pos, entry)) {
+        failed_calls_++;
+        Message error = create_error_message(entry.header.service_id, entry.header.method_id,
+                                             entry.header.message_id, reason);
+        append_message(responses, error.header, error.payload);
+        pos += message_header_size + entry.payload.size();
     }
+    return create_batch_message(std::move(responses), request.header.sequence_id);
 }
 
-Message RpcServer::process_request(const Message& request) {
+Message RpcServer::process_request(const Request& request) {
     total_calls_++;
     
     try {
@@ -245,26 +427,32 @@ Message RpcServer::process_request(const Message& request) {
             throw rpc_exception("Invalid message type");
         }
         
-        // 查找服务
-        std::shared_ptr<Service> service;
-        {
-            std::lock_guard<std::mutex> lock(services_mutex_);
-            auto it = services_.find(request.header.service_id);
-            if (it == services_.end()) {
-                throw rpc_exception("Service not found: " + std::to_string(request.header.service_id));
-            }
-            service = it->second;
+        // 按下标查分派表，持有表的引用直到调用结束，期间注销的服务不会被释放
+        std::shared_ptr<const DispatchTable> table = std::atomic_load(&dispatch_table_);
+        uint32_t service_id = request.header.service_id;
+        uint32_t method_id = request.header.method_id;
+        const ServiceEntry* service = service_id < table->services.size() ?
+            table->services[service_id].get() : nullptr;
+        if (!service) {
+            throw rpc_exception("Service not found: " + std::to_string(service_id));
         }
         
-        // 调用服务方法
-        std::string result = service->call_method(request.header.method_id, request.payload);
+        // 类型化方法直接调用生成的入口，其余交给Service接口
+        std::string result;
+        if (method_id < service->methods.size() && service->methods[method_id]) {
+            result = service->methods[method_id](service->instance.get(), request.payload);
+        } else if (service->service) {
+            result = service->service->handle_call(method_id, request.payload);
+        } else {
+            throw rpc_exception("Method not found: " + std::to_string(method_id));
+        }
         
         // 创建响应消息
         return create_response_message(
             request.header.service_id,
             request.header.method_id,
             request.header.message_id,
-            result
+            std::move(result)
         );
         
     } catch (const std::exception& e) {
@@ -286,8 +474,10 @@ std::string RpcServer::get_stats() const {
        << "  Port: " << port_ << "\n"
        << "  Running: " << (running_ ? "Yes" : "No") << "\n"
        << "  Services: " << services_.size() << "\n"
+       << "  Connections: " << active_connections_.load() << "\n"
        << "  Total Calls: " << total_calls_.load() << "\n"
        << "  Failed Calls: " << failed_calls_.load() << "\n"
+       << "  Buffer Pool Hits/Misses: " << buffer_pool_.pool_hits() << "/" << buffer_pool_.pool_misses() << "\n"
        << "  Success Rate: " 
        << (total_calls_.load() > 0 ? 
            (100.0 * (total_calls_.load() - failed_calls_.load()) / total_calls_.load()) : 100.0)
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "rpc_framework.hpp"
+#include "rpc_codec.hpp"
+#include <tuple>
+#include <type_traits>
+
+namespace rpc {
+
+namespace detail {
+
+/**
+ * @brief 为一个成员函数签名生成调用入口
+ */
+template<typename R, typename... A>
+struct MethodInvokerFor {
+    template<typename Impl, auto Method>
+    static std::string invoke(void* instance, const PayloadBuffer& data) {
+        ByteReader reader(data.view());
+        auto args = decode_args<std::decay_t<A>...>(reader);
+        if (reader.remaining() != 0) {
+            throw rpc_exception("Trailing bytes after RPC arguments");
+        }
+
+        // 先转换回注册时的实现类型，成员函数属于基类时再由编译器调整指针
+        Impl* object = static_cast<Impl*>(instance);
+        auto call = [object](auto&&... values) -> R {
+            return (object->*Method)(std::forward<decltype(values)>(values)...);
+        };
+        if constexpr (std::is_void_v<R>) {
+            std::apply(call, std::move(args));
+            return std::string();
+        } else {
+            return encode_value(std::apply(call, std::move(args)));
+        }
+    }
+};
+
+template<typename T>
+struct method_traits;
+
+template<typename C, typename R, typename... A>
+struct method_traits<R (C::*)(A...)> {
+    using class_type = C;
+    using invoker = MethodInvokerFor<R, A...>;
+};
+
+template<typename C, typename R, typename... A>
+struct method_traits<R (C::*)(A...) const> {
+    using class_type = C;
+    using invoker = MethodInvokerFor<R, A...>;
+};
+
+} // namespace detail
+
+template<typename Impl>
+TypedService<Impl>::TypedService(uint32_t service_id, std::string service_name, std::shared_ptr<Impl> impl)
+    : service_id_(service_id)
+    , service_name_(std::move(service_name))
+    , impl_(std::move(impl)) {
+    if (!impl_) {
+        throw rpc_exception("Invalid service implementation");
+    }
+}
+
+template<typename Impl>
+template<auto Method>
+TypedService<Impl>& TypedService<Impl>::bind(uint32_t method_id) {
+    using traits = detail::method_traits<decltype(Method)>;
+    static_assert(std::is_base_of_v<typename traits::class_type, Impl>,
+                  "Bound method must belong to the service implementation");
+
+    if (method_id > RpcServer::max_method_id) {
+        throw rpc_exception("Method ID out of range: " + std::to_string(method_id));
+    }
+    for (const auto& method : methods_) {
+        if (method.first == method_id) {
+            throw rpc_exception("Method ID already bound: " + std::to_string(method_id));
+        }
+    }
+    methods_.emplace_back(method_id, &traits::invoker::template invoke<Impl, Method>);
+    return *this;
+}
+
+template<typename Impl>
+void RpcServer::register_service(const TypedService<Impl>& service) {
+    auto entry = std::make_shared<ServiceEntry>();
+    entry->name = service.get_service_name();
+    // 实现对象以void*传给调用入口，入口内再转换回Impl*
+    entry->instance = service.impl();
+    for (const auto& [method_id, invoker] : service.methods()) {
+        if (entry->methods.size() <= method_id) {
+            entry->methods.resize(method_id + 1);
+        }
+        entry->methods[method_id] = invoker;
+    }
+    add_service(service.get_service_id(), std::move(entry));
+}
+
+} // namespace rpc
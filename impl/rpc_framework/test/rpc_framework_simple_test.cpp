@@ -4,7 +4,17 @@
 #include <vector>
 #include <map>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <random>
+#include <thread>
+#include <dirent.h>
 #include "rpc_framework.hpp"
+#include "rpc_codec.hpp"
+#include "rpc_compress.hpp"
 
 using namespace rpc;
 
@@ -244,6 +254,987 @@ TEST_F(RpcFrameworkSimpleTest, ExceptionHandling) {
     EXPECT_THROW(deserialize_message(invalid_header), rpc_exception);
 }
 
+// 二进制编码测试
+TEST_F(RpcFrameworkSimpleTest, BinaryCodecRoundTrip) {
+    ByteWriter writer;
+    encode_args(writer, 0, -1, 300, std::numeric_limits<int64_t>::min(), std::numeric_limits<uint64_t>::max(),
+                true, 3.5f, -2.25, std::string("a\0b", 3), "literal",
+                std::vector<int>{1, -2, 3}, std::map<std::string, double>{{"x", 1.5}, {"y", -0.5}});
+    
+    ByteReader reader(writer.buffer());
+    auto values = decode_args<int, int, int, int64_t, uint64_t, bool, float, double, std::string, std::string,
+                              std::vector<int>, std::map<std::string, double>>(reader);
+    EXPECT_EQ(reader.remaining(), 0u);
+    EXPECT_EQ(std::get<0>(values), 0);
+    EXPECT_EQ(std::get<1>(values), -1);
+    EXPECT_EQ(std::get<2>(values), 300);
+    EXPECT_EQ(std::get<3>(values), std::numeric_limits<int64_t>::min());
+    EXPECT_EQ(std::get<4>(values), std::numeric_limits<uint64_t>::max());
+    EXPECT_TRUE(std::get<5>(values));
+    EXPECT_EQ(std::get<6>(values), 3.5f);
+    EXPECT_EQ(std::get<7>(values), -2.25);
+    EXPECT_EQ(std::get<8>(values), std::string("a\0b", 3));
+    EXPECT_EQ(std::get<9>(values), "literal");
+    EXPECT_EQ(std::get<10>(values), (std::vector<int>{1, -2, 3}));
+    EXPECT_EQ(std::get<11>(values), (std::map<std::string, double>{{"x", 1.5}, {"y", -0.5}}));
+}
+
+TEST_F(RpcFrameworkSimpleTest, BinaryCodecIsCompactAndReusable) {
+    // 小整数（含小负数）只占1字节，300占2字节，double固定8字节
+    EXPECT_EQ(encode_value(42).size(), 1u);
+    EXPECT_EQ(encode_value(-42).size(), 1u);
+    EXPECT_EQ(encode_value(300).size(), 2u);
+    EXPECT_EQ(encode_value(3.14).size(), 8u);
+    EXPECT_EQ(encode_value(std::string("hello")).size(), 6u);
+    
+    // 多字节整数按小端顺序写出
+    ByteWriter fixed;
+    fixed.write_fixed32(0x01020304);
+    EXPECT_EQ(fixed.buffer(), std::string("\x04\x03\x02\x01", 4));
+    
+    // clear()保留容量，重复编码不再扩容
+    ByteWriter writer;
+    encode_args(writer, std::string(1000, 'x'), 1, 2);
+    size_t capacity = writer.buffer().capacity();
+    for (int i = 0; i < 100; ++i) {
+        writer.clear();
+        encode_args(writer, std::string(1000, 'y'), i, i);
+        EXPECT_EQ(writer.buffer().capacity(), capacity);
+    }
+    
+    // 截断、多余字节和超长长度前缀都被拒绝
+    std::string encoded = encode_value(std::string("hello"));
+    EXPECT_THROW(decode_value<std::string>(encoded.substr(0, 3)), rpc_exception);
+    EXPECT_THROW(decode_value<int>(encode_value(1) + "x"), rpc_exception);
+    EXPECT_THROW(decode_value<std::vector<int>>(encode_value(uint64_t(1) << 40)), rpc_exception);
+    EXPECT_THROW(decode_value<int>(std::string(11, '\x80')), rpc_exception);
+}
+
+// 视图解析测试：负载指向原缓冲区，不完整的帧返回false
+TEST_F(RpcFrameworkSimpleTest, ParseMessageView) {
+    std::string buffer = serialize_message(create_request_message(1, 2, 3, "hello"));
+    buffer += serialize_message(create_response_message(1, 2, 4, std::string(100, 'x')));
+    
+    MessageView view;
+    ASSERT_TRUE(parse_message(buffer.data(), buffer.size(), view));
+    EXPECT_EQ(view.header.message_id, 3u);
+    EXPECT_EQ(view.payload, "hello");
+    EXPECT_EQ(view.payload.data(), buffer.data() + message_header_size);
+    
+    size_t second = message_header_size + view.payload.size();
+    ASSERT_TRUE(parse_message(buffer.data() + second, buffer.size() - second, view));
+    EXPECT_EQ(view.header.message_id, 4u);
+    EXPECT_EQ(view.payload.size(), 100u);
+    
+    // 头部不完整或负载不完整都等待更多数据
+    EXPECT_FALSE(parse_message(buffer.data(), message_header_size - 1, view));
+    EXPECT_FALSE(parse_message(buffer.data() + second, buffer.size() - second - 1, view));
+    
+    // 魔数错误的帧无法恢复
+    std::string bad = buffer;
+    bad[0] = 0;
+    EXPECT_THROW(parse_message(bad.data(), bad.size(), view), rpc_exception);
+    
+    // 编码到外部缓冲区的头部与serialize_header一致
+    char header[message_header_size];
+    encode_header(view.header, header);
+    EXPECT_EQ(std::string(header, message_header_size), serialize_header(view.header));
+}
+
+// 缓冲区池测试：同级复用、引用计数、超大块不入池、缓冲区比池活得更久
+TEST_F(RpcFrameworkSimpleTest, BufferPoolReusesSizeClasses) {
+    auto pool = std::make_unique<BufferPool>();
+    
+    PayloadBuffer a = pool->allocate(100);
+    EXPECT_EQ(a.size(), 100u);
+    EXPECT_EQ(a.capacity(), 128u);
+    const char* block = a.data();
+    
+    PayloadBuffer copy = a;
+    EXPECT_EQ(a.use_count(), 2u);
+    a.reset();
+    EXPECT_EQ(pool->cached_blocks(), 0u);
+    copy.reset();
+    EXPECT_EQ(pool->cached_blocks(), 1u);
+    
+    // 同一级的分配取回刚归还的块
+    PayloadBuffer b = pool->allocate(120);
+    EXPECT_EQ(b.data(), block);
+    EXPECT_EQ(pool->pool_hits(), 1u);
+    EXPECT_EQ(pool->allocate(0).data(), nullptr);
+    
+    PayloadBuffer large = pool->allocate(BufferPool::max_pooled_size + 1);
+    large.reset();
+    EXPECT_EQ(pool->cached_blocks(), 0u);
+    
+    // 在其他线程释放，块同样回到池中
+    std::thread([moved = std::move(b)]() mutable { moved.reset(); }).join();
+    EXPECT_EQ(pool->cached_blocks(), 1u);
+    
+    PayloadBuffer survivor = pool->allocate(10);
+    pool.reset();
+    std::memcpy(survivor.data(), "0123456789", 10);
+    EXPECT_EQ(survivor.view(), "0123456789");
+}
+
+// 批量帧测试：条数必须一致，条目必须完整且不能嵌套
+TEST_F(RpcFrameworkSimpleTest, BatchFrameValidation) {
+    std::string frames;
+    for (uint32_t i = 1; i <= 3; ++i) {
+        Message request = create_request_message(1, 2, i, encode_value(i));
+        append_message(frames, request.header, request.payload);
+    }
+    EXPECT_TRUE(validate_batch(frames, 3));
+    EXPECT_FALSE(validate_batch(frames, 2));
+    EXPECT_FALSE(validate_batch(std::string_view(frames).substr(0, frames.size() - 1), 3));
+    
+    Message batch = create_batch_message(frames, 3);
+    EXPECT_EQ(batch.header.message_type, static_cast<uint32_t>(MessageType::BATCH));
+    EXPECT_EQ(batch.header.sequence_id, 3u);
+    EXPECT_EQ(batch.header.payload_size, frames.size());
+    EXPECT_EQ(get_message_type_string(MessageType::BATCH), "BATCH");
+    
+    std::string nested = frames;
+    append_message(nested, batch.header, batch.payload);
+    EXPECT_FALSE(validate_batch(nested, 4));
+}
+
+// 块压缩测试：各种输入往返一致，可压缩数据明显变小，损坏的数据被拒绝而不越界
+TEST_F(RpcFrameworkSimpleTest, BlockCompressionRoundTrip) {
+    std::mt19937 rng(42);
+    std::string random(100000, '\0');
+    for (auto& c : random) {
+        c = static_cast<char>(rng());
+    }
+    std::string text;
+    while (text.size() < 100000) {
+        text += "{\"id\":" + std::to_string(text.size() % 977) + ",\"name\":\"result-row\",\"ok\":true},";
+    }
+    std::vector<std::string> inputs = {
+        "", "a", "abcdefghijkl", "abcdefghijklm", std::string(100000, 'a'), std::string(300, 'b') + random.substr(0, 300),
+        random.substr(0, 1000) + random.substr(0, 1000), text, random
+    };
+    
+    for (const auto& input : inputs) {
+        std::string compressed(compress_bound(input.size()), '\0');
+        size_t size = compress_block(input.data(), input.size(), &compressed[0], compressed.size());
+        ASSERT_GT(size, 0u);
+        std::string output(input.size(), '\0');
+        ASSERT_TRUE(decompress_block(compressed.data(), size, &output[0], output.size()));
+        EXPECT_EQ(output, input);
+        
+        // 长度不符或截断都失败
+        std::string wrong(input.size() + 1, '\0');
+        EXPECT_FALSE(decompress_block(compressed.data(), size, &wrong[0], wrong.size()));
+        if (size > 1) {
+            EXPECT_FALSE(decompress_block(compressed.data(), size - 1, &output[0], output.size()));
+        }
+    }
+    
+    // 可压缩的数据变小，随机数据不值得压缩
+    std::string out(compressed_payload_bound(text.size()), '\0');
+    size_t size = compress_payload(text, &out[0], out.size());
+    ASSERT_GT(size, 0u);
+    EXPECT_LT(size, text.size() / 5);
+    EXPECT_EQ(compressed_payload_size(std::string_view(out.data(), size)), text.size());
+    std::string restored(text.size(), '\0');
+    decompress_payload(std::string_view(out.data(), size), &restored[0]);
+    EXPECT_EQ(restored, text);
+    out.assign(compressed_payload_bound(random.size()), '\0');
+    EXPECT_EQ(compress_payload(random, &out[0], out.size()), 0u);
+    
+    // 偏移指向输出开头之前
+    const char bad_offset[] = {0x00, 0x01, 0x00};
+    char sink[16];
+    EXPECT_FALSE(decompress_block(bad_offset, sizeof(bad_offset), sink, sizeof(sink)));
+    EXPECT_THROW(compressed_payload_size("ab"), rpc_exception);
+    
+    // 随机修改压缩数据：只能失败或得到同样长度的输出，不能越界
+    std::string compressed(compress_bound(text.size()), '\0');
+    size = compress_block(text.data(), text.size(), &compressed[0], compressed.size());
+    compressed.resize(size);
+    for (int i = 0; i < 2000; ++i) {
+        std::string mutated = compressed;
+        for (int j = 0; j < 4; ++j) {
+            mutated[rng() % mutated.size()] = static_cast<char>(rng());
+        }
+        decompress_block(mutated.data(), mutated.size(), &restored[0], restored.size());
+    }
+}
+
+// 回显服务：方法1/3返回参数本身（单个参数的编码即是同类型结果的编码），方法2/4休眠后返回
+class EchoService : public Service {
+public:
+    std::string call_method(uint32_t method_id, const std::string& args) override {
+        if (method_id == 2 || method_id == 4) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        if (method_id >= 1 && method_id <= 4) {
+            return args;
+        }
+        throw rpc_exception("Unknown method: " + std::to_string(method_id));
+    }
+    uint32_t get_service_id() const override { return 7; }
+    std::string get_service_name() const override { return "EchoService"; }
+};
+
+// 事件驱动服务器测试，客户端使用阻塞socket直接收发协议帧
+class RpcServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        server = std::make_shared<RpcServer>(0, 2);
+        server->register_service(std::make_shared<EchoService>());
+        server->start();
+    }
+    
+    void TearDown() override {
+        server->stop();
+    }
+    
+    int connect_client() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(server->port());
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    
+    static void write_all(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = write(fd, data.data() + sent, data.size() - sent);
+            ASSERT_GT(n, 0);
+            sent += static_cast<size_t>(n);
+        }
+    }
+    
+    static Message read_message(int fd) {
+        char header[28];
+        EXPECT_EQ(recv(fd, header, sizeof(header), MSG_WAITALL), 28);
+        Message message;
+        message.header = deserialize_header(std::string(header, sizeof(header)));
+        message.payload.resize(message.header.payload_size);
+        if (message.header.payload_size > 0) {
+            EXPECT_EQ(recv(fd, &message.payload[0], message.payload.size(), MSG_WAITALL),
+                      static_cast<ssize_t>(message.payload.size()));
+        }
+        return message;
+    }
+    
+    static size_t thread_count() {
+        size_t count = 0;
+        DIR* dir = opendir("/proc/self/task");
+        while (dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') {
+                ++count;
+            }
+        }
+        closedir(dir);
+        return count;
+    }
+    
+    template <typename Pred>
+    static bool wait_until(Pred pred) {
+        for (int i = 0; i < 500 && !pred(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return pred();
+    }
+    
+    std::shared_ptr<RpcServer> server;
+};
+
+TEST_F(RpcServerTest, PipelinedAndFragmentedRequests) {
+    int fd = connect_client();
+    ASSERT_GE(fd, 0);
+    
+    // 100个请求一次写出，服务器需要从同一次读取中切分出多条消息；响应按完成顺序到达，按message_id核对
+    std::string batch;
+    for (uint32_t i = 1; i <= 100; ++i) {
+        batch += serialize_message(create_request_message(7, i % 10 == 0 ? 2 : 1, i, "payload-" + std::to_string(i)));
+    }
+    write_all(fd, batch);
+    std::map<uint32_t, std::string> responses;
+    for (uint32_t i = 1; i <= 100; ++i) {
+        Message response = read_message(fd);
+        EXPECT_EQ(response.header.message_type, static_cast<uint32_t>(MessageType::RESPONSE));
+        responses[response.header.message_id] = response.payload;
+    }
+    ASSERT_EQ(responses.size(), 100u);
+    for (uint32_t i = 1; i <= 100; ++i) {
+        EXPECT_EQ(responses[i], "payload-" + std::to_string(i));
+    }
+    
+    // 一条消息分三次到达：头部的一半、头部剩余部分加半个负载、剩余负载
+    std::string split = serialize_message(create_request_message(7, 1, 500, std::string(1000, 'x')));
+    write_all(fd, split.substr(0, 10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    write_all(fd, split.substr(10, 500));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    write_all(fd, split.substr(510));
+    Message response = read_message(fd);
+    EXPECT_EQ(response.header.message_id, 500u);
+    EXPECT_EQ(response.payload, std::string(1000, 'x'));
+    
+    close(fd);
+}
+
+TEST_F(RpcServerTest, SlowRequestDoesNotBlockConnection) {
+    int fd = connect_client();
+    ASSERT_GE(fd, 0);
+    
+    // 慢请求（休眠20ms）在前，快请求在后：快请求的响应先写出
+    write_all(fd, serialize_message(create_request_message(7, 2, 1, "slow")) +
+                  serialize_message(create_request_message(7, 1, 2, "fast")));
+    EXPECT_EQ(read_message(fd).header.message_id, 2u);
+    EXPECT_EQ(read_message(fd).header.message_id, 1u);
+    close(fd);
+    
+    // 并发上限为1时同一连接上的请求逐个执行，按到达顺序响应
+    RpcServer serial(0, 4, 4096, 1);
+    serial.register_service(std::make_shared<EchoService>());
+    serial.start();
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(serial.port());
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    
+    std::string requests;
+    for (uint32_t i = 1; i <= 4; ++i) {
+        requests += serialize_message(create_request_message(7, i == 4 ? 1 : 2, i, "x"));
+    }
+    auto start = std::chrono::steady_clock::now();
+    write_all(fd, requests);
+    for (uint32_t i = 1; i <= 4; ++i) {
+        EXPECT_EQ(read_message(fd).header.message_id, i);
+    }
+    // 三个慢请求没有在4个工作线程上并行
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(60));
+    close(fd);
+    serial.stop();
+}
+
+TEST_F(RpcServerTest, ErrorsAndInvalidFrames) {
+    int fd = connect_client();
+    ASSERT_GE(fd, 0);
+    
+    // 未注册的服务返回错误消息，连接保持可用
+    write_all(fd, serialize_message(create_request_message(99, 1, 1, "")));
+    Message error = read_message(fd);
+    EXPECT_EQ(error.header.message_type, static_cast<uint32_t>(MessageType::ERROR));
+    EXPECT_EQ(error.header.message_id, 1u);
+    
+    write_all(fd, serialize_message(create_request_message(7, 1, 2, "ok")));
+    EXPECT_EQ(read_message(fd).payload, "ok");
+    
+    // 魔数错误时服务器关闭连接
+    std::string garbage(28, '\x7f');
+    write_all(fd, garbage);
+    char byte;
+    EXPECT_EQ(recv(fd, &byte, 1, 0), 0);
+    close(fd);
+    
+    EXPECT_TRUE(wait_until([&]() { return server->connection_count() == 0; }));
+}
+
+TEST_F(RpcServerTest, ManyIdleConnectionsUseFixedThreads) {
+    const size_t threads_before = thread_count();
+    const size_t connections = 2000;
+    
+    std::vector<int> fds;
+    for (size_t i = 0; i < connections; ++i) {
+        int fd = connect_client();
+        ASSERT_GE(fd, 0);
+        fds.push_back(fd);
+    }
+    ASSERT_TRUE(wait_until([&]() { return server->connection_count() == connections; }));
+    
+    // 连接数增加不会增加线程
+    EXPECT_EQ(thread_count(), threads_before);
+    
+    // 大量空闲连接存在时，任意连接上的请求仍然及时得到响应
+    for (size_t i = 0; i < connections; i += 250) {
+        write_all(fds[i], serialize_message(create_request_message(7, 1, static_cast<uint32_t>(i), "ping")));
+        Message response = read_message(fds[i]);
+        EXPECT_EQ(response.header.message_id, i);
+        EXPECT_EQ(response.payload, "ping");
+    }
+    
+    for (int fd : fds) {
+        close(fd);
+    }
+    EXPECT_TRUE(wait_until([&]() { return server->connection_count() == 0; }));
+    EXPECT_EQ(thread_count(), threads_before);
+}
+
+TEST_F(RpcServerTest, ClientMultiplexesCallsOnOneConnection) {
+    RpcClient client("127.0.0.1", server->port());
+    client.connect();
+    
+    EXPECT_EQ(client.call<std::string>(7, 3, std::string("hello")), "hello");
+    EXPECT_EQ(client.call<int>(7, 3, 42), 42);
+    EXPECT_THROW(client.call<int>(99, 1, 1), rpc_exception);
+    
+    // 异步调用不再为每个调用创建线程
+    const size_t threads_before = thread_count();
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 1000; ++i) {
+        futures.push_back(client.async_call<int>(7, 3, i));
+    }
+    EXPECT_EQ(thread_count(), threads_before);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(futures[i].get(), i);
+    }
+    
+    EXPECT_EQ(server->connection_count(), 1u);
+    EXPECT_EQ(client.outstanding_calls(), 0u);
+}
+
+TEST_F(RpcServerTest, ClientSustainsHundredThousandOutstandingCalls) {
+    RpcClient client("127.0.0.1", server->port());
+    client.connect();
+    
+    const int calls = 100000;
+    std::atomic<int> completed{0};
+    std::atomic<int> mismatched{0};
+    std::promise<void> done;
+    
+    // 全部调用先发出，响应在接收线程上回调
+    for (int i = 0; i < calls; ++i) {
+        client.async_call_with_callback<int>(7, 3, [&, i](int result, const std::string& error) {
+            if (!error.empty() || result != i) {
+                mismatched++;
+            }
+            if (++completed == calls) {
+                done.set_value();
+            }
+        }, i);
+    }
+    
+    ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(60)), std::future_status::ready);
+    EXPECT_EQ(mismatched.load(), 0);
+    EXPECT_EQ(client.outstanding_calls(), 0u);
+}
+
+TEST_F(RpcServerTest, ClientFailsPendingCallsOnDisconnect) {
+    RpcClient client("127.0.0.1", server->port(), 4);
+    client.connect();
+    
+    // 容量为4：第5个并发调用被拒绝
+    std::vector<std::future<std::string>> futures;
+    for (int i = 0; i < 4; ++i) {
+        futures.push_back(client.async_call<std::string>(7, 4, std::string("slow")));
+    }
+    EXPECT_THROW(client.async_call<std::string>(7, 4, std::string("slow")), rpc_exception);
+    
+    // 取消的调用不再回调，其余调用在断开时以错误完成
+    std::atomic<bool> canceled_called{false};
+    EXPECT_EQ(futures[0].get(), "slow");
+    uint32_t id = client.send_request(7, 4, "", [&](std::string_view, const std::string&) {
+        canceled_called = true;
+    });
+    EXPECT_TRUE(client.cancel(id));
+    EXPECT_FALSE(client.cancel(id));
+    
+    client.disconnect();
+    EXPECT_FALSE(client.is_connected());
+    EXPECT_EQ(client.outstanding_calls(), 0u);
+    size_t failed = 0;
+    for (size_t i = 1; i < futures.size(); ++i) {
+        try {
+            futures[i].get();
+        } catch (const rpc_exception&) {
+            ++failed;
+        }
+    }
+    EXPECT_GT(failed, 0u);
+    EXPECT_FALSE(canceled_called.load());
+    
+    // 断开后可以重新连接
+    client.connect();
+    EXPECT_EQ(client.call<std::string>(7, 3, std::string("again")), "again");
+}
+
+TEST_F(RpcServerTest, ClientDisconnectFromCallback) {
+    // 在完成回调中断开后立即销毁客户端：析构函数回收接收线程，不会访问已释放的客户端
+    for (int i = 0; i < 50; ++i) {
+        auto client = std::make_unique<RpcClient>("127.0.0.1", server->port());
+        client->connect();
+        RpcClient* raw = client.get();
+        
+        std::promise<void> done;
+        client->async_call_with_callback<int>(7, 3, [raw, &done](int, const std::string&) {
+            raw->disconnect();
+            done.set_value();
+        }, i);
+        done.get_future().get();
+        EXPECT_FALSE(client->is_connected());
+        client.reset();
+    }
+    
+    // 回调中断开后从其他线程重新连接，旧的接收线程不影响新连接
+    RpcClient client("127.0.0.1", server->port());
+    client.connect();
+    std::promise<bool> reconnect_rejected;
+    client.async_call_with_callback<int>(7, 3, [&](int, const std::string&) {
+        client.disconnect();
+        try {
+            client.connect();
+            reconnect_rejected.set_value(false);
+        } catch (const rpc_exception&) {
+            reconnect_rejected.set_value(true);
+        }
+    }, 1);
+    EXPECT_TRUE(reconnect_rejected.get_future().get());
+    client.connect();
+    EXPECT_TRUE(client.is_connected());
+    EXPECT_EQ(client.call<std::string>(7, 3, std::string("again")), "again");
+    EXPECT_TRUE(client.is_connected());
+}
+
+// 类型化服务：普通类，不继承Service
+class Calculator {
+public:
+    int add(int a, int b) { return a + b; }
+    std::string concat(const std::string& a, const std::string& b) const { return a + b; }
+    std::vector<double> scale(std::vector<double> values, double factor) {
+        for (auto& value : values) {
+            value *= factor;
+        }
+        return values;
+    }
+    int count() const { return calls_; }
+    void touch() { ++calls_; }
+    
+private:
+    int calls_ = 0;
+};
+
+TEST_F(RpcServerTest, TypedServiceDispatchesBoundMethods) {
+    auto impl = std::make_shared<Calculator>();
+    TypedService<Calculator> calc(8, "Calculator", impl);
+    calc.bind<&Calculator::add>(1)
+        .bind<&Calculator::concat>(2)
+        .bind<&Calculator::scale>(3)
+        .bind<&Calculator::count>(4)
+        .bind<&Calculator::touch>(5);
+    EXPECT_THROW(calc.bind<&Calculator::add>(1), rpc_exception);
+    EXPECT_THROW(calc.bind<&Calculator::add>(RpcServer::max_method_id + 1), rpc_exception);
+    const long owners_before = impl.use_count();
+    server->register_service(calc);
+    EXPECT_GT(impl.use_count(), owners_before);
+    EXPECT_THROW(server->register_service(calc), rpc_exception);
+    
+    RpcClient client("127.0.0.1", server->port());
+    client.connect();
+    EXPECT_EQ(client.call<int>(8, 1, 2, 40), 42);
+    EXPECT_EQ(client.call<std::string>(8, 2, std::string("foo"), "bar"), "foobar");
+    EXPECT_EQ(client.call<std::vector<double>>(8, 3, std::vector<double>{1.0, -2.5}, 2.0),
+              (std::vector<double>{2.0, -5.0}));
+    
+    // void方法返回空结果
+    std::promise<std::string> touched;
+    client.send_request(8, 5, "", [&](std::string_view payload, const std::string& error) {
+        touched.set_value(error.empty() ? std::string(payload) : "error");
+    });
+    EXPECT_EQ(touched.get_future().get(), "");
+    EXPECT_EQ(client.call<int>(8, 4), 1);
+    
+    // 参数类型不符、未绑定的方法、注销后的服务都返回错误
+    EXPECT_THROW(client.call<int>(8, 1, 2), rpc_exception);
+    EXPECT_THROW(client.call<int>(8, 9, 1), rpc_exception);
+    server->unregister_service(8);
+    EXPECT_THROW(client.call<int>(8, 1, 2, 40), rpc_exception);
+    
+    // 没有请求在使用旧分派表时，注销的服务随旧表一起释放
+    EXPECT_EQ(impl.use_count(), owners_before);
+    
+    // Service接口的服务与类型化服务共存
+    EXPECT_EQ(client.call<int>(7, 3, 5), 5);
+    EXPECT_THROW(server->register_service(TypedService<Calculator>(RpcServer::max_service_id + 1, "Big", impl)),
+                 rpc_exception);
+}
+
+TEST_F(RpcServerTest, LargePayloadRoundTrip) {
+    RpcClient client("127.0.0.1", server->port());
+    client.connect();
+    
+    // 1MB负载跨越多次部分写出和多次接收，仍以一帧完整返回
+    std::string large(1 << 20, '\0');
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<char>(i * 131);
+    }
+    EXPECT_EQ(client.call<std::string>(7, 1, large), large);
+    
+    std::vector<std::future<std::string>> futures;
+    for (int i = 0; i < 8; ++i) {
+        futures.push_back(client.async_call<std::string>(7, 1, large));
+    }
+    for (auto& future : futures) {
+        EXPECT_EQ(future.get(), large);
+    }
+}
+
+TEST_F(RpcServerTest, ServerAnswersBatchInOneFrame) {
+    int fd = connect_client();
+    ASSERT_GE(fd, 0);
+    
+    // 三个请求放在一个批量帧中，第三个请求的服务不存在
+    std::string frames;
+    for (uint32_t i = 1; i <= 3; ++i) {
+        Message request = create_request_message(i == 3 ? 99 : 7, 1, i, encode_value(int(i * 10)));
+        append_message(frames, request.header, request.payload);
+    }
+    write_all(fd, serialize_message(create_batch_message(frames, 3)));
+    
+    Message response = read_message(fd);
+    ASSERT_EQ(response.header.message_type, static_cast<uint32_t>(MessageType::BATCH));
+    ASSERT_EQ(response.header.sequence_id, 3u);
+    ASSERT_TRUE(validate_batch(response.payload, 3));
+    
+    MessageView entry;
+    size_t pos = 0;
+    for (uint32_t i = 1; i <= 3; ++i) {
+        ASSERT_TRUE(parse_message(response.payload.data() + pos, response.payload.size() - pos, entry));
+        EXPECT_EQ(entry.header.message_id, i);
+        if (i < 3) {
+            EXPECT_EQ(entry.header.message_type, static_cast<uint32_t>(MessageType::RESPONSE));
+            EXPECT_EQ(decode_value<int>(entry.payload), int(i * 10));
+        } else {
+            EXPECT_EQ(entry.header.message_type, static_cast<uint32_t>(MessageType::ERROR));
+        }
+        pos += message_header_size + entry.payload.size();
+    }
+    
+    // 条数与内容不符的批量帧无法恢复，连接被关闭
+    write_all(fd, serialize_message(create_batch_message(frames, 4)));
+    char byte;
+    EXPECT_EQ(recv(fd, &byte, 1, 0), 0);
+    close(fd);
+}
+
+TEST_F(RpcServerTest, ClientCoalescesCallsIntoBatches) {
+    RpcClient client("127.0.0.1", server->port());
+    client.connect();
+    client.enable_batching(std::chrono::milliseconds(2));
+    
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 1000; ++i) {
+        futures.push_back(client.async_call<int>(7, 1, i));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(futures[i].get(), i);
+    }
+    // 1000个小请求合并为远少于1000次写出
+    EXPECT_LT(client.frames_sent(), 100u);
+    
+    // 单个请求按普通帧发送，同步调用也能在窗口结束时完成
+    EXPECT_EQ(client.call<std::string>(7, 1, std::string("single")), "single");
+    
+    // 停止合并时等待合并线程退出，之后的计数稳定
+    client.disable_batching();
+    uint64_t before = client.frames_sent();
+    EXPECT_EQ(client.call<int>(7, 1, 5), 5);
+    EXPECT_EQ(client.frames_sent(), before + 1);
+}
+
+TEST_F(RpcServerTest, CompressionNegotiatedAtConnect) {
+    RpcServer compressing(0, 2);
+    compressing.register_service(std::make_shared<EchoService>());
+    compressing.enable_compression(1024);
+    compressing.start();
+    EXPECT_THROW(compressing.enable_compression(), rpc_exception);
+    
+    std::string large;
+    while (large.size() < 200000) {
+        large += "row " + std::to_string(large.size() % 1000) + " of a highly compressible result set; ";
+    }
+    
+    // 双方都支持：大请求和大响应都压缩，结果不变
+    RpcClient client("127.0.0.1", compressing.port());
+    client.enable_compression(1024);
+    client.connect();
+    EXPECT_TRUE(client.compression_negotiated());
+    EXPECT_EQ(client.call<std::string>(7, 1, large), large);
+    EXPECT_EQ(client.call<int>(7, 1, 3), 3);
+    
+    // 合并后的批量帧整体压缩
+    client.enable_batching(std::chrono::milliseconds(2));
+    std::vector<std::future<std::string>> futures;
+    for (int i = 0; i < 200; ++i) {
+        futures.push_back(client.async_call<std::string>(7, 1, std::string("entry ") + large.substr(0, 100)));
+    }
+    for (auto& future : futures) {
+        EXPECT_EQ(future.get(), std::string("entry ") + large.substr(0, 100));
+    }
+    client.disable_batching();
+    
+    // 在线路上检查：协商后发送压缩请求，响应带压缩标志且明显小于原始长度
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(compressing.port());
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    write_all(fd, serialize_message(create_hello_message(0, capability_compression)));
+    Message hello = read_message(fd);
+    EXPECT_EQ(hello.header.message_type, static_cast<uint32_t>(MessageType::HELLO));
+    EXPECT_EQ(decode_value<uint32_t>(hello.payload), capability_compression);
+    
+    std::string args = encode_value(large);
+    Message request = create_request_message(7, 1, 9, "");
+    request.payload.resize(compressed_payload_bound(args.size()));
+    request.payload.resize(compress_payload(args, &request.payload[0], request.payload.size()));
+    request.header.message_type |= message_flag_compressed;
+    request.header.payload_size = request.payload.size();
+    write_all(fd, serialize_message(request));
+    Message response = read_message(fd);
+    EXPECT_EQ(response.header.message_type, static_cast<uint32_t>(MessageType::RESPONSE) | message_flag_compressed);
+    EXPECT_LT(response.payload.size(), args.size() / 5);
+    std::string plain(compressed_payload_size(response.payload), '\0');
+    decompress_payload(response.payload, &plain[0]);
+    EXPECT_EQ(plain, args);
+    close(fd);
+    
+    // 服务器未开启压缩：协商失败，照常通信
+    RpcClient plain_client("127.0.0.1", server->port());
+    plain_client.enable_compression();
+    plain_client.connect();
+    EXPECT_FALSE(plain_client.compression_negotiated());
+    EXPECT_EQ(plain_client.call<std::string>(7, 1, large), large);
+    
+    compressing.stop();
+}
+
+// 保留参数缓冲区的服务：重写handle_call，不复制负载
+class RetainingService : public Service {
+public:
+    std::string call_method(uint32_t, const std::string&) override { return ""; }
+    std::string handle_call(uint32_t, const PayloadBuffer& args) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        retained.push_back(args);
+        return std::string(args.view());
+    }
+    uint32_t get_service_id() const override { return 9; }
+    std::string get_service_name() const override { return "RetainingService"; }
+    
+    std::mutex mutex;
+    std::vector<PayloadBuffer> retained;
+};
+
+TEST_F(RpcServerTest, RequestPayloadsUsePooledBuffers) {
+    auto retaining = std::make_shared<RetainingService>();
+    server->register_service(retaining);
+    RpcClient client("127.0.0.1", server->port());
+    client.connect();
+    
+    // 负载处理完即归还，稳定后的请求都由池中的块满足
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(client.call<std::string>(7, 1, std::string(1000, 'a' + i % 26)), std::string(1000, 'a' + i % 26));
+    }
+    EXPECT_GE(server->buffer_pool().pool_hits(), 90u);
+    EXPECT_LE(server->buffer_pool().pool_misses(), 10u);
+    
+    // 服务保留的缓冲区在调用返回后仍然有效，不会被后续请求复用
+    EXPECT_EQ(client.call<std::string>(9, 1, std::string("first")), "first");
+    EXPECT_EQ(client.call<std::string>(9, 1, std::string("second")), "second");
+    std::lock_guard<std::mutex> lock(retaining->mutex);
+    ASSERT_EQ(retaining->retained.size(), 2u);
+    EXPECT_EQ(decode_value<std::string>(retaining->retained[0].view()), "first");
+    EXPECT_EQ(decode_value<std::string>(retaining->retained[1].view()), "second");
+}
+
+// 计数的回显服务，用于观察通道把调用分到了哪个后端
+class CountingService : public Service {
+public:
+    std::string call_method(uint32_t method_id, const std::string& args) override {
+        if (method_id == 2) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        calls.fetch_add(1);
+        return args;
+    }
+    uint32_t get_service_id() const override { return 7; }
+    std::string get_service_name() const override { return "CountingService"; }
+    
+    std::atomic<int> calls{0};
+};
+
+TEST_F(RpcServerTest, ChannelBalancesAndReconnects) {
+    auto counting_a = std::make_shared<CountingService>();
+    auto counting_b = std::make_shared<CountingService>();
+    RpcServer server_a(0, 2);
+    server_a.register_service(counting_a);
+    server_a.start();
+    auto server_b = std::make_unique<RpcServer>(0, 2);
+    server_b->register_service(counting_b);
+    server_b->start();
+    uint16_t port_b = server_b->port();
+    
+    ChannelOptions options;
+    options.initial_backoff = std::chrono::milliseconds(20);
+    options.max_backoff = std::chrono::milliseconds(100);
+    RpcChannel channel(LoadBalancer::Strategy::ROUND_ROBIN, options);
+    channel.add_backend("127.0.0.1", server_a.port());
+    channel.add_backend("127.0.0.1", port_b);
+    EXPECT_EQ(channel.backend_count(), 2u);
+    
+    // 轮转分配，每个后端的两个连接都按需建立
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(channel.call<int>(7, 1, i), i);
+    }
+    EXPECT_EQ(counting_a->calls.load(), 50);
+    EXPECT_EQ(counting_b->calls.load(), 50);
+    EXPECT_EQ(channel.connected_count(), 4u);
+    
+    // 后端停止后调用全部落到另一个后端，重连失败进入退避
+    server_b->stop();
+    ASSERT_TRUE(wait_until([&]() { return channel.connected_count() == 2; }));
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(channel.call<int>(7, 1, i), i);
+    }
+    EXPECT_EQ(counting_a->calls.load(), 100);
+    EXPECT_EQ(counting_b->calls.load(), 50);
+    
+    // 在原端口重启，退避到期后重新连上
+    auto restarted = std::make_shared<CountingService>();
+    server_b = std::make_unique<RpcServer>(port_b, 2);
+    server_b->register_service(restarted);
+    server_b->start();
+    EXPECT_TRUE(wait_until([&]() {
+        EXPECT_EQ(channel.call<int>(7, 1, 1), 1);
+        return restarted->calls.load() > 0;
+    }));
+    
+    channel.remove_backend("127.0.0.1", server_a.port());
+    int before = restarted->calls.load();
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(channel.call<int>(7, 1, i), i);
+    }
+    EXPECT_EQ(restarted->calls.load(), before + 10);
+    
+    server_b->stop();
+    server_a.stop();
+}
+
+TEST_F(RpcServerTest, ChannelLeastConnectionsFollowsInFlightCalls) {
+    auto counting_a = std::make_shared<CountingService>();
+    auto counting_b = std::make_shared<CountingService>();
+    RpcServer server_a(0, 4);
+    server_a.register_service(counting_a);
+    server_a.start();
+    RpcServer server_b(0, 4);
+    server_b.register_service(counting_b);
+    server_b.start();
+    
+    RpcChannel channel(LoadBalancer::Strategy::LEAST_CONNECTIONS);
+    EXPECT_THROW(channel.call<int>(7, 1, 1), rpc_exception);
+    channel.add_backend("127.0.0.1", server_a.port());
+    channel.add_backend("127.0.0.1", server_b.port());
+    
+    // 慢调用在途时计入后端负担，新调用选择在途最少的后端
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 20; ++i) {
+        futures.push_back(channel.async_call<int>(7, 2, i));
+    }
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(futures[i].get(), i);
+    }
+    EXPECT_EQ(counting_a->calls.load() + counting_b->calls.load(), 20);
+    EXPECT_NEAR(counting_a->calls.load(), 10, 2);
+    
+    server_a.stop();
+    server_b.stop();
+}
+
+// 监听队列长度为0的socket：第一个连接占满接受队列，之后的SYN被丢弃，握手一直不完成
+class StalledListener {
+public:
+    StalledListener() {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        listen(listen_fd_, 0);
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        
+        first_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        ::connect(first_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+    
+    ~StalledListener() {
+        close(first_fd_);
+        close(listen_fd_);
+    }
+    
+    uint16_t port() const { return port_; }
+    
+private:
+    int listen_fd_;
+    int first_fd_;
+    uint16_t port_;
+};
+
+TEST_F(RpcServerTest, ClientConnectTimesOut) {
+    StalledListener stalled;
+    RpcClient client("127.0.0.1", stalled.port());
+    
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(client.connect(std::chrono::milliseconds(100)), rpc_exception);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(100));
+    EXPECT_LT(elapsed, std::chrono::seconds(2));
+    EXPECT_FALSE(client.is_connected());
+    
+    // 超时后同一个客户端可以连接其他可用的服务器
+    RpcClient good("127.0.0.1", server->port());
+    good.connect(std::chrono::milliseconds(100));
+    EXPECT_EQ(good.call<int>(7, 3, 5), 5);
+}
+
+TEST_F(RpcServerTest, ChannelSkipsConnectionBeingReconnected) {
+    StalledListener stalled;
+    
+    ChannelOptions options;
+    options.connections_per_backend = 1;
+    options.connect_timeout = std::chrono::milliseconds(500);
+    RpcChannel channel(LoadBalancer::Strategy::ROUND_ROBIN, options);
+    channel.add_backend("127.0.0.1", stalled.port());
+    channel.add_backend("127.0.0.1", server->port());
+    
+    // 第一个调用选中不响应的后端，在超时之前一直在重连
+    auto slow = std::async(std::launch::async, [&]() {
+        auto start = std::chrono::steady_clock::now();
+        int result = channel.call<int>(7, 3, 1);
+        return std::make_pair(result, std::chrono::steady_clock::now() - start);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    
+    // 重连期间的调用跳过该连接转到另一个后端，不等待连接超时，也不阻塞统计
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(channel.call<int>(7, 3, i), i);
+    }
+    EXPECT_EQ(channel.connected_count(), 1u);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(300));
+    
+    // 重连超时后第一个调用转到可用的后端完成
+    auto [result, elapsed] = slow.get();
+    EXPECT_EQ(result, 1);
+    EXPECT_GE(elapsed, std::chrono::milliseconds(450));
+    EXPECT_LT(elapsed, std::chrono::seconds(3));
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,665 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace impl {
+
+template <typename T> class future;
+template <typename T> class promise;
+
+namespace detail {
+
+/**
+ * @brief 线程本地的小对象缓存
+ *
+ * 共享状态按64字节分级，释放时放回当前线程的空闲链表，
+ * 下一次分配直接复用，避免每次submit都走一次全局malloc。
+ */
+class small_object_cache {
+public:
+    static constexpr size_t granularity = 64;
+    static constexpr size_t class_count = 8;     // 最大缓存512字节的对象
+    static constexpr size_t max_cached = 256;    // 每个级别最多缓存的块数
+
+    static void* allocate(size_t size) {
+        size_t index = class_index(size);
+        if (index < class_count && !destroyed()) {
+            free_list& list = lists().heads[index];
+            if (list.head) {
+                node* block = list.head;
+                list.head = block->next;
+                --list.count;
+                return block;
+            }
+            return ::operator new((index + 1) * granularity);
+        }
+        return ::operator new(size);
+    }
+
+    static void deallocate(void* ptr, size_t size) noexcept {
+        size_t index = class_index(size);
+        if (index < class_count && !destroyed()) {
+            free_list& list = lists().heads[index];
+            if (list.count < max_cached) {
+                node* block = static_cast<node*>(ptr);
+                block->next = list.head;
+                list.head = block;
+                ++list.count;
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+private:
+    struct node {
+        node* next;
+    };
+
+    struct free_list {
+        node* head = nullptr;
+        size_t count = 0;
+    };
+
+    struct thread_lists {
+        free_list heads[class_count];
+
+        ~thread_lists() {
+            for (free_list& list : heads) {
+                while (list.head) {
+                    node* next = list.head->next;
+                    ::operator delete(list.head);
+                    list.head = next;
+                }
+            }
+            destroyed() = true;
+        }
+    };
+
+    static size_t class_index(size_t size) {
+        return (size + granularity - 1) / granularity - 1;
+    }
+
+    static thread_lists& lists() {
+        static thread_local thread_lists instance;
+        return instance;
+    }
+
+    // 线程退出后仍可能有对象在该线程析构，此时直接交还给全局分配器
+    static bool& destroyed() {
+        static thread_local bool flag = false;
+        return flag;
+    }
+};
+
+/**
+ * @brief 状态就绪时被调用的回调节点（continuation或阻塞等待者）
+ */
+class continuation_base {
+public:
+    virtual void run() noexcept = 0;
+
+protected:
+    ~continuation_base() = default;
+};
+
+/**
+ * @brief 共享状态基类
+ *
+ * 状态字的取值：
+ * - empty: 结果未就绪，没有回调
+ * - ready: 结果已就绪
+ * - 其它值: 指向已挂接的continuation_base
+ *
+ * 生产者用exchange写入ready，消费者用CAS挂接回调，
+ * 两者都不需要加锁；引用计数为侵入式，整个状态只有一次分配。
+ */
+class state_base {
+public:
+    static constexpr std::uintptr_t empty = 0;
+    static constexpr std::uintptr_t ready = 1;
+
+    state_base() : refs_(1), state_(empty) {}
+    virtual ~state_base() = default;
+
+    static void* operator new(size_t size) {
+        return small_object_cache::allocate(size);
+    }
+
+    static void operator delete(void* ptr, size_t size) noexcept {
+        small_object_cache::deallocate(ptr, size);
+    }
+
+    void add_ref() noexcept {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    bool is_ready() const noexcept {
+        return state_.load(std::memory_order_acquire) == ready;
+    }
+
+    /**
+     * @brief 挂接回调
+     * @return 挂接成功返回true；若结果已就绪返回false，调用者需自行处理
+     */
+    bool attach(continuation_base* continuation) noexcept {
+        std::uintptr_t expected = empty;
+        return state_.compare_exchange_strong(expected,
+                                              reinterpret_cast<std::uintptr_t>(continuation),
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 撤回尚未被调用的回调（用于wait_for超时）
+     * @return 撤回成功返回true；返回false表示生产者已经取走回调
+     */
+    bool detach(continuation_base* continuation) noexcept {
+        std::uintptr_t expected = reinterpret_cast<std::uintptr_t>(continuation);
+        return state_.compare_exchange_strong(expected, empty,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire);
+    }
+
+    void set_exception(std::exception_ptr error) {
+        check_not_ready();
+        exception_ = std::move(error);
+        publish();
+    }
+
+    const std::exception_ptr& exception() const noexcept {
+        return exception_;
+    }
+
+protected:
+    void check_not_ready() const {
+        if (is_ready()) {
+            throw std::future_error(std::future_errc::promise_already_satisfied);
+        }
+    }
+
+    /**
+     * @brief 发布结果并唤醒已挂接的回调
+     */
+    void publish() noexcept {
+        std::uintptr_t previous = state_.exchange(ready, std::memory_order_acq_rel);
+        if (previous != empty && previous != ready) {
+            reinterpret_cast<continuation_base*>(previous)->run();
+        }
+    }
+
+private:
+    std::atomic<uint32_t> refs_;
+    std::atomic<std::uintptr_t> state_;
+    std::exception_ptr exception_;
+};
+
+/**
+ * @brief 带结果存储的共享状态
+ */
+template <typename T>
+class shared_state : public state_base {
+public:
+    ~shared_state() override {
+        if (has_value_) {
+            reinterpret_cast<T*>(&storage_)->~T();
+        }
+    }
+
+    template <typename... Args>
+    void set_value(Args&&... args) {
+        check_not_ready();
+        ::new (static_cast<void*>(&storage_)) T(std::forward<Args>(args)...);
+        has_value_ = true;
+        publish();
+    }
+
+    T& value() noexcept {
+        return *reinterpret_cast<T*>(&storage_);
+    }
+
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+    bool has_value_ = false;
+};
+
+template <>
+class shared_state<void> : public state_base {
+public:
+    void set_value() {
+        check_not_ready();
+        publish();
+    }
+};
+
+/**
+ * @brief 以函数结果完成共享状态，捕获异常
+ */
+template <typename R, typename F, typename... Args>
+void fulfill(shared_state<R>& state, F& func, Args&&... args) {
+    try {
+        if constexpr (std::is_void<R>::value) {
+            func(std::forward<Args>(args)...);
+            state.set_value();
+        } else {
+            state.set_value(func(std::forward<Args>(args)...));
+        }
+    } catch (...) {
+        state.set_exception(std::current_exception());
+    }
+}
+
+/**
+ * @brief 线程池任务接口
+ */
+class task_base {
+public:
+    virtual void run() noexcept = 0;
+    virtual void abandon() noexcept = 0;
+
+protected:
+    ~task_base() = default;
+};
+
+/**
+ * @brief 任务与其共享状态合并在一次分配中
+ *
+ * 引用计数初始为2：一份属于返回给调用者的future，一份属于任务队列。
+ */
+template <typename R, typename F>
+class task_state final : public shared_state<R>, public task_base {
+public:
+    template <typename Func>
+    explicit task_state(Func&& func) : func_(std::forward<Func>(func)) {
+        this->add_ref();
+    }
+
+    void run() noexcept override {
+        fulfill(*this, func_);
+        this->release();
+    }
+
+    void abandon() noexcept override {
+        this->set_exception(std::make_exception_ptr(
+            std::future_error(std::future_errc::broken_promise)));
+        this->release();
+    }
+
+private:
+    F func_;
+};
+
+/**
+ * @brief then()生成的后续状态，作为回调挂接在源状态上
+ */
+template <typename R, typename T, typename F>
+class then_state final : public shared_state<R>, public continuation_base {
+public:
+    template <typename Func>
+    then_state(shared_state<T>* source, Func&& func)
+        : source_(source), func_(std::forward<Func>(func)) {
+        this->add_ref();
+    }
+
+    void run() noexcept override {
+        if (source_->exception()) {
+            this->set_exception(source_->exception());
+        } else if constexpr (std::is_void<T>::value) {
+            fulfill(*this, func_);
+        } else {
+            fulfill(*this, func_, std::move(source_->value()));
+        }
+        source_->release();
+        this->release();
+    }
+
+private:
+    shared_state<T>* source_;
+    F func_;
+};
+
+/**
+ * @brief then()回调的返回类型
+ */
+template <typename F, typename T>
+struct then_result {
+    using type = typename std::result_of<F(T&&)>::type;
+};
+
+template <typename F>
+struct then_result<F, void> {
+    using type = typename std::result_of<F()>::type;
+};
+
+/**
+ * @brief 阻塞等待者，只在结果未就绪且调用者确实需要阻塞时才使用锁
+ */
+class blocking_waiter final : public continuation_base {
+public:
+    void run() noexcept override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+        // 在持锁状态下通知，保证等待者返回前本对象仍然有效
+        cv_.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return done_; });
+    }
+
+    template <typename Clock, typename Duration>
+    bool wait_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_until(lock, deadline, [this] { return done_; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool done_ = false;
+};
+
+} // namespace detail
+
+/**
+ * @brief 轻量级future
+ *
+ * 特点：
+ * - 共享状态只有一次分配，并由线程本地缓存复用
+ * - is_ready()为一次原子读，不加锁
+ * - then()挂接后续回调，回调在完成结果的线程上执行；
+ *   若结果已就绪则在调用then()的线程上立即执行
+ * - 只有真正需要阻塞的wait()/get()才会使用互斥锁和条件变量
+ */
+template <typename T>
+class future {
+public:
+    using value_type = T;
+
+    future() noexcept : state_(nullptr) {}
+
+    future(future&& other) noexcept : state_(other.state_) {
+        other.state_ = nullptr;
+    }
+
+    future& operator=(future&& other) noexcept {
+        if (this != &other) {
+            reset();
+            state_ = other.state_;
+            other.state_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~future() {
+        reset();
+    }
+
+    future(const future&) = delete;
+    future& operator=(const future&) = delete;
+
+    /**
+     * @brief 检查future是否关联共享状态
+     */
+    bool valid() const noexcept {
+        return state_ != nullptr;
+    }
+
+    /**
+     * @brief 非阻塞地检查结果是否就绪
+     */
+    bool is_ready() const {
+        check_valid();
+        return state_->is_ready();
+    }
+
+    /**
+     * @brief 阻塞直到结果就绪
+     */
+    void wait() const {
+        check_valid();
+        if (spin_until_ready()) {
+            return;
+        }
+        detail::blocking_waiter waiter;
+        if (state_->attach(&waiter)) {
+            waiter.wait();
+        }
+    }
+
+    /**
+     * @brief 带超时的等待
+     * @param timeout 超时时间
+     * @return 等待结果状态
+     */
+    template <typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+        return wait_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    /**
+     * @brief 等待到指定时间点
+     * @param deadline 截止时间
+     * @return 等待结果状态
+     */
+    template <typename Clock, typename Duration>
+    std::future_status wait_until(const std::chrono::time_point<Clock, Duration>& deadline) const {
+        check_valid();
+        if (state_->is_ready()) {
+            return std::future_status::ready;
+        }
+        detail::blocking_waiter waiter;
+        if (!state_->attach(&waiter)) {
+            return std::future_status::ready;
+        }
+        if (waiter.wait_until(deadline)) {
+            return std::future_status::ready;
+        }
+        if (state_->detach(&waiter)) {
+            return std::future_status::timeout;
+        }
+        // 生产者已取走回调，必须等它调用完毕才能销毁waiter
+        waiter.wait();
+        return std::future_status::ready;
+    }
+
+    /**
+     * @brief 获取结果，调用后future失效
+     * @return 任务结果
+     * @throws 任务抛出的异常
+     */
+    T get() {
+        wait();
+        detail::shared_state<T>* state = state_;
+        state_ = nullptr;
+
+        struct releaser {
+            detail::shared_state<T>* state;
+            ~releaser() { state->release(); }
+        } guard{state};
+
+        if (state->exception()) {
+            std::rethrow_exception(state->exception());
+        }
+        if constexpr (!std::is_void<T>::value) {
+            return std::move(state->value());
+        }
+    }
+
+    /**
+     * @brief 挂接后续回调，调用后本future失效
+     * @param func 回调函数，参数为本future的结果（void时无参数）
+     * @return 回调结果的future；本future持有异常时直接传递异常
+     */
+    template <typename F>
+    auto then(F&& func) -> future<typename detail::then_result<F, T>::type> {
+        using R = typename detail::then_result<F, T>::type;
+        using State = detail::then_state<R, T, typename std::decay<F>::type>;
+
+        check_valid();
+        detail::shared_state<T>* source = state_;
+        state_ = nullptr;
+
+        auto* next = new State(source, std::forward<F>(func));
+        future<R> result(next);
+        if (!source->attach(next)) {
+            next->run();
+        }
+        return result;
+    }
+
+private:
+    template <typename> friend class future;
+    template <typename> friend class promise;
+    friend class thread_pool;
+
+    explicit future(detail::shared_state<T>* state) noexcept : state_(state) {}
+
+    void check_valid() const {
+        if (!state_) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+
+    // 短暂自旋，多数短任务在此期间就会完成，从而避免挂接等待者
+    bool spin_until_ready() const {
+        for (int i = 0; i < 64; ++i) {
+            if (state_->is_ready()) {
+                return true;
+            }
+            if (i >= 16) {
+                std::this_thread::yield();
+            }
+        }
+        return state_->is_ready();
+    }
+
+    void reset() noexcept {
+        if (state_) {
+            state_->release();
+            state_ = nullptr;
+        }
+    }
+
+    detail::shared_state<T>* state_;
+};
+
+/**
+ * @brief 与impl::future配对的promise
+ */
+template <typename T>
+class promise {
+public:
+    promise() : state_(new detail::shared_state<T>()), future_retrieved_(false) {}
+
+    promise(promise&& other) noexcept
+        : state_(other.state_), future_retrieved_(other.future_retrieved_) {
+        other.state_ = nullptr;
+    }
+
+    promise& operator=(promise&& other) noexcept {
+        if (this != &other) {
+            abandon();
+            state_ = other.state_;
+            future_retrieved_ = other.future_retrieved_;
+            other.state_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~promise() {
+        abandon();
+    }
+
+    promise(const promise&) = delete;
+    promise& operator=(const promise&) = delete;
+
+    /**
+     * @brief 获取关联的future，只能调用一次
+     */
+    future<T> get_future() {
+        check_valid();
+        if (future_retrieved_) {
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        }
+        future_retrieved_ = true;
+        state_->add_ref();
+        return future<T>(state_);
+    }
+
+    /**
+     * @brief 设置结果
+     */
+    template <typename... Args>
+    void set_value(Args&&... args) {
+        check_valid();
+        state_->set_value(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief 设置异常
+     */
+    void set_exception(std::exception_ptr error) {
+        check_valid();
+        state_->set_exception(std::move(error));
+    }
+
+private:
+    void check_valid() const {
+        if (!state_) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+
+    // promise在设置结果前被销毁时，future收到broken_promise
+    void abandon() noexcept {
+        if (!state_) {
+            return;
+        }
+        if (!state_->is_ready()) {
+            state_->set_exception(std::make_exception_ptr(
+                std::future_error(std::future_errc::broken_promise)));
+        }
+        state_->release();
+        state_ = nullptr;
+    }
+
+    detail::shared_state<T>* state_;
+    bool future_retrieved_;
+};
+
+/**
+ * @brief 创建一个已就绪的future
+ */
+template <typename T>
+future<typename std::decay<T>::type> make_ready_future(T&& value) {
+    promise<typename std::decay<T>::type> p;
+    p.set_value(std::forward<T>(value));
+    return p.get_future();
+}
+
+inline future<void> make_ready_future() {
+    promise<void> p;
+    p.set_value();
+    return p.get_future();
+}
+
+} // namespace impl
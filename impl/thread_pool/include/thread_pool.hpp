@@ -12,6 +12,9 @@
 #include <stdexcept>
 #include <type_traits>
 #include <memory>
+#include <cstddef>
+#include <typeinfo>
+#include "future.hpp"
 
 namespace impl {
 
@@ -24,51 +27,238 @@ public:
 };
 
 /**
- * @brief 任务包装器，支持任意返回类型的任务
+ * @brief 任务包装器，持有队列中一个任务的所有权
+ *
+ * 任务与其future的共享状态在同一次分配中，包装器本身只有一个指针大小。
+ * 未执行就被丢弃的任务会让对应的future收到broken_promise。
  */
 class task_wrapper {
 public:
-    task_wrapper() = default;
+    task_wrapper() noexcept : task_(nullptr) {}
     
-    template <typename F>
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, task_wrapper>::value>::type>
     task_wrapper(F&& f) {
-        using Result = typename std::result_of<F()>::type;
-        auto task = std::make_shared<std::packaged_task<Result()>>(
-            std::forward<F>(f)
-        );
-        future_ = task->get_future();
-        func_ = [task]() {
-            (*task)();
-        };
+        using Func = typename std::decay<F>::type;
+        using Result = typename std::result_of<Func&()>::type;
+        auto* task = new detail::task_state<Result, Func>(std::forward<F>(f));
+        task->release(); // 没有future关注结果，只保留队列持有的引用
+        task_ = task;
+    }
+    
+    explicit task_wrapper(detail::task_base* task) noexcept : task_(task) {}
+    
+    task_wrapper(task_wrapper&& other) noexcept : task_(other.task_) {
+        other.task_ = nullptr;
+    }
+    
+    task_wrapper& operator=(task_wrapper&& other) noexcept {
+        if (this != &other) {
+            reset();
+            task_ = other.task_;
+            other.task_ = nullptr;
+        }
+        return *this;
     }
     
-    void operator()() {
-        if (func_) {
-            func_();
+    ~task_wrapper() {
+        reset();
+    }
+    
+    task_wrapper(const task_wrapper&) = delete;
+    task_wrapper& operator=(const task_wrapper&) = delete;
+    
+    // 任务把异常捕获到自己的共享状态中，执行本身不会抛出
+    void operator()() noexcept {
+        if (task_) {
+            detail::task_base* task = task_;
+            task_ = nullptr;
+            task->run();
         }
     }
     
     bool valid() const {
-        return future_.valid();
+        return task_ != nullptr;
     }
     
-    void wait() {
-        if (future_.valid()) {
-            future_.wait();
+private:
+    void reset() noexcept {
+        if (task_) {
+            task_->abandon();
+            task_ = nullptr;
         }
     }
     
-    template <typename Rep, typename Period>
-    std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) {
-        if (future_.valid()) {
-            return future_.wait_for(timeout);
+    detail::task_base* task_;
+};
+
+/**
+ * @brief 线性分配的临时内存区
+ *
+ * 分配只移动偏移量，reset()一次性回收；超出容量的请求落到单独分配的溢出块，
+ * 溢出块在reset()时释放，因此任务不会因为临时数据偏大而失败。
+ */
+class scratch_arena {
+public:
+    explicit scratch_arena(size_t capacity = 0)
+        : data_(capacity > 0 ? new char[capacity] : nullptr)
+        , capacity_(capacity)
+        , offset_(0) {}
+    
+    scratch_arena(scratch_arena&&) noexcept = default;
+    scratch_arena& operator=(scratch_arena&&) noexcept = default;
+    
+    scratch_arena(const scratch_arena&) = delete;
+    scratch_arena& operator=(const scratch_arena&) = delete;
+    
+    /**
+     * @brief 分配内存
+     * @param size 字节数
+     * @param alignment 对齐要求（2的幂）
+     * @return 内存指针，在reset()之前有效
+     */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        size_t aligned = (offset_ + alignment - 1) & ~(alignment - 1);
+        if (data_ && aligned + size <= capacity_) {
+            offset_ = aligned + size;
+            return data_.get() + aligned;
         }
-        return std::future_status::ready;
+        
+        overflow_.emplace_back(new char[size + alignment]);
+        auto address = reinterpret_cast<std::uintptr_t>(overflow_.back().get());
+        return reinterpret_cast<void*>((address + alignment - 1) & ~(std::uintptr_t(alignment) - 1));
+    }
+    
+    /**
+     * @brief 分配未初始化的数组
+     * @param count 元素数量
+     */
+    template <typename T>
+    T* allocate_array(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "scratch_arena does not run destructors");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+    
+    /**
+     * @brief 回收全部分配
+     */
+    void reset() {
+        offset_ = 0;
+        overflow_.clear();
     }
     
+    size_t capacity() const { return capacity_; }
+    size_t used() const { return offset_; }
+    size_t overflow_blocks() const { return overflow_.size(); }
+    
 private:
-    std::function<void()> func_;
-    std::future<void> future_;
+    std::unique_ptr<char[]> data_;
+    size_t capacity_;
+    size_t offset_;
+    std::vector<std::unique_ptr<char[]>> overflow_;
+};
+
+class thread_pool;
+
+/**
+ * @brief 工作线程私有的临时状态
+ *
+ * 每个工作线程一份，只在该线程上访问，因此不需要加锁。
+ * 任务通过thread_pool::current_worker()获取。
+ */
+class worker_context {
+public:
+    worker_context(thread_pool& pool, size_t index)
+        : pool_(pool), index_(index), context_type_(nullptr) {}
+    
+    worker_context(const worker_context&) = delete;
+    worker_context& operator=(const worker_context&) = delete;
+    
+    /**
+     * @brief 工作线程编号
+     */
+    size_t index() const { return index_; }
+    
+    /**
+     * @brief 所属线程池
+     */
+    thread_pool& pool() const { return pool_; }
+    
+    /**
+     * @brief 临时内存区，大小由thread_pool::set_scratch_size()决定
+     */
+    scratch_arena& arena() {
+        if (arena_.capacity() != arena_size_) {
+            arena_ = scratch_arena(arena_size_);
+        }
+        return arena_;
+    }
+    
+    /**
+     * @brief 可复用的缓冲区，reset()只清空内容、保留容量
+     * @param slot 缓冲区编号
+     */
+    std::vector<char>& buffer(size_t slot = 0) {
+        if (slot >= buffers_.size()) {
+            buffers_.resize(slot + 1);
+        }
+        return buffers_[slot];
+    }
+    
+    /**
+     * @brief 获取用户定义的工作线程上下文
+     *
+     * 首次访问时在本线程上调用thread_pool::set_worker_context()注册的工厂构造。
+     * @throws thread_pool_exception 未注册工厂或类型不匹配
+     */
+    template <typename T>
+    T& local() {
+        if (!context_) {
+            if (!context_factory_) {
+                throw thread_pool_exception("No worker context factory registered");
+            }
+            context_ = context_factory_->create(index_);
+            context_type_ = context_factory_->type;
+        }
+        if (*context_type_ != typeid(T)) {
+            throw thread_pool_exception("Worker context type mismatch");
+        }
+        return *static_cast<T*>(context_.get());
+    }
+    
+    /**
+     * @brief 重置临时内存区和缓冲区
+     */
+    void reset() {
+        arena_.reset();
+        for (auto& buffer : buffers_) {
+            buffer.clear();
+        }
+    }
+    
+private:
+    friend class thread_pool;
+    
+    /**
+     * @brief 上下文工厂及其构造的类型
+     */
+    struct context_factory {
+        std::function<std::shared_ptr<void>(size_t)> create;
+        const std::type_info* type;
+    };
+    
+    thread_pool& pool_;
+    size_t index_;
+    size_t arena_size_ = 0;
+    uint64_t reset_epoch_ = 0;
+    uint64_t config_epoch_ = 0;
+    scratch_arena arena_;
+    std::vector<std::vector<char>> buffers_;
+    std::shared_ptr<const context_factory> context_factory_;
+    std::shared_ptr<void> context_;
+    const std::type_info* context_type_;
 };
 
 /**
@@ -81,6 +271,7 @@ private:
  * - 线程安全的任务提交
  * - 优雅关闭和任务等待
  * - 负载均衡和性能优化
+ * - 每个工作线程拥有可重置的临时内存区、缓冲区和用户上下文
  */
 class thread_pool {
 public:
@@ -94,7 +285,11 @@ public:
         , paused_(false)
         , active_threads_(0)
         , total_tasks_(0)
-        , max_queue_size_(max_queue_size) {
+        , max_queue_size_(max_queue_size)
+        , thread_limit_(0)
+        , scratch_size_(default_scratch_size)
+        , reset_epoch_(0)
+        , config_epoch_(1) {
         
         if (thread_count == 0) {
             thread_count = std::thread::hardware_concurrency();
@@ -103,9 +298,10 @@ public:
             }
         }
         
+        thread_limit_ = thread_count;
         workers_.reserve(thread_count);
         for (size_t i = 0; i < thread_count; ++i) {
-            workers_.emplace_back(&thread_pool::worker_thread, this);
+            spawn_worker(i);
         }
     }
     
@@ -124,35 +320,26 @@ public:
      */
     template <typename F, typename... Args>
     auto submit(F&& f, Args&&... args) 
-        -> std::future<typename std::result_of<F(Args...)>::type> {
+        -> future<typename std::result_of<F(Args...)>::type> {
         
         using ReturnType = typename std::result_of<F(Args...)>::type;
         
-        auto task = std::make_shared<std::packaged_task<ReturnType()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        
-        std::future<ReturnType> result = task->get_future();
-        
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            
-            if (stop_) {
-                throw thread_pool_exception("Thread pool is stopped");
-            }
-            
-            if (max_queue_size_ > 0 && task_queue_.size() >= max_queue_size_) {
-                throw thread_pool_exception("Task queue is full");
-            }
-            
-            task_queue_.emplace([task]() {
-                (*task)();
-            });
-            
-            total_tasks_++;
+        detail::task_base* task;
+        future<ReturnType> result;
+        if constexpr (sizeof...(Args) == 0) {
+            using Func = typename std::decay<F>::type;
+            auto* state = new detail::task_state<ReturnType, Func>(std::forward<F>(f));
+            task = state;
+            result = future<ReturnType>(state);
+        } else {
+            auto bound = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+            using Func = decltype(bound);
+            auto* state = new detail::task_state<ReturnType, Func>(std::move(bound));
+            task = state;
+            result = future<ReturnType>(state);
         }
         
-        condition_.notify_one();
+        enqueue(task_wrapper(task));
         return result;
     }
     
@@ -163,7 +350,11 @@ public:
      */
     template <typename F, typename... Args>
     void execute(F&& f, Args&&... args) {
-        submit(std::forward<F>(f), std::forward<Args>(args)...);
+        if constexpr (sizeof...(Args) == 0) {
+            enqueue(task_wrapper(std::forward<F>(f)));
+        } else {
+            enqueue(task_wrapper(std::bind(std::forward<F>(f), std::forward<Args>(args)...)));
+        }
     }
     
     /**
@@ -172,11 +363,12 @@ public:
      * @return future列表
      */
     template <typename F, typename Container>
-    std::vector<std::future<typename std::result_of<F(typename Container::value_type)>::type>>
+    std::vector<future<typename std::result_of<F(typename Container::value_type)>::type>>
     submit_batch(F&& f, const Container& container) {
         
         using ReturnType = typename std::result_of<F(typename Container::value_type)>::type;
-        std::vector<std::future<ReturnType>> futures;
+        std::vector<future<ReturnType>> futures;
+        futures.reserve(container.size());
         
         for (const auto& item : container) {
             futures.push_back(submit(f, item));
@@ -212,13 +404,14 @@ public:
      * @param wait_for_tasks 是否等待所有任务完成
      */
     void shutdown(bool wait_for_tasks = true) {
+        // 被丢弃的任务在锁外析构，其future的回调可能会再次访问线程池
+        std::queue<task_wrapper> dropped;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
             stop_ = true;
             if (!wait_for_tasks) {
                 // 清空任务队列
-                std::queue<task_wrapper> empty;
-                task_queue_.swap(empty);
+                task_queue_.swap(dropped);
             }
         }
         
@@ -355,23 +548,22 @@ public:
         
         if (new_thread_count > workers_.size()) {
             // 增加线程
-            size_t to_add = new_thread_count - workers_.size();
-            for (size_t i = 0; i < to_add; ++i) {
-                workers_.emplace_back(&thread_pool::worker_thread, this);
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex_);
+                thread_limit_ = new_thread_count;
+            }
+            for (size_t i = workers_.size(); i < new_thread_count; ++i) {
+                spawn_worker(i);
             }
         } else {
-            // 减少线程
-            size_t to_remove = workers_.size() - new_thread_count;
-            
-            // 标记需要停止的线程
+            // 减少线程：编号不小于新线程数的工作线程会在完成当前任务后退出
             std::vector<std::thread> threads_to_stop;
             {
                 std::unique_lock<std::mutex> lock(queue_mutex_);
-                for (size_t i = 0; i < to_remove; ++i) {
-                    if (!workers_.empty()) {
-                        threads_to_stop.push_back(std::move(workers_.back()));
-                        workers_.pop_back();
-                    }
+                thread_limit_ = new_thread_count;
+                while (workers_.size() > new_thread_count) {
+                    threads_to_stop.push_back(std::move(workers_.back()));
+                    workers_.pop_back();
                 }
             }
             
@@ -384,29 +576,142 @@ public:
                     thread.join();
                 }
             }
+            contexts_.resize(new_thread_count);
         }
     }
     
+    /**
+     * @brief 获取当前工作线程的私有状态
+     * @return 在线程池工作线程中调用时返回其上下文，否则返回nullptr
+     */
+    static worker_context* current_worker() {
+        return current_worker_slot();
+    }
+    
+    /**
+     * @brief 设置每个工作线程临时内存区的大小
+     * @param bytes 字节数，工作线程在下一个任务开始前生效
+     */
+    void set_scratch_size(size_t bytes) {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        scratch_size_ = bytes;
+        config_epoch_++;
+    }
+    
+    /**
+     * @brief 获取工作线程临时内存区的大小
+     */
+    size_t scratch_size() const {
+        std::unique_lock<std::mutex> lock(const_cast<std::mutex&>(queue_mutex_));
+        return scratch_size_;
+    }
+    
+    /**
+     * @brief 注册工作线程上下文工厂
+     *
+     * 工厂在每个工作线程上首次调用worker_context::local<T>()时执行，
+     * 参数为工作线程编号，返回值即为该线程的上下文。
+     * 重新注册会在各工作线程下一个任务开始前销毁旧上下文。
+     * @param factory 形如 T(size_t index) 的可调用对象
+     */
+    template <typename Factory>
+    void set_worker_context(Factory factory) {
+        using Context = typename std::decay<typename std::result_of<Factory(size_t)>::type>::type;
+        
+        auto created = std::make_shared<worker_context::context_factory>();
+        created->create = [factory](size_t index) -> std::shared_ptr<void> {
+            return std::make_shared<Context>(factory(index));
+        };
+        created->type = &typeid(Context);
+        
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        context_factory_ = std::move(created);
+        config_epoch_++;
+    }
+    
+    /**
+     * @brief 重置所有工作线程的临时状态
+     *
+     * 各工作线程在下一个任务开始前重置临时内存区和缓冲区，
+     * 用于在批次之间回收临时数据。
+     */
+    void reset_scratch() {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        reset_epoch_++;
+    }
+    
     // 禁用拷贝构造和拷贝赋值
     thread_pool(const thread_pool&) = delete;
     thread_pool& operator=(const thread_pool&) = delete;
 
 private:
+    /**
+     * @brief 将任务放入队列
+     * @param task 任务包装器，入队失败时由其析构函数释放任务
+     */
+    void enqueue(task_wrapper task) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            
+            if (stop_) {
+                throw thread_pool_exception("Thread pool is stopped");
+            }
+            
+            if (max_queue_size_ > 0 && task_queue_.size() >= max_queue_size_) {
+                throw thread_pool_exception("Task queue is full");
+            }
+            
+            task_queue_.push(std::move(task));
+            total_tasks_++;
+        }
+        
+        condition_.notify_one();
+    }
+    
+    static constexpr size_t default_scratch_size = 64 * 1024;
+    
+    static worker_context*& current_worker_slot() {
+        static thread_local worker_context* current = nullptr;
+        return current;
+    }
+    
+    /**
+     * @brief 创建工作线程及其私有状态
+     * @param index 工作线程编号
+     */
+    void spawn_worker(size_t index) {
+        if (contexts_.size() <= index) {
+            contexts_.resize(index + 1);
+        }
+        contexts_[index] = std::make_unique<worker_context>(*this, index);
+        workers_.emplace_back(&thread_pool::worker_thread, this, index, contexts_[index].get());
+    }
+    
     /**
      * @brief 工作线程函数
+     * @param index 工作线程编号
+     * @param context 工作线程私有状态
      */
-    void worker_thread() {
+    void worker_thread(size_t index, worker_context* context) {
+        current_worker_slot() = context;
+        
         while (true) {
             task_wrapper task;
+            bool reset_scratch = false;
+            bool reset_context = false;
             
             {
                 std::unique_lock<std::mutex> lock(queue_mutex_);
                 
                 // 等待任务或停止信号
-                condition_.wait(lock, [this] {
-                    return stop_ || (!task_queue_.empty() && !paused_);
+                condition_.wait(lock, [this, index] {
+                    return stop_ || index >= thread_limit_ || (!task_queue_.empty() && !paused_);
                 });
                 
+                if (index >= thread_limit_) {
+                    return;
+                }
+                
                 if (stop_ && task_queue_.empty()) {
                     return;
                 }
@@ -418,18 +723,34 @@ private:
                 task = std::move(task_queue_.front());
                 task_queue_.pop();
                 active_threads_++;
+                
+                // 同步线程池配置，实际的重置在锁外进行
+                if (context->config_epoch_ != config_epoch_) {
+                    context->config_epoch_ = config_epoch_;
+                    context->arena_size_ = scratch_size_;
+                    if (context->context_factory_ != context_factory_) {
+                        context->context_factory_ = context_factory_;
+                        reset_context = true;
+                    }
+                }
+                if (context->reset_epoch_ != reset_epoch_) {
+                    context->reset_epoch_ = reset_epoch_;
+                    reset_scratch = true;
+                }
             }
             
-            // 执行任务
-            try {
-                task();
-            } catch (const std::exception& e) {
-                // 记录异常，但不中断线程池运行
-                // 在实际应用中，可以添加日志系统
-            } catch (...) {
-                // 捕获所有异常
+            if (reset_context) {
+                context->context_.reset();
+                context->context_type_ = nullptr;
+            }
+            if (reset_scratch) {
+                context->reset();
             }
             
+            // 执行任务，异常已由任务捕获并传递给future
+            static_assert(noexcept(task()), "task_wrapper must not throw");
+            task();
+            
             {
                 std::unique_lock<std::mutex> lock(queue_mutex_);
                 active_threads_--;
@@ -447,6 +768,13 @@ private:
     std::atomic<size_t> active_threads_;      // 活跃线程数
     std::atomic<size_t> total_tasks_;         // 总任务数
     size_t max_queue_size_;                   // 最大队列大小
+    size_t thread_limit_;                     // 编号小于该值的工作线程保持运行
+    
+    std::vector<std::unique_ptr<worker_context>> contexts_;  // 工作线程私有状态
+    size_t scratch_size_;                     // 临时内存区大小
+    uint64_t reset_epoch_;                    // 临时状态重置版本
+    uint64_t config_epoch_;                   // 配置版本
+    std::shared_ptr<const worker_context::context_factory> context_factory_;  // 上下文工厂
 };
 
 /**
@@ -465,7 +793,7 @@ template <typename F>
 void parallel_for(thread_pool& pool, size_t start, size_t end, F&& f) {
     const size_t chunk_size = std::max(size_t(1), (end - start) / pool.thread_count());
     
-    std::vector<std::future<void>> futures;
+    std::vector<future<void>> futures;
     
     for (size_t i = start; i < end; i += chunk_size) {
         size_t chunk_end = std::min(i + chunk_size, end);
@@ -518,7 +846,7 @@ T parallel_reduce(thread_pool& pool, const Container& container, F&& f, T initia
     
     const size_t chunk_size = std::max(size_t(1), container.size() / pool.thread_count());
     
-    std::vector<std::future<T>> futures;
+    std::vector<future<T>> futures;
     
     for (size_t i = 0; i < container.size(); i += chunk_size) {
         size_t chunk_end = std::min(i + chunk_size, container.size());
@@ -0,0 +1,573 @@
+/**
+ * @file thread_pool_benchmark.cpp
+ * @brief 线程池调度基准测试
+ *
+ * 每个负载分别在当前线程池配置和 std::async 基线上运行，输出耗时、吞吐量和延迟分位数，
+ * 用于评估调度器改动前后的差异。
+ *
+ * 用法：thread_pool_benchmark [线程数] [规模系数]
+ *   线程数默认为硬件并发数，规模系数默认为1（按比例放大所有负载的任务数）。
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "thread_pool.hpp"
+
+using namespace impl;
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+/**
+ * @brief 单项测试结果
+ */
+struct bench_result {
+    double seconds = 0.0;     ///< 总耗时
+    size_t operations = 0;    ///< 完成的任务/操作数
+    double p50_us = -1.0;     ///< 中位延迟（微秒），小于0表示不适用
+    double p99_us = -1.0;     ///< p99延迟（微秒），小于0表示不适用
+};
+
+struct bench_config {
+    size_t threads = 0;
+    size_t scale = 1;
+};
+
+double elapsed_seconds(bench_clock::time_point start) {
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+/**
+ * @brief 防止编译器把计算结果优化掉
+ */
+template <typename T>
+void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief 固定次数的纯计算，用于模拟任务代价
+ */
+uint64_t spin_work(size_t iterations) {
+    uint64_t x = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < iterations; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    return x;
+}
+
+/**
+ * @brief 完成计数器
+ *
+ * 线程池侧的计时以最后一个任务完成为终点。wait_all() 以10ms为间隔轮询，会把耗时量化到
+ * 10ms 左右，与直接等待future的 std::async 基线不可比；这里由最后一个任务直接唤醒调用线程。
+ */
+class completion_latch {
+public:
+    explicit completion_latch(size_t count = 0) : count_(count) {}
+
+    void add(size_t n = 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        count_ += n;
+    }
+
+    void count_down() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--count_ == 0) {
+            cv_.notify_all();
+        }
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return count_ == 0; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t count_;
+};
+
+double percentile(std::vector<double>& samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+void print_header() {
+    std::printf("%-28s %-12s %12s %14s %10s %10s\n",
+                "workload", "executor", "time(ms)", "ops/s", "p50(us)", "p99(us)");
+    std::printf("%s\n", std::string(90, '-').c_str());
+}
+
+void print_row(const char* workload, const char* executor, const bench_result& r) {
+    double ops_per_sec = r.seconds > 0 ? r.operations / r.seconds : 0.0;
+    char p50[32] = "-";
+    char p99[32] = "-";
+    if (r.p50_us >= 0) {
+        std::snprintf(p50, sizeof(p50), "%.1f", r.p50_us);
+        std::snprintf(p99, sizeof(p99), "%.1f", r.p99_us);
+    }
+    std::printf("%-28s %-12s %12.2f %14.0f %10s %10s\n",
+                workload, executor, r.seconds * 1e3, ops_per_sec, p50, p99);
+}
+
+// ---------------------------------------------------------------------------
+// 1. 空任务吞吐量
+// ---------------------------------------------------------------------------
+
+bench_result empty_tasks_pool(thread_pool& pool, size_t count) {
+    std::atomic<size_t> done{0};
+    completion_latch latch(count);
+    auto start = bench_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        pool.execute([&done, &latch] {
+            done.fetch_add(1, std::memory_order_relaxed);
+            latch.count_down();
+        });
+    }
+    latch.wait();
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = done.load();
+    return r;
+}
+
+bench_result empty_tasks_async(size_t count) {
+    std::atomic<size_t> done{0};
+    std::vector<std::future<void>> futures;
+    futures.reserve(count);
+    auto start = bench_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        futures.push_back(std::async(std::launch::async, [&done] {
+            done.fetch_add(1, std::memory_order_relaxed);
+        }));
+    }
+    for (auto& f : futures) {
+        f.wait();
+    }
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = done.load();
+    return r;
+}
+
+// ---------------------------------------------------------------------------
+// 2. 分治递归（fib / quicksort）
+//
+// 线程池版本不在工作线程里阻塞等待子任务：每个任务拆分后把子问题重新提交，
+// 叶子结果累加到原子变量。提交前计数加一、任务结束时减一，计数归零即整棵树完成，
+// 调用线程在计数器上等待，避免所有工作线程同时等待子任务导致的死锁。std::async 版本使用经典的 async + get 递归。
+// ---------------------------------------------------------------------------
+
+uint64_t fib_serial(unsigned n) {
+    return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+void fib_pool_task(thread_pool& pool, unsigned n, unsigned cutoff, std::atomic<uint64_t>& sum,
+                   std::atomic<size_t>& tasks, completion_latch& latch) {
+    tasks.fetch_add(1, std::memory_order_relaxed);
+    if (n <= cutoff) {
+        sum.fetch_add(fib_serial(n), std::memory_order_relaxed);
+        return;
+    }
+    latch.add();
+    pool.execute([&pool, n, cutoff, &sum, &tasks, &latch] {
+        fib_pool_task(pool, n - 1, cutoff, sum, tasks, latch);
+        latch.count_down();
+    });
+    fib_pool_task(pool, n - 2, cutoff, sum, tasks, latch);
+}
+
+uint64_t fib_async(unsigned n, unsigned cutoff, std::atomic<size_t>& tasks) {
+    tasks.fetch_add(1, std::memory_order_relaxed);
+    if (n <= cutoff) {
+        return fib_serial(n);
+    }
+    auto left = std::async(std::launch::async, fib_async, n - 1, cutoff, std::ref(tasks));
+    uint64_t right = fib_async(n - 2, cutoff, tasks);
+    return left.get() + right;
+}
+
+bench_result fib_pool(thread_pool& pool, unsigned n, unsigned cutoff) {
+    std::atomic<uint64_t> sum{0};
+    std::atomic<size_t> tasks{0};
+    completion_latch latch(1);
+    auto start = bench_clock::now();
+    pool.execute([&pool, n, cutoff, &sum, &tasks, &latch] {
+        fib_pool_task(pool, n, cutoff, sum, tasks, latch);
+        latch.count_down();
+    });
+    latch.wait();
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = tasks.load();
+    if (sum.load() != fib_serial(n)) {
+        std::fprintf(stderr, "fib: wrong result\n");
+    }
+    return r;
+}
+
+bench_result fib_std_async(unsigned n, unsigned cutoff) {
+    std::atomic<size_t> tasks{0};
+    auto start = bench_clock::now();
+    uint64_t value = fib_async(n, cutoff, tasks);
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = tasks.load();
+    do_not_optimize(value);
+    return r;
+}
+
+size_t partition_range(std::vector<int>& data, size_t lo, size_t hi) {
+    int pivot = data[lo + (hi - lo) / 2];
+    size_t i = lo;
+    size_t j = hi - 1;
+    while (true) {
+        while (data[i] < pivot) ++i;
+        while (data[j] > pivot) --j;
+        if (i >= j) {
+            return j + 1;
+        }
+        std::swap(data[i], data[j]);
+        ++i;
+        --j;
+    }
+}
+
+// 两种实现的划分方式相同：每个区间计一次任务，不超过cutoff时直接排序，
+// 否则左半部分交给新任务、右半部分在当前任务中递归，因此任务数对同一输入一致
+void quicksort_pool_task(thread_pool& pool, std::vector<int>& data, size_t lo, size_t hi,
+                         size_t cutoff, std::atomic<size_t>& tasks, completion_latch& latch) {
+    tasks.fetch_add(1, std::memory_order_relaxed);
+    if (hi - lo <= cutoff) {
+        std::sort(data.begin() + lo, data.begin() + hi);
+        return;
+    }
+    size_t mid = partition_range(data, lo, hi);
+    latch.add();
+    pool.execute([&pool, &data, lo, mid, cutoff, &tasks, &latch] {
+        quicksort_pool_task(pool, data, lo, mid, cutoff, tasks, latch);
+        latch.count_down();
+    });
+    quicksort_pool_task(pool, data, mid, hi, cutoff, tasks, latch);
+}
+
+void quicksort_async(std::vector<int>& data, size_t lo, size_t hi, size_t cutoff,
+                     std::atomic<size_t>& tasks) {
+    tasks.fetch_add(1, std::memory_order_relaxed);
+    if (hi - lo <= cutoff) {
+        std::sort(data.begin() + lo, data.begin() + hi);
+        return;
+    }
+    size_t mid = partition_range(data, lo, hi);
+    auto left = std::async(std::launch::async, quicksort_async, std::ref(data), lo, mid,
+                           cutoff, std::ref(tasks));
+    quicksort_async(data, mid, hi, cutoff, tasks);
+    left.get();
+}
+
+std::vector<int> random_data(size_t size) {
+    std::mt19937 rng(12345);
+    std::vector<int> data(size);
+    for (auto& v : data) {
+        v = static_cast<int>(rng());
+    }
+    return data;
+}
+
+bench_result quicksort_pool(thread_pool& pool, size_t size, size_t cutoff) {
+    std::vector<int> data = random_data(size);
+    std::atomic<size_t> tasks{0};
+    completion_latch latch(1);
+    auto start = bench_clock::now();
+    pool.execute([&pool, &data, size, cutoff, &tasks, &latch] {
+        quicksort_pool_task(pool, data, 0, size, cutoff, tasks, latch);
+        latch.count_down();
+    });
+    latch.wait();
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = tasks.load();
+    if (!std::is_sorted(data.begin(), data.end())) {
+        std::fprintf(stderr, "quicksort: result not sorted\n");
+    }
+    return r;
+}
+
+bench_result quicksort_std_async(size_t size, size_t cutoff) {
+    std::vector<int> data = random_data(size);
+    std::atomic<size_t> tasks{0};
+    auto start = bench_clock::now();
+    quicksort_async(data, 0, size, cutoff, tasks);
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = tasks.load();
+    return r;
+}
+
+// ---------------------------------------------------------------------------
+// 3. 代价倾斜的 parallel_for：每64个下标中有一个代价是其余的100倍，
+//    且重任务集中在区间前部，考验静态分块的负载均衡
+// ---------------------------------------------------------------------------
+
+size_t skewed_cost(size_t i, size_t n) {
+    size_t base = 200;
+    if (i % 64 == 0 && i < n / 4) {
+        return base * 100;
+    }
+    return base;
+}
+
+bench_result skewed_for_pool(thread_pool& pool, size_t n) {
+    std::atomic<uint64_t> sink{0};
+    auto start = bench_clock::now();
+    thread_pool_utils::parallel_for(pool, 0, n, [&sink, n](size_t i) {
+        uint64_t v = spin_work(skewed_cost(i, n));
+        if (v == 0) {
+            sink.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = n;
+    return r;
+}
+
+bench_result skewed_for_async(size_t n, size_t chunks) {
+    std::atomic<uint64_t> sink{0};
+    auto start = bench_clock::now();
+    std::vector<std::future<void>> futures;
+    size_t chunk_size = std::max<size_t>(1, n / chunks);
+    for (size_t lo = 0; lo < n; lo += chunk_size) {
+        size_t hi = std::min(n, lo + chunk_size);
+        futures.push_back(std::async(std::launch::async, [&sink, lo, hi, n] {
+            for (size_t i = lo; i < hi; ++i) {
+                uint64_t v = spin_work(skewed_cost(i, n));
+                if (v == 0) {
+                    sink.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }));
+    }
+    for (auto& f : futures) {
+        f.wait();
+    }
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = n;
+    return r;
+}
+
+// ---------------------------------------------------------------------------
+// 4. 多生产者提交：多个外部线程同时向同一个执行器提交小任务
+// ---------------------------------------------------------------------------
+
+bench_result producers_pool(thread_pool& pool, size_t producers, size_t per_producer) {
+    std::atomic<size_t> done{0};
+    std::atomic<bool> go{false};
+    completion_latch latch(producers * per_producer);
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < per_producer; ++i) {
+                pool.execute([&done, &latch] {
+                    done.fetch_add(1, std::memory_order_relaxed);
+                    latch.count_down();
+                });
+            }
+        });
+    }
+    auto start = bench_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    latch.wait();
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = done.load();
+    return r;
+}
+
+bench_result producers_async(size_t producers, size_t per_producer) {
+    std::atomic<size_t> done{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            std::vector<std::future<void>> futures;
+            futures.reserve(per_producer);
+            for (size_t i = 0; i < per_producer; ++i) {
+                futures.push_back(std::async(std::launch::async, [&done] {
+                    done.fetch_add(1, std::memory_order_relaxed);
+                }));
+            }
+            for (auto& f : futures) {
+                f.wait();
+            }
+        });
+    }
+    auto start = bench_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = done.load();
+    return r;
+}
+
+// ---------------------------------------------------------------------------
+// 5. 负载下的调度延迟：后台持续有计算任务时，测量探测任务从提交到开始执行的时间
+// ---------------------------------------------------------------------------
+
+constexpr size_t background_task_cost = 20000;
+
+template <typename Submit>
+bench_result latency_under_load(size_t probes, Submit&& submit) {
+    std::vector<double> samples(probes, 0.0);
+    std::atomic<size_t> finished{0};
+    auto start = bench_clock::now();
+    for (size_t i = 0; i < probes; ++i) {
+        auto submitted = bench_clock::now();
+        submit([&samples, &finished, i, submitted] {
+            samples[i] = std::chrono::duration<double, std::micro>(
+                bench_clock::now() - submitted).count();
+            finished.fetch_add(1, std::memory_order_release);
+        });
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    while (finished.load(std::memory_order_acquire) < probes) {
+        std::this_thread::yield();
+    }
+    bench_result r;
+    r.seconds = elapsed_seconds(start);
+    r.operations = probes;
+    r.p50_us = percentile(samples, 0.50);
+    r.p99_us = percentile(samples, 0.99);
+    return r;
+}
+
+bench_result latency_pool(thread_pool& pool, size_t probes) {
+    std::atomic<bool> stop{false};
+    // 每个工作线程上保持一个自我续期的后台任务，使队列始终非空；停止后每条任务链计数减一
+    completion_latch chains(pool.thread_count());
+    std::function<void()> background;
+    background = [&] {
+        do_not_optimize(spin_work(background_task_cost));
+        if (!stop.load(std::memory_order_relaxed)) {
+            pool.execute(background);
+        } else {
+            chains.count_down();
+        }
+    };
+    for (size_t i = 0; i < pool.thread_count(); ++i) {
+        pool.execute(background);
+    }
+    bench_result r = latency_under_load(probes, [&pool](std::function<void()> probe) {
+        pool.execute(std::move(probe));
+    });
+    stop.store(true);
+    chains.wait();
+    return r;
+}
+
+bench_result latency_async(size_t probes, size_t background_threads) {
+    std::atomic<bool> stop{false};
+    std::vector<std::future<void>> background;
+    for (size_t i = 0; i < background_threads; ++i) {
+        background.push_back(std::async(std::launch::async, [&stop] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                do_not_optimize(spin_work(background_task_cost));
+            }
+        }));
+    }
+    std::vector<std::future<void>> futures;
+    futures.reserve(probes);
+    bench_result r = latency_under_load(probes, [&futures](std::function<void()> probe) {
+        futures.push_back(std::async(std::launch::async, std::move(probe)));
+    });
+    stop.store(true);
+    for (auto& f : background) {
+        f.wait();
+    }
+    return r;
+}
+
+size_t parse_arg(int argc, char** argv, int index, size_t fallback) {
+    if (argc <= index) {
+        return fallback;
+    }
+    long value = std::strtol(argv[index], nullptr, 10);
+    return value > 0 ? static_cast<size_t>(value) : fallback;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench_config config;
+    config.threads = parse_arg(argc, argv, 1, std::max(1u, std::thread::hardware_concurrency()));
+    config.scale = parse_arg(argc, argv, 2, 1);
+
+    const size_t empty_count = 20000 * config.scale;
+    const unsigned fib_n = 27;
+    const unsigned fib_cutoff = 14;
+    const size_t sort_size = 1000000 * config.scale;
+    const size_t sort_cutoff = 4096;
+    const size_t skewed_n = 20000 * config.scale;
+    const size_t producers = std::max<size_t>(4, config.threads * 2);
+    const size_t per_producer = 2000 * config.scale;
+    const size_t probes = 500 * config.scale;
+
+    std::printf("thread_pool benchmark: threads=%zu scale=%zu hardware_concurrency=%u\n\n",
+                config.threads, config.scale, std::thread::hardware_concurrency());
+    print_header();
+
+    thread_pool pool(config.threads);
+
+    print_row("empty tasks", "thread_pool", empty_tasks_pool(pool, empty_count));
+    print_row("empty tasks", "std::async", empty_tasks_async(empty_count));
+
+    print_row("fork-join fib", "thread_pool", fib_pool(pool, fib_n, fib_cutoff));
+    print_row("fork-join fib", "std::async", fib_std_async(fib_n, fib_cutoff));
+
+    print_row("fork-join quicksort", "thread_pool", quicksort_pool(pool, sort_size, sort_cutoff));
+    print_row("fork-join quicksort", "std::async", quicksort_std_async(sort_size, sort_cutoff));
+
+    print_row("skewed parallel_for", "thread_pool", skewed_for_pool(pool, skewed_n));
+    print_row("skewed parallel_for", "std::async", skewed_for_async(skewed_n, config.threads));
+
+    print_row("many producers", "thread_pool", producers_pool(pool, producers, per_producer));
+    print_row("many producers", "std::async", producers_async(producers, per_producer));
+
+    print_row("submit-to-start under load", "thread_pool", latency_pool(pool, probes));
+    print_row("submit-to-start under load", "std::async", latency_async(probes, config.threads));
+
+    return 0;
+}
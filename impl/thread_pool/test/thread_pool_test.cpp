@@ -41,7 +41,7 @@ TEST_F(ThreadPoolTest, BasicTaskExecution) {
 TEST_F(ThreadPoolTest, MultipleTasks) {
     const int num_tasks = 10;
     std::atomic<int> counter{0};
-    std::vector<std::future<int>> futures;
+    std::vector<future<int>> futures;
     
     for (int i = 0; i < num_tasks; ++i) {
         futures.push_back(pool->submit([&counter, i]() {
@@ -186,7 +186,7 @@ TEST_F(ThreadPoolTest, Resize) {
 TEST(ThreadPoolQueueLimitTest, QueueLimit) {
     thread_pool pool(2, 3); // 2个线程，最大队列大小3
     
-    std::vector<std::future<int>> futures;
+    std::vector<future<int>> futures;
     
     // 提交超过队列限制的任务
     for (int i = 0; i < 6; ++i) {
@@ -294,7 +294,7 @@ TEST(ThreadPoolConcurrencyTest, HighConcurrency) {
     std::atomic<int> counter{0};
     const int num_tasks = 1000;
     
-    std::vector<std::future<void>> futures;
+    std::vector<future<void>> futures;
     futures.reserve(num_tasks);
     
     for (int i = 0; i < num_tasks; ++i) {
@@ -363,7 +363,7 @@ TEST(ThreadPoolLongRunningTest, LongRunning) {
     std::atomic<int> counter{0};
     
     // 启动一些长时间运行的任务
-    std::vector<std::future<void>> futures;
+    std::vector<future<void>> futures;
     for (int i = 0; i < 4; ++i) {
         futures.push_back(pool.submit([&stop_flag, &counter]() {
             while (!stop_flag) {
@@ -407,6 +407,271 @@ TEST_F(ThreadPoolTest, ExceptionTaskHandling) {
     EXPECT_GT(success_count.load(), 0);
 }
 
+// future就绪状态测试
+TEST_F(ThreadPoolTest, FutureIsReady) {
+    std::atomic<bool> release{false};
+    
+    auto future = pool->submit([&release]() {
+        while (!release) {
+            std::this_thread::yield();
+        }
+        return 7;
+    });
+    
+    EXPECT_TRUE(future.valid());
+    EXPECT_FALSE(future.is_ready());
+    EXPECT_EQ(future.wait_for(std::chrono::milliseconds(20)), std::future_status::timeout);
+    
+    release = true;
+    future.wait();
+    EXPECT_TRUE(future.is_ready());
+    EXPECT_EQ(future.get(), 7);
+    EXPECT_FALSE(future.valid());
+}
+
+// then回调链测试
+TEST_F(ThreadPoolTest, FutureThen) {
+    auto future = pool->submit([]() { return 20; })
+        .then([](int x) { return x + 1; })
+        .then([](int x) { return std::to_string(x * 2); });
+    
+    EXPECT_EQ(future.get(), "42");
+    
+    // void任务的回调
+    std::atomic<int> counter{0};
+    auto done = pool->submit([&counter]() { counter = 1; })
+        .then([&counter]() { return counter.load() + 1; });
+    EXPECT_EQ(done.get(), 2);
+}
+
+// then回调的异常传递测试
+TEST_F(ThreadPoolTest, FutureThenPropagatesException) {
+    std::atomic<bool> called{false};
+    
+    auto future = pool->submit([]() -> int {
+        throw std::runtime_error("Test exception");
+    }).then([&called](int x) {
+        called = true;
+        return x;
+    });
+    
+    EXPECT_THROW(future.get(), std::runtime_error);
+    EXPECT_FALSE(called.load());
+    
+    auto thrown = pool->submit([]() { return 1; }).then([](int) -> int {
+        throw std::logic_error("Continuation exception");
+    });
+    EXPECT_THROW(thrown.get(), std::logic_error);
+}
+
+// 已就绪future上挂接then会立即执行
+TEST(FuturePromiseTest, ThenOnReadyFuture) {
+    auto future = make_ready_future(5);
+    EXPECT_TRUE(future.is_ready());
+    
+    std::thread::id caller = std::this_thread::get_id();
+    std::thread::id runner;
+    auto next = std::move(future).then([&runner](int x) {
+        runner = std::this_thread::get_id();
+        return x * 3;
+    });
+    
+    EXPECT_TRUE(next.is_ready());
+    EXPECT_EQ(runner, caller);
+    EXPECT_EQ(next.get(), 15);
+}
+
+// promise基本功能测试
+TEST(FuturePromiseTest, PromiseSetValue) {
+    promise<std::string> p;
+    auto future = p.get_future();
+    EXPECT_FALSE(future.is_ready());
+    EXPECT_THROW(p.get_future(), std::future_error);
+    
+    std::thread producer([&p]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        p.set_value("done");
+    });
+    
+    EXPECT_EQ(future.get(), "done");
+    producer.join();
+    
+    EXPECT_THROW(p.set_value("again"), std::future_error);
+}
+
+// promise销毁时future收到broken_promise
+TEST(FuturePromiseTest, BrokenPromise) {
+    future<int> future;
+    {
+        promise<int> p;
+        future = p.get_future();
+    }
+    
+    try {
+        future.get();
+        FAIL() << "Expected broken_promise";
+    } catch (const std::future_error& e) {
+        EXPECT_EQ(e.code(), std::make_error_code(std::future_errc::broken_promise));
+    }
+}
+
+// 关闭时丢弃的任务通知future
+TEST(ThreadPoolShutdownTest, DroppedTaskBreaksPromise) {
+    thread_pool pool(1);
+    std::atomic<bool> started{false};
+    std::atomic<bool> release{false};
+    
+    auto blocker = pool.submit([&started, &release]() {
+        started = true;
+        while (!release) {
+            std::this_thread::yield();
+        }
+    });
+    auto dropped = pool.submit([]() { return 1; });
+    
+    // 确保blocker已被工作线程取走，只有dropped留在队列中
+    while (!started) {
+        std::this_thread::yield();
+    }
+    
+    std::thread stopper([&pool]() { pool.shutdown(false); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    release = true;
+    stopper.join();
+    
+    blocker.get();
+    EXPECT_THROW(dropped.get(), std::future_error);
+}
+
+// 生产者线程与等待者并发测试
+TEST(FuturePromiseTest, ConcurrentWaiters) {
+    thread_pool pool(4);
+    const int num_tasks = 2000;
+    std::vector<future<int>> futures;
+    futures.reserve(num_tasks);
+    
+    for (int i = 0; i < num_tasks; ++i) {
+        futures.push_back(pool.submit([i]() { return i; }));
+    }
+    
+    long long sum = 0;
+    for (auto& f : futures) {
+        sum += f.get();
+    }
+    
+    EXPECT_EQ(sum, static_cast<long long>(num_tasks) * (num_tasks - 1) / 2);
+}
+
+// 工作线程私有状态测试
+TEST(ThreadPoolWorkerContextTest, CurrentWorker) {
+    EXPECT_EQ(thread_pool::current_worker(), nullptr);
+    
+    thread_pool pool(2);
+    auto future = pool.submit([&pool]() {
+        worker_context* worker = thread_pool::current_worker();
+        EXPECT_NE(worker, nullptr);
+        EXPECT_EQ(&worker->pool(), &pool);
+        return worker->index();
+    });
+    
+    EXPECT_LT(future.get(), 2u);
+}
+
+// 临时内存区测试
+TEST(ThreadPoolWorkerContextTest, ScratchArena) {
+    thread_pool pool(1);
+    pool.set_scratch_size(1024);
+    
+    auto used = pool.submit([]() {
+        scratch_arena& arena = thread_pool::current_worker()->arena();
+        EXPECT_EQ(arena.capacity(), 1024u);
+        
+        int* numbers = arena.allocate_array<int>(16);
+        for (int i = 0; i < 16; ++i) {
+            numbers[i] = i;
+        }
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(numbers) % alignof(int), 0u);
+        
+        // 超出容量的分配落到溢出块
+        char* large = arena.allocate_array<char>(4096);
+        large[4095] = 'x';
+        EXPECT_EQ(arena.overflow_blocks(), 1u);
+        return arena.used();
+    }).get();
+    EXPECT_GE(used, 16 * sizeof(int));
+    
+    // 未重置时临时数据保留到下一个任务
+    auto kept = pool.submit([]() {
+        return thread_pool::current_worker()->arena().used();
+    }).get();
+    EXPECT_EQ(kept, used);
+    
+    pool.reset_scratch();
+    auto after_reset = pool.submit([]() {
+        scratch_arena& arena = thread_pool::current_worker()->arena();
+        return std::make_pair(arena.used(), arena.overflow_blocks());
+    }).get();
+    EXPECT_EQ(after_reset.first, 0u);
+    EXPECT_EQ(after_reset.second, 0u);
+}
+
+// 可复用缓冲区测试
+TEST(ThreadPoolWorkerContextTest, ReusableBuffers) {
+    thread_pool pool(1);
+    
+    pool.submit([]() {
+        auto& buffer = thread_pool::current_worker()->buffer();
+        buffer.resize(64 * 1024);
+    }).get();
+    
+    pool.reset_scratch();
+    auto capacity = pool.submit([]() {
+        auto& buffer = thread_pool::current_worker()->buffer();
+        EXPECT_TRUE(buffer.empty());
+        return buffer.capacity();
+    }).get();
+    
+    EXPECT_GE(capacity, 64u * 1024);
+}
+
+struct ParserContext {
+    size_t worker_index;
+    int uses;
+};
+
+// 用户自定义工作线程上下文测试
+TEST(ThreadPoolWorkerContextTest, UserContext) {
+    thread_pool pool(2);
+    std::atomic<int> constructed{0};
+    
+    pool.set_worker_context([&constructed](size_t index) {
+        constructed++;
+        return ParserContext{index, 0};
+    });
+    
+    std::vector<future<bool>> futures;
+    for (int i = 0; i < 20; ++i) {
+        futures.push_back(pool.submit([]() {
+            worker_context* worker = thread_pool::current_worker();
+            ParserContext& context = worker->local<ParserContext>();
+            context.uses++;
+            return context.worker_index == worker->index();
+        }));
+    }
+    for (auto& f : futures) {
+        EXPECT_TRUE(f.get());
+    }
+    
+    EXPECT_GE(constructed.load(), 1);
+    EXPECT_LE(constructed.load(), 2);
+    
+    // 类型不匹配时抛出异常
+    auto mismatch = pool.submit([]() {
+        thread_pool::current_worker()->local<std::string>();
+    });
+    EXPECT_THROW(mismatch.get(), thread_pool_exception);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();